@@ -32,6 +32,7 @@ HEADERS += src/common/config.h \
     src/common/rtree.h \
     src/common/kv.h \
     src/common/greatcircle.h \
+    src/common/simplify.h \
     src/common/programpaths.h \
     src/common/tifffile.h \
     src/GUI/app.h \
@@ -54,6 +55,7 @@ HEADERS += src/common/config.h \
     src/GUI/heartrategraph.h \
     src/GUI/trackinfo.h \
     src/GUI/exportdialog.h \
+    src/GUI/seeddialog.h \
     src/GUI/fileselectwidget.h \
     src/GUI/margins.h \
     src/GUI/temperaturegraph.h \
@@ -87,6 +89,7 @@ HEADERS += src/common/config.h \
     src/GUI/settings.h \
     src/GUI/cpuarch.h \
     src/GUI/searchpointer.h \
+    src/GUI/jobcontrol.h \
     src/GUI/mapview.h \
     src/GUI/font.h \
     src/GUI/areaitem.h \
@@ -114,6 +117,8 @@ HEADERS += src/common/config.h \
     src/map/albersequal.h \
     src/map/map.h \
     src/map/maplist.h \
+    src/map/mapcatalog.h \
+    src/map/catalogmap.h \
     src/map/onlinemap.h \
     src/map/downloader.h \
     src/map/tile.h \
@@ -134,6 +139,9 @@ HEADERS += src/common/config.h \
     src/map/ct.h \
     src/map/mapsource.h \
     src/map/tileloader.h \
+    src/map/tilecache.h \
+    src/map/tilestore.h \
+    src/map/imagetile.h \
     src/map/wmtsmap.h \
     src/map/wmts.h \
     src/map/wmsmap.h \
@@ -148,6 +156,7 @@ HEADERS += src/common/config.h \
     src/map/krovak.h \
     src/map/geotiffmap.h \
     src/map/image.h \
+    src/map/tiffimage.h \
     src/map/mbtilesmap.h \
     src/map/osm.h \
     src/map/polarstereographic.h \
@@ -160,6 +169,7 @@ HEADERS += src/common/config.h \
     src/data/data.h \
     src/data/parser.h \
     src/data/trackdata.h \
+    src/data/segmentdata.h \
     src/data/routedata.h \
     src/data/path.h \
     src/data/gpxparser.h \
@@ -185,6 +195,8 @@ HEADERS += src/common/config.h \
     src/map/imgmap.h \
     src/map/IMG/img.h \
     src/map/IMG/subfile.h \
+    src/map/IMG/blockcache.h \
+    src/map/IMG/diskcache.h \
     src/map/IMG/trefile.h \
     src/map/IMG/rgnfile.h \
     src/map/IMG/lblfile.h \
@@ -195,6 +207,7 @@ HEADERS += src/common/config.h \
     src/GUI/limitedcombobox.h \
     src/GUI/pathtickitem.h \
     src/map/IMG/textitem.h \
+    src/map/IMG/textitemindex.h \
     src/map/IMG/label.h \
     src/data/csv.h \
     src/data/cupparser.h \
@@ -209,6 +222,7 @@ SOURCES += src/main.cpp \
     src/common/range.cpp \
     src/common/util.cpp \
     src/common/greatcircle.cpp \
+    src/common/simplify.cpp \
     src/common/programpaths.cpp \
     src/common/tifffile.cpp \
     src/GUI/app.cpp \
@@ -228,6 +242,7 @@ SOURCES += src/main.cpp \
     src/GUI/heartrategraph.cpp \
     src/GUI/trackinfo.cpp \
     src/GUI/exportdialog.cpp \
+    src/GUI/seeddialog.cpp \
     src/GUI/fileselectwidget.cpp \
     src/GUI/temperaturegraph.cpp \
     src/GUI/evgraph.cpp \
@@ -269,6 +284,8 @@ SOURCES += src/main.cpp \
     src/map/IMG/textpathitem.cpp \
     src/map/IMG/textpointitem.cpp \
     src/map/maplist.cpp \
+    src/map/mapcatalog.cpp \
+    src/map/catalogmap.cpp \
     src/map/onlinemap.cpp \
     src/map/downloader.cpp \
     src/map/emptymap.cpp \
@@ -296,6 +313,9 @@ SOURCES += src/main.cpp \
     src/map/linearunits.cpp \
     src/map/mapsource.cpp \
     src/map/tileloader.cpp \
+    src/map/tilecache.cpp \
+    src/map/tilestore.cpp \
+    src/map/imagetile.cpp \
     src/map/wmtsmap.cpp \
     src/map/wmts.cpp \
     src/map/wmsmap.cpp \
@@ -308,6 +328,7 @@ SOURCES += src/main.cpp \
     src/map/krovak.cpp \
     src/map/map.cpp \
     src/map/geotiffmap.cpp \
+    src/map/tiffimage.cpp \
     src/map/image.cpp \
     src/map/mbtilesmap.cpp \
     src/map/osm.cpp \
@@ -316,6 +337,7 @@ SOURCES += src/main.cpp \
     src/data/data.cpp \
     src/data/poi.cpp \
     src/data/track.cpp \
+    src/data/segmentdata.cpp \
     src/data/route.cpp \
     src/data/path.cpp \
     src/data/gpxparser.cpp \
@@ -337,6 +359,8 @@ SOURCES += src/main.cpp \
     src/map/imgmap.cpp \
     src/map/IMG/img.cpp \
     src/map/IMG/subfile.cpp \
+    src/map/IMG/blockcache.cpp \
+    src/map/IMG/diskcache.cpp \
     src/map/IMG/trefile.cpp \
     src/map/IMG/rgnfile.cpp \
     src/map/IMG/lblfile.cpp \
@@ -344,7 +368,7 @@ SOURCES += src/main.cpp \
     src/map/IMG/style.cpp \
     src/map/IMG/netfile.cpp \
     src/GUI/pathtickitem.cpp \
-    src/map/IMG/textitem.cpp \
+    src/map/IMG/textitemindex.cpp \
     src/data/csv.cpp \
     src/data/cupparser.cpp \
     src/GUI/graphicsscene.cpp \
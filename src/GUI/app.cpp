@@ -9,6 +9,7 @@
 #include "common/programpaths.h"
 #include "common/config.h"
 #include "map/downloader.h"
+#include "map/imgmap.h"
 #include "map/ellipsoid.h"
 #include "map/gcs.h"
 #include "map/pcs.h"
@@ -64,6 +65,8 @@ App::App(int &argc, char **argv) : QApplication(argc, argv)
 #endif // ENABLE_HTTP2
 	Downloader::setTimeout(settings.value(CONNECTION_TIMEOUT_SETTING,
 	  CONNECTION_TIMEOUT_DEFAULT).toInt());
+	IMGMap::useDiskCache(settings.value(VECTOR_CACHE_SETTING,
+	  VECTOR_CACHE_DEFAULT).toBool());
 	settings.endGroup();
 
 	_gui = new GUI();
@@ -79,8 +82,8 @@ int App::run()
 	_gui->show();
 
 	QStringList args(arguments());
-	for (int i = 1; i < args.count(); i++)
-		_gui->openFile(args.at(i));
+	args.removeFirst();
+	_gui->openFiles(args);
 
 	return exec();
 }
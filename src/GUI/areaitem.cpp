@@ -3,11 +3,17 @@
 #include <QCursor>
 #include <QPainter>
 #include <QGraphicsSceneMouseEvent>
+#include <QStyleOptionGraphicsItem>
+#include "common/simplify.h"
 #include "map/map.h"
+#include "jobcontrol.h"
 #include "popup.h"
 #include "areaitem.h"
 
 
+#define SIMPLIFY_TOLERANCE 0.5 /* px */
+#define PROJECT_BATCH      4096 /* points */
+
 QString AreaItem::info() const
 {
 	ToolTip tt;
@@ -32,53 +38,135 @@ AreaItem::AreaItem(const Area &area, Map *map, GraphicsItem *parent)
 	QBrush brush(Qt::SolidPattern);
 	_pen = QPen(brush, _width);
 
-	updatePainterPath();
+	for (int i = 0; i < _area.size(); i++) {
+		const Polygon &polygon = _area.at(i);
+		_significance.append(QList<QVector<float> >());
+		for (int j = 0; j < polygon.size(); j++)
+			_significance.last().append(Simplify::significance(
+			  polygon.at(j)));
+	}
+
+	_mapRect = mapRect(_map);
+	setGeometry(geometry());
 
 	setCursor(Qt::ArrowCursor);
 	setAcceptHoverEvents(true);
+	setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
 }
 
 
-QPainterPath AreaItem::painterPath(const Polygon &polygon)
+static QPainterPath ring(const QVector<Coordinates> &lr,
+  const QVector<float> &significance, qreal tolerance, Map *map,
+  JobControl *control, int generation)
 {
+	QVector<Coordinates> ll;
 	QPainterPath path;
 
-	const QVector<Coordinates> &lr = polygon.first();
-	path.moveTo(_map->ll2xy(lr.first()));
+	ll.reserve(lr.size());
+	ll.append(lr.first());
 	for (int i = 1; i < lr.size(); i++)
-		path.lineTo(_map->ll2xy(lr.at(i)));
+		if (significance.at(i) >= tolerance)
+			ll.append(lr.at(i));
+
+	QPolygonF xy(ll.size());
+	for (int i = 0; i < ll.size(); i += PROJECT_BATCH) {
+		if (control && !control->checkpoint(generation))
+			return path;
+		map->ll2xy(ll.constData() + i, xy.data() + i,
+		  qMin(PROJECT_BATCH, ll.size() - i));
+	}
+	path.addPolygon(xy);
 	path.closeSubpath();
 
+	return path;
+}
+
+QPainterPath AreaItem::painterPath(const Polygon &polygon,
+  const QList<QVector<float> > &significance, qreal tolerance,
+  JobControl *control, int generation) const
+{
+	QPainterPath path(ring(polygon.first(), significance.first(), tolerance,
+	  _map, control, generation));
+
 	for (int i = 1; i < polygon.size(); i++) {
-		const QVector<Coordinates> &lr = polygon.at(i);
-		QPainterPath hole;
-		hole.moveTo(_map->ll2xy(lr.first()));
-		for (int j = 1; j < lr.size(); j++)
-			hole.lineTo(_map->ll2xy(lr.at(j)));
-		hole.closeSubpath();
-		path = path.subtracted(hole);
+		if (control && !control->checkpoint(generation))
+			return path;
+		QPainterPath hole(ring(polygon.at(i), significance.at(i), tolerance,
+		  _map, control, generation));
+		/* Holes that collapsed below the tolerance are not visible */
+		if (hole.elementCount() > 3)
+			path = path.subtracted(hole);
 	}
 
 	return path;
 }
 
-void AreaItem::updatePainterPath()
+QRectF AreaItem::mapRect(Map *map) const
+{
+	RectC br(_area.boundingRect());
+	return QRectF(map->ll2xy(br.topLeft()), map->ll2xy(br.bottomRight()))
+	  .normalized();
+}
+
+/* Zoom-dependent simplification tolerance in meters */
+qreal AreaItem::tolerance() const
 {
-	_painterPath = QPainterPath();
+	qreal res = _map->resolution(mapRect(_map));
 
-	for (int i = 0; i < _area.size(); i++)
-		_painterPath.addPath(painterPath(_area.at(i)));
+	return std::isfinite(res)
+	  ? res * pow(2, -_digitalZoom) * SIMPLIFY_TOLERANCE : 0;
+}
+
+AreaItem::Geometry AreaItem::geometry(JobControl *control, int generation)
+  const
+{
+	qreal tol = tolerance();
+	Geometry geometry;
+
+	for (int i = 0; i < _area.size(); i++) {
+		if (control && !control->checkpoint(generation))
+			return geometry;
+		geometry.polygons.append(painterPath(_area.at(i), _significance.at(i),
+		  tol, control, generation));
+		geometry.path.addPath(geometry.polygons.last());
+	}
+
+	return geometry;
+}
+
+void AreaItem::setGeometry(const Geometry &geometry)
+{
+	prepareGeometryChange();
+
+	_polygons = geometry.polygons;
+	_painterPath = geometry.path;
+	_preview.reset();
 }
 
 void AreaItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
   QWidget *widget)
 {
-	Q_UNUSED(option);
 	Q_UNUSED(widget);
+	QPen pen(_width ? _pen : QPen(Qt::NoPen));
+	QRectF er(option->exposedRect);
 
-	painter->setPen(_width ? _pen : QPen(Qt::NoPen));
-	painter->drawPath(_painterPath);
-	painter->fillPath(_painterPath, _brush);
+	if (!_preview.isIdentity()) {
+		painter->setTransform(_preview, true);
+		pen.setWidthF(pen.widthF() / sqrt(fabs(_preview.determinant())));
+		er = _preview.inverted().mapRect(er);
+	}
+
+	qreal pw = pen.widthF();
+	er.adjust(-pw, -pw, pw, pw);
+
+	painter->setPen(pen);
+	for (int i = 0; i < _polygons.size(); i++) {
+		const QPainterPath &path = _polygons.at(i);
+		if (path.controlPointRect().intersects(er)) {
+			painter->drawPath(path);
+			painter->fillPath(path, _brush);
+		}
+	}
 
 /*
 	QPen p = QPen(QBrush(Qt::red), 0);
@@ -89,11 +177,13 @@ void AreaItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
 
 void AreaItem::setMap(Map *map)
 {
+	QRectF rect(mapRect(map));
+
 	prepareGeometryChange();
 
 	_map = map;
-
-	updatePainterPath();
+	_preview *= rectTransform(_mapRect, rect);
+	_mapRect = rect;
 }
 
 void AreaItem::setColor(const QColor &color)
@@ -151,6 +241,8 @@ void AreaItem::setDigitalZoom(int zoom)
 
 	_digitalZoom = zoom;
 	_pen.setWidthF(_width * pow(2, -_digitalZoom));
+
+	setGeometry(geometry());
 }
 
 void AreaItem::hoverEnterEvent(QGraphicsSceneHoverEvent *event)
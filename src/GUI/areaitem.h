@@ -6,20 +6,32 @@
 #include "tooltip.h"
 
 class Map;
+class JobControl;
 
 class AreaItem : public GraphicsItem
 {
 public:
 	AreaItem(const Area &area, Map *map, GraphicsItem *parent = 0);
 
-	QPainterPath shape() const {return _painterPath;}
-	QRectF boundingRect() const {return _painterPath.boundingRect();}
+	QPainterPath shape() const
+	  {return _preview.isIdentity() ? _painterPath
+	  : _preview.map(_painterPath);}
+	QRectF boundingRect() const
+	  {return _preview.mapRect(_painterPath.boundingRect());}
 	void paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
 	  QWidget *widget);
 
 	const Area &area() const {return _area;}
 
+	/* Same two step map change as in PathItem */
+	struct Geometry {
+		QList<QPainterPath> polygons;
+		QPainterPath path;
+	};
+
 	void setMap(Map *map);
+	Geometry geometry(JobControl *control = 0, int generation = 0) const;
+	void setGeometry(const Geometry &geometry);
 
 	void setColor(const QColor &color);
 	void setOpacity(qreal opacity);
@@ -35,11 +47,15 @@ protected:
 	void mousePressEvent(QGraphicsSceneMouseEvent *event);
 
 private:
-	QPainterPath painterPath(const Polygon &polygon);
-	void updatePainterPath();
+	QPainterPath painterPath(const Polygon &polygon,
+	  const QList<QVector<float> > &significance, qreal tolerance,
+	  JobControl *control, int generation) const;
+	qreal tolerance() const;
+	QRectF mapRect(Map *map) const;
 	ToolTip toolTip() const;
 
 	Area _area;
+	QList<QList<QVector<float> > > _significance;
 	Map *_map;
 	int _digitalZoom;
 
@@ -49,6 +65,9 @@ private:
 	qreal _opacity;
 
 	QPainterPath _painterPath;
+	QList<QPainterPath> _polygons;
+	QTransform _preview;
+	QRectF _mapRect;
 };
 
 #endif // AREAITEM_H
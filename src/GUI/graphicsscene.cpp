@@ -4,6 +4,22 @@
 #include "graphicsscene.h"
 
 
+/* Transformation mapping the from rect to the to rect. Degenerated (zero
+   width or height) rects keep the scale of the other dimension. */
+QTransform GraphicsItem::rectTransform(const QRectF &from, const QRectF &to)
+{
+	qreal sx = (from.width() > 0) ? to.width() / from.width() : 0;
+	qreal sy = (from.height() > 0) ? to.height() / from.height() : 0;
+
+	if (sx <= 0)
+		sx = (sy > 0) ? sy : 1.0;
+	if (sy <= 0)
+		sy = sx;
+
+	return QTransform(sx, 0, 0, sy, to.center().x() - from.center().x() * sx,
+	  to.center().y() - from.center().y() * sy);
+}
+
 /* Standard GraphicsScene::items() is not pixel accurate, so we use the
    following function which has the same logic as used in the original
    QGraphicsScene::helpEvent() function. */
@@ -3,6 +3,7 @@
 
 #include <QGraphicsScene>
 #include <QGraphicsItem>
+#include <QTransform>
 
 class GraphicsItem : public QGraphicsItem
 {
@@ -11,6 +12,9 @@ public:
 
 	virtual QString info() const = 0;
 	int type() const {return QGraphicsItem::UserType + 1;}
+
+protected:
+	static QTransform rectTransform(const QRectF &from, const QRectF &to);
 };
 
 class GraphicsScene : public QGraphicsScene
@@ -22,7 +22,6 @@
 #include <QLocale>
 #include <QMimeData>
 #include <QUrl>
-#include <QPixmapCache>
 #ifdef ENABLE_HIDPI
 #include <QWindow>
 #include <QScreen>
@@ -32,8 +31,12 @@
 #include "data/data.h"
 #include "data/poi.h"
 #include "map/maplist.h"
+#include "map/mapcatalog.h"
 #include "map/emptymap.h"
 #include "map/downloader.h"
+#include "map/imgmap.h"
+#include "map/tilecache.h"
+#include "map/tilestore.h"
 #include "icons.h"
 #include "keys.h"
 #include "settings.h"
@@ -53,6 +56,7 @@
 #include "graphitem.h"
 #include "pathitem.h"
 #include "mapaction.h"
+#include "seeddialog.h"
 #include "gui.h"
 
 
@@ -131,12 +135,19 @@ void GUI::createMapActions()
 	if (mapDir.isNull())
 		return;
 
-	QString unused;
-	QList<Map*> maps(MapList::loadMaps(mapDir, unused));
+	MapCatalog *catalog = new MapCatalog(mapDir, this);
+	connect(catalog, SIGNAL(mapAdded(Map*)), this,
+	  SLOT(catalogMapAdded(Map*)));
+	connect(catalog, SIGNAL(mapRemoved(Map*)), this,
+	  SLOT(catalogMapRemoved(Map*)));
+
+	QList<Map*> maps(catalog->maps());
 	for (int i = 0; i < maps.count(); i++) {
 		MapAction *a = createMapAction(maps.at(i));
 		connect(a, SIGNAL(loaded()), this, SLOT(mapInitialized()));
 	}
+
+	catalog->rescan();
 }
 
 MapAction *GUI::createMapAction(Map *map)
@@ -158,6 +169,10 @@ void GUI::mapInitialized()
 	if (map->isValid()) {
 		if (!_mapsActionGroup->checkedAction())
 			action->trigger();
+		/* WMS/WMTS maps know their seed zooms only after the capabilities
+		   have been loaded */
+		else if (map == _map)
+			_seedMapAction->setEnabled(map->seedZooms().isValid());
 		_showMapAction->setEnabled(true);
 		_clearMapCacheAction->setEnabled(true);
 	} else {
@@ -166,6 +181,32 @@ void GUI::mapInitialized()
 	}
 }
 
+void GUI::catalogMapAdded(Map *map)
+{
+	MapAction *a = createMapAction(map);
+	_mapMenu->insertAction(_mapsEnd, a);
+
+	if (map->isReady()) {
+		if (!_mapsActionGroup->checkedAction())
+			a->trigger();
+		_showMapAction->setEnabled(true);
+		_clearMapCacheAction->setEnabled(true);
+	} else
+		connect(a, SIGNAL(loaded()), this, SLOT(mapInitialized()));
+}
+
+void GUI::catalogMapRemoved(Map *map)
+{
+	QList<QAction*> maps = _mapsActionGroup->actions();
+
+	for (int i = 0; i < maps.count(); i++) {
+		if (maps.at(i)->data().value<Map*>() == map) {
+			maps.at(i)->deleteLater();
+			break;
+		}
+	}
+}
+
 void GUI::createPOIFilesActions()
 {
 	_poiFilesSignalMapper = new QSignalMapper(this);
@@ -306,6 +347,10 @@ void GUI::createActions()
 	_clearMapCacheAction->setMenuRole(QAction::NoRole);
 	connect(_clearMapCacheAction, SIGNAL(triggered()), _mapView,
 	  SLOT(clearMapCache()));
+	_seedMapAction = new QAction(tr("Download map area..."), this);
+	_seedMapAction->setEnabled(false);
+	_seedMapAction->setMenuRole(QAction::NoRole);
+	connect(_seedMapAction, SIGNAL(triggered()), this, SLOT(seedMap()));
 	_nextMapAction = new QAction(tr("Next map"), this);
 	_nextMapAction->setMenuRole(QAction::NoRole);
 	_nextMapAction->setShortcut(NEXT_MAP_SHORTCUT);
@@ -514,6 +559,7 @@ void GUI::createMenus()
 	_mapsEnd = _mapMenu->addSeparator();
 	_mapMenu->addAction(_loadMapAction);
 	_mapMenu->addAction(_clearMapCacheAction);
+	_mapMenu->addAction(_seedMapAction);
 	_mapMenu->addSeparator();
 	_mapMenu->addAction(_showCoordinatesAction);
 	_mapMenu->addSeparator();
@@ -751,18 +797,36 @@ void GUI::openFile()
 	  _dataDir, Data::formats());
 	QStringList list = files;
 
-	for (QStringList::Iterator it = list.begin(); it != list.end(); it++)
-		openFile(*it);
+	openFiles(list);
 	if (!list.isEmpty())
 		_dataDir = QFileInfo(list.first()).path();
 }
 
+void GUI::openFiles(const QStringList &files)
+{
+	QStringList list;
+
+	for (int i = 0; i < files.size(); i++)
+		if (!files.at(i).isEmpty() && !_files.contains(files.at(i))
+		  && !list.contains(files.at(i)))
+			list.append(files.at(i));
+
+	QList<Data> data(Data::load(list));
+	for (int i = 0; i < data.size(); i++)
+		openFile(list.at(i), data.at(i));
+}
+
 bool GUI::openFile(const QString &fileName)
 {
 	if (fileName.isEmpty() || _files.contains(fileName))
 		return false;
 
-	if (loadFile(fileName)) {
+	return openFile(fileName, Data(fileName));
+}
+
+bool GUI::openFile(const QString &fileName, const Data &data)
+{
+	if (loadFile(fileName, data)) {
 		_files.append(fileName);
 		_browser->setCurrent(fileName);
 		_fileActionGroup->setEnabled(true);
@@ -781,64 +845,11 @@ bool GUI::openFile(const QString &fileName)
 	}
 }
 
-bool GUI::loadFile(const QString &fileName)
+bool GUI::loadFile(const QString &fileName, const Data &data)
 {
-	Data data(fileName);
-	QList<QList<GraphItem*> > graphs;
-	QList<PathItem*> paths;
-
 	if (data.isValid()) {
-		for (int i = 0; i < data.tracks().count(); i++) {
-			const Track &track = data.tracks().at(i);
-			_trackDistance += track.distance();
-			_time += track.time();
-			_movingTime += track.movingTime();
-#ifdef ENABLE_TIMEZONES
-			const QDateTime date = track.date().toTimeZone(
-			  _options.timeZone.zone());
-#else // ENABLE_TIMEZONES
-			const QDateTime &date = track.date();
-#endif // ENABLE_TIMEZONES
-			if (_dateRange.first.isNull() || _dateRange.first > date)
-				_dateRange.first = date;
-			if (_dateRange.second.isNull() || _dateRange.second < date)
-				_dateRange.second = date;
-		}
-		_trackCount += data.tracks().count();
-
-		for (int i = 0; i < data.routes().count(); i++)
-			_routeDistance += data.routes().at(i).distance();
-		_routeCount += data.routes().count();
-
-		_waypointCount += data.waypoints().count();
-		_areaCount += data.areas().count();
-
-		if (_pathName.isNull()) {
-			if (data.tracks().count() == 1 && !data.routes().count())
-				_pathName = data.tracks().first().name();
-			else if (data.routes().count() == 1 && !data.tracks().count())
-				_pathName = data.routes().first().name();
-		} else
-			_pathName = QString();
-
-		for (int i = 0; i < _tabs.count(); i++)
-			graphs.append(_tabs.at(i)->loadData(data));
-		if (updateGraphTabs())
-			_splitter->refresh();
-		paths = _mapView->loadData(data);
-
-		for (int i = 0; i < paths.count(); i++) {
-			const PathItem *pi = paths.at(i);
-			for (int j = 0; j < graphs.count(); j++) {
-				const GraphItem *gi = graphs.at(j).at(i);
-				if (!gi)
-					continue;
-				connect(gi, SIGNAL(sliderPositionChanged(qreal)), pi,
-				  SLOT(moveMarker(qreal)));
-				connect(pi, SIGNAL(selected(bool)), gi, SLOT(hover(bool)));
-				connect(gi, SIGNAL(selected(bool)), pi, SLOT(hover(bool)));
-			}
-		}
+		loadData(data);
+		_data.append(data);
 
 		return true;
 	} else {
@@ -856,6 +867,64 @@ bool GUI::loadFile(const QString &fileName)
 	}
 }
 
+void GUI::loadData(const Data &data)
+{
+	QList<QList<GraphItem*> > graphs;
+	QList<PathItem*> paths;
+
+	for (int i = 0; i < data.tracks().count(); i++) {
+		const Track &track = data.tracks().at(i);
+		_trackDistance += track.distance();
+		_time += track.time();
+		_movingTime += track.movingTime();
+#ifdef ENABLE_TIMEZONES
+		const QDateTime date = track.date().toTimeZone(
+		  _options.timeZone.zone());
+#else // ENABLE_TIMEZONES
+		const QDateTime &date = track.date();
+#endif // ENABLE_TIMEZONES
+		if (_dateRange.first.isNull() || _dateRange.first > date)
+			_dateRange.first = date;
+		if (_dateRange.second.isNull() || _dateRange.second < date)
+			_dateRange.second = date;
+	}
+	_trackCount += data.tracks().count();
+
+	for (int i = 0; i < data.routes().count(); i++)
+		_routeDistance += data.routes().at(i).distance();
+	_routeCount += data.routes().count();
+
+	_waypointCount += data.waypoints().count();
+	_areaCount += data.areas().count();
+
+	if (_pathName.isNull()) {
+		if (data.tracks().count() == 1 && !data.routes().count())
+			_pathName = data.tracks().first().name();
+		else if (data.routes().count() == 1 && !data.tracks().count())
+			_pathName = data.routes().first().name();
+	} else
+		_pathName = QString();
+
+	for (int i = 0; i < _tabs.count(); i++)
+		graphs.append(_tabs.at(i)->loadData(data));
+	if (updateGraphTabs())
+		_splitter->refresh();
+	paths = _mapView->loadData(data);
+
+	for (int i = 0; i < paths.count(); i++) {
+		const PathItem *pi = paths.at(i);
+		for (int j = 0; j < graphs.count(); j++) {
+			const GraphItem *gi = graphs.at(j).at(i);
+			if (!gi)
+				continue;
+			connect(gi, SIGNAL(sliderPositionChanged(qreal)), pi,
+			  SLOT(moveMarker(qreal)));
+			connect(pi, SIGNAL(selected(bool)), gi, SLOT(hover(bool)));
+			connect(gi, SIGNAL(selected(bool)), pi, SLOT(hover(bool)));
+		}
+	}
+}
+
 void GUI::openPOIFile()
 {
 	QStringList files = QFileDialog::getOpenFileNames(this, tr("Open POI file"),
@@ -983,10 +1052,14 @@ void GUI::openOptions()
 		_poi->setRadius(options.poiRadius);
 
 	if (options.pixmapCache != _options.pixmapCache)
-		QPixmapCache::setCacheLimit(options.pixmapCache * 1024);
+		TileCache::setLimit(options.pixmapCache * 1024 * 1024);
+	if (options.tileStore != _options.tileStore)
+		TileStore::setLimit(options.tileStore * 1024LL * 1024LL);
 
 	if (options.connectionTimeout != _options.connectionTimeout)
 		Downloader::setTimeout(options.connectionTimeout);
+	if (options.vectorCache != _options.vectorCache)
+		IMGMap::useDiskCache(options.vectorCache);
 #ifdef ENABLE_HTTP2
 	if (options.enableHTTP2 != _options.enableHTTP2)
 		Downloader::enableHTTP2(options.enableHTTP2);
@@ -1006,7 +1079,10 @@ void GUI::openOptions()
 #endif // ENABLE_TIMEZONES
 
 	if (reload)
-		reloadFiles();
+		reprocessFiles(options.outlierEliminate != _options.outlierEliminate
+		  || options.automaticPause != _options.automaticPause
+		  || options.pauseSpeed != _options.pauseSpeed
+		  || options.pauseInterval != _options.pauseInterval);
 
 	_options = options;
 }
@@ -1199,7 +1275,7 @@ void GUI::plot(QPrinter *printer)
 	}
 }
 
-void GUI::reloadFiles()
+void GUI::clearData()
 {
 	_trackCount = 0;
 	_routeCount = 0;
@@ -1212,17 +1288,25 @@ void GUI::reloadFiles()
 	_dateRange = DateTimeRange(QDateTime(), QDateTime());
 	_pathName = QString();
 
+	_sliderPos = 0;
+
 	for (int i = 0; i < _tabs.count(); i++)
 		_tabs.at(i)->clear();
 	_mapView->clear();
+}
 
-	_sliderPos = 0;
+void GUI::reloadFiles()
+{
+	QList<Data> data(Data::load(_files));
 
-	for (int i = 0; i < _files.size(); i++) {
-		if (!loadFile(_files.at(i))) {
-			_files.removeAt(i);
-			i--;
-		}
+	clearData();
+	_data.clear();
+
+	for (int i = 0, j = 0; i < data.size(); i++) {
+		if (loadFile(_files.at(j), data.at(i)))
+			j++;
+		else
+			_files.removeAt(j);
 	}
 
 	updateStatusBarInfo();
@@ -1233,26 +1317,29 @@ void GUI::reloadFiles()
 		_browser->setCurrent(_files.last());
 }
 
-void GUI::closeFiles()
+/* The track graph caches are keyed by their filter window, so the tracks
+   are only rebuilt when their segmentation (pause or outlier detection)
+   changes. */
+void GUI::reprocessFiles(bool segmentation)
 {
-	_trackCount = 0;
-	_routeCount = 0;
-	_waypointCount = 0;
-	_areaCount = 0;
-	_trackDistance = 0;
-	_routeDistance = 0;
-	_time = 0;
-	_movingTime = 0;
-	_dateRange = DateTimeRange(QDateTime(), QDateTime());
-	_pathName = QString();
+	clearData();
 
-	_sliderPos = 0;
+	for (int i = 0; i < _data.size(); i++) {
+		if (segmentation)
+			_data[i].reprocess();
+		loadData(_data.at(i));
+	}
 
-	for (int i = 0; i < _tabs.count(); i++)
-		_tabs.at(i)->clear();
-	_mapView->clear();
+	updateStatusBarInfo();
+	updateWindowTitle();
+}
+
+void GUI::closeFiles()
+{
+	clearData();
 
 	_files.clear();
+	_data.clear();
 }
 
 void GUI::closeAll()
@@ -1438,6 +1525,14 @@ void GUI::mapChanged()
 {
 	_map = _mapsActionGroup->checkedAction()->data().value<Map*>();
 	_mapView->setMap(_map);
+	_seedMapAction->setEnabled(_map->seedZooms().isValid());
+}
+
+void GUI::seedMap()
+{
+	SeedDialog dialog(_map, _mapView->viewBounds(), _mapView->dataBounds(),
+	  this);
+	dialog.exec();
 }
 
 void GUI::nextMap()
@@ -1690,8 +1785,11 @@ void GUI::dragEnterEvent(QDragEnterEvent *event)
 void GUI::dropEvent(QDropEvent *event)
 {
 	QList<QUrl> urls = event->mimeData()->urls();
+	QStringList files;
+
 	for (int i = 0; i < urls.size(); i++)
-		openFile(urls.at(i).toLocalFile());
+		files.append(urls.at(i).toLocalFile());
+	openFiles(files);
 
 	event->acceptProposedAction();
 }
@@ -1896,6 +1994,8 @@ void GUI::writeSettings()
 #endif // ENABLE_HTTP2
 	if (_options.pixmapCache != PIXMAP_CACHE_DEFAULT)
 		settings.setValue(PIXMAP_CACHE_SETTING, _options.pixmapCache);
+	if (_options.tileStore != TILE_STORE_DEFAULT)
+		settings.setValue(TILE_STORE_SETTING, _options.tileStore);
 	if (_options.connectionTimeout != CONNECTION_TIMEOUT_DEFAULT)
 		settings.setValue(CONNECTION_TIMEOUT_SETTING, _options.connectionTimeout);
 	if (_options.hiresPrint != HIRES_PRINT_DEFAULT)
@@ -1923,6 +2023,8 @@ void GUI::writeSettings()
 	if (_options.hidpiMap != HIDPI_MAP_DEFAULT)
 		settings.setValue(HIDPI_MAP_SETTING, _options.hidpiMap);
 #endif // ENABLE_HIDPI
+	if (_options.vectorCache != VECTOR_CACHE_DEFAULT)
+		settings.setValue(VECTOR_CACHE_SETTING, _options.vectorCache);
 	settings.endGroup();
 }
 
@@ -2175,6 +2277,8 @@ void GUI::readSettings()
 #endif // ENABLE_HTTP2
 	_options.pixmapCache = settings.value(PIXMAP_CACHE_SETTING,
 	  PIXMAP_CACHE_DEFAULT).toInt();
+	_options.tileStore = settings.value(TILE_STORE_SETTING,
+	  TILE_STORE_DEFAULT).toInt();
 	_options.connectionTimeout = settings.value(CONNECTION_TIMEOUT_SETTING,
 	  CONNECTION_TIMEOUT_DEFAULT).toInt();
 	_options.hiresPrint = settings.value(HIRES_PRINT_SETTING,
@@ -2201,6 +2305,8 @@ void GUI::readSettings()
 	_options.hidpiMap = settings.value(HIDPI_MAP_SETTING, HIDPI_MAP_SETTING)
 	  .toBool();
 #endif // ENABLE_HIDPI
+	_options.vectorCache = settings.value(VECTOR_CACHE_SETTING,
+	  VECTOR_CACHE_DEFAULT).toBool();
 
 	_mapView->setPalette(_options.palette);
 	_mapView->setMapOpacity(_options.mapOpacity);
@@ -2259,7 +2365,8 @@ void GUI::readSettings()
 
 	_poi->setRadius(_options.poiRadius);
 
-	QPixmapCache::setCacheLimit(_options.pixmapCache * 1024);
+	TileCache::setLimit(_options.pixmapCache * 1024 * 1024);
+	TileStore::setLimit(_options.tileStore * 1024LL * 1024LL);
 
 	settings.endGroup();
 }
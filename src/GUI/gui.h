@@ -7,6 +7,7 @@
 #include <QDate>
 #include <QPrinter>
 #include "data/graph.h"
+#include "data/data.h"
 #include "units.h"
 #include "timetype.h"
 #include "format.h"
@@ -38,6 +39,7 @@ public:
 	GUI();
 
 	bool openFile(const QString &fileName);
+	void openFiles(const QStringList &files);
 	void show();
 
 private slots:
@@ -60,6 +62,7 @@ private slots:
 	void showTracks(bool show);
 	void showRoutes(bool show);
 	void loadMap();
+	void seedMap();
 	void nextMap();
 	void prevMap();
 	void openOptions();
@@ -90,6 +93,8 @@ private slots:
 
 	void mapLoaded();
 	void mapInitialized();
+	void catalogMapAdded(Map *map);
+	void catalogMapRemoved(Map *map);
 
 private:
 	typedef QPair<QDateTime, QDateTime> DateTimeRange;
@@ -111,7 +116,11 @@ private:
 	void createBrowser();
 
 	bool openPOIFile(const QString &fileName);
-	bool loadFile(const QString &fileName);
+	bool openFile(const QString &fileName, const Data &data);
+	bool loadFile(const QString &fileName, const Data &data);
+	void loadData(const Data &data);
+	void reprocessFiles(bool segmentation);
+	void clearData();
 	bool loadMap(const QString &fileName);
 	void exportFile(const QString &fileName);
 	void updateStatusBarInfo();
@@ -167,6 +176,7 @@ private:
 	QAction *_fullscreenAction;
 	QAction *_loadMapAction;
 	QAction *_clearMapCacheAction;
+	QAction *_seedMapAction;
 	QAction *_showGraphsAction;
 	QAction *_showGraphGridAction;
 	QAction *_showGraphSliderInfoAction;
@@ -216,6 +226,7 @@ private:
 
 	FileBrowser *_browser;
 	QList<QString> _files;
+	QList<Data> _data;
 
 	int _trackCount, _routeCount, _areaCount, _waypointCount;
 	qreal _trackDistance, _routeDistance;
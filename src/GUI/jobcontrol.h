@@ -0,0 +1,43 @@
+#ifndef JOBCONTROL_H
+#define JOBCONTROL_H
+
+#include <QReadWriteLock>
+
+/* Cancellation of the path/area geometry computations running in worker
+   threads. A computation holds the read lock while it accesses the items and
+   the map and releases it regularly in checkpoint(). cancel() takes the write
+   lock, so once it returns no computation of an older generation touches the
+   items or the map anymore, without the need to wait for the jobs to end. */
+class JobControl
+{
+public:
+	JobControl() : _generation(0) {}
+
+	int generation() const {return _generation;}
+	void cancel()
+	{
+		_lock.lockForWrite();
+		_generation++;
+		_lock.unlock();
+	}
+
+	/* The lock is always taken, the return value tells whether the
+	   computation is still wanted. */
+	bool lock(int generation)
+	{
+		_lock.lockForRead();
+		return (generation == _generation);
+	}
+	void unlock() {_lock.unlock();}
+	bool checkpoint(int generation)
+	{
+		unlock();
+		return lock(generation);
+	}
+
+private:
+	QReadWriteLock _lock;
+	int _generation;
+};
+
+#endif // JOBCONTROL_H
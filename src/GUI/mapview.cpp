@@ -3,6 +3,13 @@
 #include <QWheelEvent>
 #include <QApplication>
 #include <QScrollBar>
+#include <QTimer>
+#include <QRunnable>
+#if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
+#include <QtCore>
+#else // QT_VERSION < 5
+#include <QtConcurrent>
+#endif // QT_VERSION < 5
 #include "data/poi.h"
 #include "data/data.h"
 #include "map/map.h"
@@ -25,6 +32,88 @@
 #define SCALE_OFFSET     7
 #define COORDINATES_OFFSET SCALE_OFFSET
 
+#define PREFETCH_DELAY     100 /* ms */
+#define PREFETCH_LOOKAHEAD 1000 /* ms */
+#define PREFETCH_MARGIN    128 /* px */
+#define SCROLL_TIMEOUT     300 /* ms */
+
+
+/* Computes the exact geometry of a path/area item for the current map. Until
+   the result is applied in the GUI thread, the items show their previous
+   geometry scaled to the new map. */
+class RescaleJob
+{
+public:
+	RescaleJob() : _applied(false) {}
+	virtual ~RescaleJob() {}
+
+	void finish()
+	{
+		if (!_applied) {
+			apply();
+			_applied = true;
+		}
+	}
+
+	virtual void compute(JobControl *control, int generation) = 0;
+
+protected:
+	virtual void apply() = 0;
+
+private:
+	bool _applied;
+};
+
+template <class T>
+class ItemRescaleJob : public RescaleJob
+{
+public:
+	ItemRescaleJob(T *item) : _item(item) {}
+
+	void compute(JobControl *control, int generation)
+	  {_geometry = _item->geometry(control, generation);}
+
+protected:
+	void apply() {_item->setGeometry(_geometry);}
+
+private:
+	T *_item;
+	typename T::Geometry _geometry;
+};
+
+/* Runs a job in the thread pool. The job itself is owned by the view and
+   deleted once its (possibly canceled) computation has been reported back. */
+class RescaleRunner : public QRunnable
+{
+public:
+	RescaleRunner(RescaleJob *job, MapView *view, JobControl *control,
+	  int generation, int index) : _job(job), _view(view), _control(control),
+	  _generation(generation), _index(index) {}
+
+	void run()
+	{
+		/* Jobs of a canceled rescale are not computed at all */
+		if (_control->lock(_generation))
+			_job->compute(_control, _generation);
+		_control->unlock();
+
+		QMetaObject::invokeMethod(_view, "jobFinished", Qt::QueuedConnection,
+		  Q_ARG(int, _generation), Q_ARG(int, _index));
+	}
+
+private:
+	RescaleJob *_job;
+	MapView *_view;
+	JobControl *_control;
+	int _generation;
+	int _index;
+};
+
+static void computeJob(RescaleJob *job)
+{
+	job->compute(0, 0);
+}
+
 
 MapView::MapView(Map *map, POI *poi, QWidget *parent)
   : QGraphicsView(parent)
@@ -56,6 +145,11 @@ MapView::MapView(Map *map, POI *poi, QWidget *parent)
 	_map->setProjection(_projection);
 	connect(_map, SIGNAL(tilesLoaded()), this, SLOT(reloadMap()));
 
+	_prefetchTimer = new QTimer(this);
+	_prefetchTimer->setSingleShot(true);
+	_prefetchTimer->setInterval(PREFETCH_DELAY);
+	connect(_prefetchTimer, SIGNAL(timeout()), this, SLOT(prefetch()));
+
 	_poi = poi;
 	connect(_poi, SIGNAL(pointsChanged()), this, SLOT(updatePOI()));
 
@@ -98,6 +192,16 @@ MapView::MapView(Map *map, POI *poi, QWidget *parent)
 	centerOn(_scene->sceneRect().center());
 }
 
+MapView::~MapView()
+{
+	_control.cancel();
+	_pool.waitForDone();
+
+	for (JobMap::const_iterator it = _jobs.constBegin();
+	  it != _jobs.constEnd(); ++it)
+		qDeleteAll(it->jobs);
+}
+
 void MapView::centerOn(const QPointF &pos)
 {
 	QGraphicsView::centerOn(pos);
@@ -221,10 +325,14 @@ QList<PathItem *> MapView::loadData(const Data &data)
 	  && _areas.empty())
 		return paths;
 
+	bool pending = cancelJobs();
 	if (fitMapZoom() != zoom)
 		rescale();
-	else
+	else {
 		updatePOIVisibility();
+		if (pending)
+			startJobs();
+	}
 
 	centerOn(contentCenter());
 
@@ -274,6 +382,16 @@ void MapView::rescale()
 	_scene->setSceneRect(_map->bounds());
 	reloadMap();
 
+	_scrollTime.invalidate();
+	schedulePrefetch();
+
+	rescaleItems();
+}
+
+/* Waypoints and POIs are moved synchronously, only the paths and areas are
+   left to the geometry jobs. */
+void MapView::rescaleItems()
+{
 	for (int i = 0; i < _tracks.size(); i++)
 		_tracks.at(i)->setMap(_map);
 	for (int i = 0; i < _routes.size(); i++)
@@ -286,8 +404,96 @@ void MapView::rescale()
 	for (POIHash::const_iterator it = _pois.constBegin();
 	  it != _pois.constEnd(); it++)
 		it.value()->setMap(_map);
-
 	updatePOIVisibility();
+
+	startJobs();
+}
+
+QList<RescaleJob*> MapView::createJobs()
+{
+	QList<RescaleJob*> jobs;
+
+	for (int i = 0; i < _tracks.size(); i++)
+		jobs.append(new ItemRescaleJob<PathItem>(_tracks.at(i)));
+	for (int i = 0; i < _routes.size(); i++)
+		jobs.append(new ItemRescaleJob<PathItem>(_routes.at(i)));
+	for (int i = 0; i < _areas.size(); i++)
+		jobs.append(new ItemRescaleJob<AreaItem>(_areas.at(i)));
+
+	return jobs;
+}
+
+void MapView::computeJobs()
+{
+	QList<RescaleJob*> jobs(createJobs());
+
+	QFuture<void> future = QtConcurrent::map(jobs, computeJob);
+	future.waitForFinished();
+
+	for (int i = 0; i < jobs.size(); i++)
+		jobs.at(i)->finish();
+	qDeleteAll(jobs);
+}
+
+void MapView::startJobs()
+{
+	cancelJobs();
+
+	/* Plotting needs the exact geometry right away */
+	if (_plot) {
+		computeJobs();
+		return;
+	}
+
+	int generation = _control.generation();
+	Jobs &jobs = _jobs[generation];
+	jobs.jobs = createJobs();
+	jobs.pending = jobs.jobs.size();
+	if (!jobs.pending) {
+		_jobs.remove(generation);
+		return;
+	}
+
+	for (int i = 0; i < jobs.jobs.size(); i++)
+		_pool.start(new RescaleRunner(jobs.jobs.at(i), this, &_control,
+		  generation, i));
+}
+
+/* Stops the running geometry jobs, must be called before any change of the
+   map or the path/area items. Does not wait for the jobs, the canceled ones
+   report back to jobFinished() where they get deleted. Returns true if some
+   jobs were left unfinished, i.e. some items may still show the scaled
+   geometry. */
+bool MapView::cancelJobs()
+{
+	bool pending = _jobs.contains(_control.generation());
+
+	_control.cancel();
+
+	return pending;
+}
+
+/* Applies the exact geometry of all the items, the unfinished jobs are
+   canceled and the geometry is recomputed right away */
+void MapView::finishJobs()
+{
+	if (cancelJobs())
+		computeJobs();
+}
+
+void MapView::jobFinished(int generation, int index)
+{
+	JobMap::iterator it = _jobs.find(generation);
+	if (it == _jobs.end())
+		return;
+
+	if (generation == _control.generation())
+		it->jobs.at(index)->finish();
+
+	if (!--it->pending) {
+		qDeleteAll(it->jobs);
+		_jobs.erase(it);
+	}
 }
 
 void MapView::setPalette(const Palette &palette)
@@ -305,10 +511,13 @@ void MapView::setPalette(const Palette &palette)
 
 void MapView::setMap(Map *map)
 {
+	cancelJobs();
+
 	QRectF vr(mapToScene(viewport()->rect()).boundingRect()
 	  .intersected(_map->bounds()));
 	RectC cr(_map->xy2ll(vr.topLeft()), _map->xy2ll(vr.bottomRight()));
 
+	_map->cancelPrefetch();
 	_map->unload();
 	disconnect(_map, SIGNAL(tilesLoaded()), this, SLOT(reloadMap()));
 
@@ -325,25 +534,14 @@ void MapView::setMap(Map *map)
 	_map->zoomFit(viewport()->rect().size(), cr);
 	_scene->setSceneRect(_map->bounds());
 
-	for (int i = 0; i < _tracks.size(); i++)
-		_tracks.at(i)->setMap(map);
-	for (int i = 0; i < _routes.size(); i++)
-		_routes.at(i)->setMap(map);
-	for (int i = 0; i < _areas.size(); i++)
-		_areas.at(i)->setMap(map);
-	for (int i = 0; i < _waypoints.size(); i++)
-		_waypoints.at(i)->setMap(map);
-
-	for (POIHash::const_iterator it = _pois.constBegin();
-	  it != _pois.constEnd(); it++)
-		it.value()->setMap(_map);
-	updatePOIVisibility();
+	rescaleItems();
 
 	QPointF nc = QRectF(_map->ll2xy(cr.topLeft()),
 	  _map->ll2xy(cr.bottomRight())).center();
 	centerOn(nc);
 
 	reloadMap();
+	schedulePrefetch();
 }
 
 void MapView::setPOI(POI *poi)
@@ -431,6 +629,14 @@ void MapView::setTimeZone(const QTimeZone &zone)
 #endif // ENABLE_TIMEZONES
 }
 
+RectC MapView::viewBounds()
+{
+	QRectF vr(mapToScene(viewport()->rect()).boundingRect()
+	  .intersected(_map->bounds()));
+
+	return RectC(_map->xy2ll(vr.topLeft()), _map->xy2ll(vr.bottomRight()));
+}
+
 void MapView::clearMapCache()
 {
 	_map->clearCache();
@@ -439,6 +645,8 @@ void MapView::clearMapCache()
 
 void MapView::digitalZoom(int zoom)
 {
+	bool pending = cancelJobs();
+
 	if (zoom) {
 		_digitalZoom += zoom;
 		scale(pow(2, zoom), pow(2, zoom));
@@ -461,6 +669,9 @@ void MapView::digitalZoom(int zoom)
 
 	_mapScale->setDigitalZoom(_digitalZoom);
 	_coordinates->setDigitalZoom(_digitalZoom);
+
+	if (pending)
+		startJobs();
 }
 
 void MapView::zoom(int zoom, const QPoint &pos)
@@ -477,12 +688,15 @@ void MapView::zoom(int zoom, const QPoint &pos)
 	} else {
 		Coordinates c = _map->xy2ll(mapToScene(pos));
 		int oz = _map->zoom();
+		bool pending = cancelJobs();
 		int nz = (zoom > 0) ? _map->zoomIn() : _map->zoomOut();
 
 		if (nz != oz) {
 			rescale();
 			centerOn(_map->ll2xy(c) - (pos - viewport()->rect().center()));
 		} else {
+			if (pending)
+				startJobs();
 			if (shift)
 				digitalZoom(zoom);
 		}
@@ -540,6 +754,7 @@ void MapView::plot(QPainter *painter, const QRectF &target, qreal scale,
 
 
 	// Enter plot mode
+	finishJobs();
 	setUpdatesEnabled(false);
 	_plot = true;
 #ifdef ENABLE_HIDPI
@@ -612,6 +827,8 @@ void MapView::plot(QPainter *painter, const QRectF &target, qreal scale,
 
 void MapView::clear()
 {
+	cancelJobs();
+
 	_pois.clear();
 	_tracks.clear();
 	_routes.clear();
@@ -717,6 +934,8 @@ void MapView::showTicks(bool show)
 void MapView::showMap(bool show)
 {
 	_showMap = show;
+	if (!show)
+		_map->cancelPrefetch();
 	reloadMap();
 }
 
@@ -899,6 +1118,18 @@ void MapView::scrollContentsBy(int dx, int dy)
 {
 	QGraphicsView::scrollContentsBy(dx, dy);
 
+	/* Smoothed scroll velocity in scene pixels per ms, the view moves in the
+	   opposite direction than the content. */
+	if (_scrollTime.isValid() && _scrollTime.elapsed() < SCROLL_TIMEOUT) {
+		qreal ms = qMax(_scrollTime.restart(), (qint64)1) * transform().m11();
+		QPointF v(-dx / ms, -dy / ms);
+		_scrollVelocity = (_scrollVelocity + v) / 2;
+	} else {
+		_scrollTime.start();
+		_scrollVelocity = QPointF();
+	}
+	schedulePrefetch();
+
 	QRectF sr(mapToScene(viewport()->rect()).boundingRect());
 	qreal res = _map->resolution(sr);
 
@@ -952,6 +1183,31 @@ void MapView::reloadMap()
 	_scene->invalidate();
 }
 
+void MapView::schedulePrefetch()
+{
+	if (!_prefetchTimer->isActive())
+		_prefetchTimer->start();
+}
+
+/* Prefetch the area where the view is heading to (based on the recent scroll
+   velocity) and let the map warm up the neighbouring zoom levels. */
+void MapView::prefetch()
+{
+	if (!_showMap || _plot)
+		return;
+
+	QRectF vr(mapToScene(viewport()->rect()).boundingRect());
+	QPointF v((_scrollTime.isValid() && _scrollTime.elapsed() < SCROLL_TIMEOUT)
+	  ? _scrollVelocity : QPointF());
+	QPointF shift(qBound(-vr.width(), v.x() * PREFETCH_LOOKAHEAD, vr.width()),
+	  qBound(-vr.height(), v.y() * PREFETCH_LOOKAHEAD, vr.height()));
+	QRectF ahead(vr.translated(shift).adjusted(-PREFETCH_MARGIN,
+	  -PREFETCH_MARGIN, PREFETCH_MARGIN, PREFETCH_MARGIN));
+
+	_map->prefetch(vr.intersected(_map->bounds()),
+	  ahead.intersected(_map->bounds()));
+}
+
 void MapView::setDevicePixelRatio(qreal deviceRatio, qreal mapRatio)
 {
 #ifdef ENABLE_HIDPI
@@ -961,6 +1217,8 @@ void MapView::setDevicePixelRatio(qreal deviceRatio, qreal mapRatio)
 	_deviceRatio = deviceRatio;
 	_mapRatio = mapRatio;
 
+	cancelJobs();
+
 	QRectF vr(mapToScene(viewport()->rect()).boundingRect()
 	  .intersected(_map->bounds()));
 	RectC cr(_map->xy2ll(vr.topLeft()), _map->xy2ll(vr.bottomRight()));
@@ -968,19 +1226,7 @@ void MapView::setDevicePixelRatio(qreal deviceRatio, qreal mapRatio)
 	_map->setDevicePixelRatio(_deviceRatio, _mapRatio);
 	_scene->setSceneRect(_map->bounds());
 
-	for (int i = 0; i < _tracks.size(); i++)
-		_tracks.at(i)->setMap(_map);
-	for (int i = 0; i < _routes.size(); i++)
-		_routes.at(i)->setMap(_map);
-	for (int i = 0; i < _areas.size(); i++)
-		_areas.at(i)->setMap(_map);
-	for (int i = 0; i < _waypoints.size(); i++)
-		_waypoints.at(i)->setMap(_map);
-
-	for (POIHash::const_iterator it = _pois.constBegin();
-	  it != _pois.constEnd(); it++)
-		it.value()->setMap(_map);
-	updatePOIVisibility();
+	rescaleItems();
 
 	QPointF nc = QRectF(_map->ll2xy(cr.topLeft()),
 	  _map->ll2xy(cr.bottomRight())).center();
@@ -1006,6 +1252,7 @@ void MapView::setProjection(int id)
 	else
 		qWarning("%d: Unknown PCS/GCS id", id);
 
+	cancelJobs();
 	_map->setProjection(_projection);
 	rescale();
 	centerOn(_map->ll2xy(center));
@@ -1014,8 +1261,12 @@ void MapView::setProjection(int id)
 void MapView::fitContentToSize()
 {
 	int zoom = _map->zoom();
+	bool pending = cancelJobs();
+
 	if (fitMapZoom() != zoom)
 		rescale();
+	else if (pending)
+		startJobs();
 
 	centerOn(contentCenter());
 }
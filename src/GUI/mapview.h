@@ -2,15 +2,19 @@
 #define MAPVIEW_H
 
 #include <QGraphicsView>
+#include <QElapsedTimer>
 #include <QVector>
 #include <QHash>
+#include <QMap>
 #include <QList>
+#include <QThreadPool>
 #include "common/rectc.h"
 #include "common/config.h"
 #include "data/waypoint.h"
 #include "data/polygon.h"
 #include "map/projection.h"
 #include "searchpointer.h"
+#include "jobcontrol.h"
 #include "units.h"
 #include "format.h"
 #include "palette.h"
@@ -32,6 +36,8 @@ class AreaItem;
 class Area;
 class GraphicsScene;
 class QTimeZone;
+class QTimer;
+class RescaleJob;
 
 class MapView : public QGraphicsView
 {
@@ -39,6 +45,7 @@ class MapView : public QGraphicsView
 
 public:
 	MapView(Map *map, POI *poi, QWidget *parent = 0);
+	~MapView();
 
 	QList<PathItem *> loadData(const Data &data);
 
@@ -50,6 +57,9 @@ public:
 
 	void clear();
 
+	RectC viewBounds();
+	RectC dataBounds() const {return _tr | _rr | _wr | _ar;}
+
 	void setUnits(Units units);
 	void setMarkerColor(const QColor &color);
 	void setTrackWidth(int width);
@@ -93,8 +103,11 @@ public slots:
 private slots:
 	void updatePOI();
 	void reloadMap();
+	void prefetch();
+	void jobFinished(int generation, int index);
 
 private:
+
 	typedef QHash<SearchPointer<Waypoint>, WaypointItem*> POIHash;
 
 	PathItem *addTrack(const Track &track);
@@ -108,9 +121,16 @@ private:
 	int fitMapZoom() const;
 	QPointF contentCenter() const;
 	void rescale();
+	void rescaleItems();
+	QList<RescaleJob*> createJobs();
+	void computeJobs();
+	void startJobs();
+	bool cancelJobs();
+	void finishJobs();
 	void centerOn(const QPointF &pos);
 	void zoom(int zoom, const QPoint &pos);
 	void digitalZoom(int zoom);
+	void schedulePrefetch();
 	void updatePOIVisibility();
 	void skipColor() {_palette.nextColor();}
 
@@ -155,6 +175,22 @@ private:
 	int _digitalZoom;
 	bool _plot;
 
+	struct Jobs {
+		Jobs() : pending(0) {}
+
+		QList<RescaleJob*> jobs;
+		int pending;
+	};
+	typedef QMap<int, Jobs> JobMap;
+
+	QThreadPool _pool;
+	JobControl _control;
+	JobMap _jobs;
+
+	QTimer *_prefetchTimer;
+	QElapsedTimer _scrollTime;
+	QPointF _scrollVelocity;
+
 #ifdef ENABLE_HIDPI
 	qreal _deviceRatio;
 	qreal _mapRatio;
@@ -57,6 +57,8 @@ QWidget *OptionsDialog::createMapPage()
 		_projection->addItem(text, QVariant(projections.at(i).key()));
 	}
 	_projection->setCurrentIndex(_projection->findData(_options->projection));
+	_vectorCache = new QCheckBox(tr("Cache rendered tiles on disk"));
+	_vectorCache->setChecked(_options->vectorCache);
 
 #ifdef ENABLE_HIDPI
 	_hidpi = new QRadioButton(tr("High-resolution"));
@@ -79,6 +81,7 @@ QWidget *OptionsDialog::createMapPage()
 
 	QFormLayout *vectorLayout = new QFormLayout();
 	vectorLayout->addRow(tr("Projection:"), _projection);
+	vectorLayout->addRow(_vectorCache);
 
 	QWidget *vectorMapsTab = new QWidget();
 	QVBoxLayout *vectorMapsTabLayout = new QVBoxLayout();
@@ -645,6 +648,13 @@ QWidget *OptionsDialog::createSystemPage()
 	_pixmapCache->setSuffix(UNIT_SPACE + tr("MB"));
 	_pixmapCache->setValue(_options->pixmapCache);
 
+	_tileStore = new QSpinBox();
+	_tileStore->setMinimum(64);
+	_tileStore->setMaximum(16384);
+	_tileStore->setSingleStep(64);
+	_tileStore->setSuffix(UNIT_SPACE + tr("MB"));
+	_tileStore->setValue(_options->tileStore);
+
 	_connectionTimeout = new QSpinBox();
 	_connectionTimeout->setMinimum(30);
 	_connectionTimeout->setMaximum(120);
@@ -653,6 +663,7 @@ QWidget *OptionsDialog::createSystemPage()
 
 	QFormLayout *formLayout = new QFormLayout();
 	formLayout->addRow(tr("Image cache size:"), _pixmapCache);
+	formLayout->addRow(tr("Map tiles storage size:"), _tileStore);
 	formLayout->addRow(tr("Connection timeout:"), _connectionTimeout);
 
 	QFormLayout *checkboxLayout = new QFormLayout();
@@ -755,6 +766,7 @@ void OptionsDialog::accept()
 #ifdef ENABLE_HIDPI
 	_options->hidpiMap = _hidpi->isChecked();
 #endif // ENABLE_HIDPI
+	_options->vectorCache = _vectorCache->isChecked();
 
 	_options->elevationFilter = _elevationFilter->value();
 	_options->speedFilter = _speedFilter->value();
@@ -792,6 +804,7 @@ void OptionsDialog::accept()
 	_options->enableHTTP2 = _enableHTTP2->isChecked();
 #endif // ENABLE_HTTP2
 	_options->pixmapCache = _pixmapCache->value();
+	_options->tileStore = _tileStore->value();
 	_options->connectionTimeout = _connectionTimeout->value();
 
 	_options->hiresPrint = _hires->isChecked();
@@ -46,6 +46,7 @@ struct Options {
 #ifdef ENABLE_HIDPI
 	bool hidpiMap;
 #endif // ENABLE_HIDPI
+	bool vectorCache;
 	// Data
 	int elevationFilter;
 	int speedFilter;
@@ -71,6 +72,7 @@ struct Options {
 	bool enableHTTP2;
 #endif // ENABLE_HTTP2
 	int pixmapCache;
+	int tileStore;
 	int connectionTimeout;
 	// Print/Export
 	bool hiresPrint;
@@ -134,6 +136,7 @@ private:
 	QRadioButton *_hidpi;
 	QRadioButton *_lodpi;
 #endif // ENABLE_HIDPI
+	QCheckBox *_vectorCache;
 	// Data
 	OddSpinBox *_elevationFilter;
 	OddSpinBox *_speedFilter;
@@ -161,6 +164,7 @@ private:
 	QDoubleSpinBox *_poiRadius;
 	// System
 	QSpinBox *_pixmapCache;
+	QSpinBox *_tileStore;
 	QSpinBox *_connectionTimeout;
 	QCheckBox *_useOpenGL;
 #ifdef ENABLE_HTTP2
@@ -2,14 +2,20 @@
 #include <QCursor>
 #include <QPainter>
 #include <QGraphicsSceneMouseEvent>
+#include <QStyleOptionGraphicsItem>
 #include "common/greatcircle.h"
+#include "common/simplify.h"
 #include "map/map.h"
+#include "jobcontrol.h"
 #include "pathtickitem.h"
 #include "popup.h"
 #include "pathitem.h"
 
 
 #define GEOGRAPHICAL_MILE 1855.3248
+#define SIMPLIFY_TOLERANCE 0.5 /* px */
+#define CHUNK_SIZE         256 /* path elements */
+#define PROJECT_BATCH      4096 /* points */
 
 static inline bool isValid(const QPointF &p)
 {
@@ -38,8 +44,16 @@ PathItem::PathItem(const Path &path, Map *map, QGraphicsItem *parent)
 	_showMarker = true;
 	_showTicks = false;
 
-	updatePainterPath();
-	updateShape();
+	for (int i = 0; i < _path.size(); i++) {
+		const PathSegment &segment = _path.at(i);
+		QVector<Coordinates> points(segment.size());
+		for (int j = 0; j < segment.size(); j++)
+			points[j] = segment.at(j).coordinates();
+		_significance.append(Simplify::significance(points));
+	}
+
+	_mapRect = mapRect(_map);
+	setGeometry(geometry());
 	updateTicks();
 
 	_markerDistance = _path.first().first().distance();
@@ -49,16 +63,44 @@ PathItem::PathItem(const Path &path, Map *map, QGraphicsItem *parent)
 
 	setCursor(Qt::ArrowCursor);
 	setAcceptHoverEvents(true);
+	setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+}
+
+/* Map coordinates of the path bounding box. The map zoom may change in place,
+   so the rect of the current geometry is tracked separately. */
+QRectF PathItem::mapRect(Map *map) const
+{
+	RectC br(_path.boundingRect());
+	return QRectF(map->ll2xy(br.topLeft()), map->ll2xy(br.bottomRight()))
+	  .normalized();
+}
+
+qreal PathItem::shapeWidth() const
+{
+	return (_width + 1) * pow(2, -_digitalZoom);
 }
 
-void PathItem::updateShape()
+/* The shape is only needed for hit testing, so it is created lazily */
+QPainterPath PathItem::shape() const
 {
-	QPainterPathStroker s;
-	s.setWidth((_width + 1) * pow(2, -_digitalZoom));
-	_shape = s.createStroke(_painterPath);
+	if (_shape.isEmpty()) {
+		QPainterPathStroker s;
+		s.setWidth(shapeWidth());
+		_shape = s.createStroke(_painterPath);
+	}
+
+	return _preview.isIdentity() ? _shape : _preview.map(_shape);
 }
 
-void PathItem::addSegment(const Coordinates &c1, const Coordinates &c2)
+QRectF PathItem::boundingRect() const
+{
+	qreal m = shapeWidth();
+	return _preview.mapRect(_painterPath.boundingRect()).adjusted(-m, -m, m,
+	  m);
+}
+
+static void addSegment(QPainterPath &path, const Coordinates &c1,
+  const Coordinates &c2, const QPointF &p2, Map *map)
 {
 	if (fabs(c1.lon() - c2.lon()) > 180.0) {
 		// Split segment on date line crossing
@@ -69,57 +111,141 @@ void PathItem::addSegment(const Coordinates &c1, const Coordinates &c2)
 			  c2.lat()));
 			QLineF dl(QPointF(180, -90), QPointF(180, 90));
 			l.intersect(dl, &p);
-			_painterPath.lineTo(_map->ll2xy(Coordinates(180, p.y())));
-			_painterPath.moveTo(_map->ll2xy(Coordinates(-180, p.y())));
+			path.lineTo(map->ll2xy(Coordinates(180, p.y())));
+			path.moveTo(map->ll2xy(Coordinates(-180, p.y())));
 		} else {
 			QLineF l(QPointF(c1.lon(), c1.lat()), QPointF(c2.lon() - 360,
 			  c2.lat()));
 			QLineF dl(QPointF(-180, -90), QPointF(-180, 90));
 			l.intersect(dl, &p);
-			_painterPath.lineTo(_map->ll2xy(Coordinates(-180, p.y())));
-			_painterPath.moveTo(_map->ll2xy(Coordinates(180, p.y())));
+			path.lineTo(map->ll2xy(Coordinates(-180, p.y())));
+			path.moveTo(map->ll2xy(Coordinates(180, p.y())));
 		}
-		_painterPath.lineTo(_map->ll2xy(c2));
+		path.lineTo(p2);
 	} else
-		_painterPath.lineTo(_map->ll2xy(c2));
+		path.lineTo(p2);
 }
 
-void PathItem::updatePainterPath()
+/* Zoom-dependent simplification tolerance in meters */
+qreal PathItem::tolerance() const
 {
-	_painterPath = QPainterPath();
+	qreal res = _map->resolution(mapRect(_map));
+
+	return std::isfinite(res)
+	  ? res * pow(2, -_digitalZoom) * SIMPLIFY_TOLERANCE : 0;
+}
+
+PathItem::Geometry PathItem::geometry(JobControl *control, int generation)
+  const
+{
+	qreal tol = tolerance();
+	Geometry geometry;
+	QPainterPath path;
+	QVector<int> idx;
+	QVector<Coordinates> ll;
+	QVector<QPointF> xy;
 
 	for (int i = 0; i < _path.size(); i++) {
 		const PathSegment &segment = _path.at(i);
-		_painterPath.moveTo(_map->ll2xy(segment.first().coordinates()));
+		const QVector<float> &significance = _significance.at(i);
+
+		/* Project all the points left after the simplification at once */
+		idx.resize(0);
+		ll.resize(0);
+		for (int j = 0; j < segment.size(); j++) {
+			if (j && significance.at(j) < tol)
+				continue;
+			idx.append(j);
+			ll.append(segment.at(j).coordinates());
+		}
+		xy.resize(ll.size());
+		for (int j = 0; j < ll.size(); j += PROJECT_BATCH) {
+			if (control && !control->checkpoint(generation))
+				return geometry;
+			_map->ll2xy(ll.constData() + j, xy.data() + j,
+			  qMin(PROJECT_BATCH, ll.size() - j));
+		}
 
-		for (int j = 1; j < segment.size(); j++) {
-			const PathPoint &p1 = segment.at(j-1);
-			const PathPoint &p2 = segment.at(j);
+		path.moveTo(xy.first());
+
+		for (int k = 1; k < idx.size(); k++) {
+			const PathPoint &p1 = segment.at(idx.at(k-1));
+			const PathPoint &p2 = segment.at(idx.at(k));
 			unsigned n = segments(p2.distance() - p1.distance());
 
 			if (n > 1) {
 				GreatCircle gc(p1.coordinates(), p2.coordinates());
-				Coordinates last = p1.coordinates();
+				Coordinates c1 = p1.coordinates();
 
-				for (unsigned k = 1; k <= n; k++) {
-					Coordinates c(gc.pointAt(k/(double)n));
-					addSegment(last, c);
-					last = c;
+				for (unsigned l = 1; l <= n; l++) {
+					Coordinates c2(gc.pointAt(l/(double)n));
+					addSegment(path, c1, c2, _map->ll2xy(c2), _map);
+					c1 = c2;
 				}
 			} else
-				addSegment(p1.coordinates(), p2.coordinates());
+				addSegment(path, p1.coordinates(), p2.coordinates(),
+				  xy.at(k), _map);
+
+			/* Split the path into chunks, so that only the visible parts
+			   have to be drawn */
+			if (path.elementCount() >= CHUNK_SIZE) {
+				QPointF cp(path.currentPosition());
+				geometry.chunks.append(path);
+				path = QPainterPath();
+				path.moveTo(cp);
+
+				if (control && !control->checkpoint(generation))
+					return geometry;
+			}
 		}
 	}
+	if (path.elementCount() > 1)
+		geometry.chunks.append(path);
+
+	for (int i = 0; i < geometry.chunks.size(); i++)
+		geometry.path.addPath(geometry.chunks.at(i));
+
+	return geometry;
+}
+
+void PathItem::setGeometry(const Geometry &geometry)
+{
+	prepareGeometryChange();
+
+	_chunks = geometry.chunks;
+	_painterPath = geometry.path;
+	_shape = QPainterPath();
+	_preview.reset();
 }
 
 void PathItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
 	  QWidget *widget)
 {
-	Q_UNUSED(option);
 	Q_UNUSED(widget);
+	QPen pen(_pen);
+	QRectF er(option->exposedRect);
+
+	/* Geometry of the previous map scaled to the current one, the pen width
+	   must not be scaled */
+	if (!_preview.isIdentity()) {
+		painter->setTransform(_preview, true);
+		pen.setWidthF(pen.widthF() / sqrt(fabs(_preview.determinant())));
+		er = _preview.inverted().mapRect(er);
+	}
+
+	painter->setPen(pen);
 
-	painter->setPen(_pen);
-	painter->drawPath(_painterPath);
+	/* Chunks would restart the dash pattern, so only solid lines are
+	   culled */
+	if (pen.style() == Qt::SolidLine) {
+		qreal pw = pen.widthF();
+		er.adjust(-pw, -pw, pw, pw);
+
+		for (int i = 0; i < _chunks.size(); i++)
+			if (_chunks.at(i).controlPointRect().intersects(er))
+				painter->drawPath(_chunks.at(i));
+	} else
+		painter->drawPath(_painterPath);
 
 /*
 	painter->setPen(Qt::red);
@@ -129,12 +255,14 @@ void PathItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
 
 void PathItem::setMap(Map *map)
 {
+	QRectF rect(mapRect(map));
+
 	prepareGeometryChange();
 
 	_map = map;
+	_preview *= rectTransform(_mapRect, rect);
+	_mapRect = rect;
 
-	updatePainterPath();
-	updateShape();
 	updateTicks();
 
 	QPointF pos = position(_markerDistance);
@@ -164,8 +292,7 @@ void PathItem::setWidth(qreal width)
 
 	_width = width;
 	_pen.setWidthF(_width * pow(2, -_digitalZoom));
-
-	updateShape();
+	_shape = QPainterPath();
 }
 
 void PathItem::setStyle(Qt::PenStyle style)
@@ -188,7 +315,7 @@ void PathItem::setDigitalZoom(int zoom)
 	_pen.setWidthF(_width * pow(2, -_digitalZoom));
 	_marker->setScale(pow(2, -_digitalZoom));
 
-	updateShape();
+	setGeometry(geometry());
 }
 
 const PathSegment *PathItem::segment(qreal x) const
@@ -14,6 +14,7 @@
 
 class Map;
 class PathTickItem;
+class JobControl;
 
 class PathItem : public QObject, public GraphicsItem
 {
@@ -23,14 +24,26 @@ public:
 	PathItem(const Path &path, Map *map, QGraphicsItem *parent = 0);
 	virtual ~PathItem() {}
 
-	QPainterPath shape() const {return _shape;}
-	QRectF boundingRect() const {return _shape.boundingRect();}
+	QPainterPath shape() const;
+	QRectF boundingRect() const;
 	void paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
 	  QWidget *widget);
 
 	const Path &path() const {return _path;}
 
+	/* setMap() only rescales the current geometry, the exact geometry for the
+	   new map is computed by geometry() and applied with setGeometry().
+	   geometry() may run in a worker thread as long as the map and the
+	   digital zoom do not change or, with a job control, until the job is
+	   canceled (the result is then incomplete). */
+	struct Geometry {
+		QList<QPainterPath> chunks;
+		QPainterPath path;
+	};
+
 	void setMap(Map *map);
+	Geometry geometry(JobControl *control = 0, int generation = 0) const;
+	void setGeometry(const Geometry &geometry);
 
 	void setColor(const QColor &color);
 	void setWidth(qreal width);
@@ -67,22 +80,26 @@ protected:
 private:
 	const PathSegment *segment(qreal x) const;
 	QPointF position(qreal distance) const;
-	void updatePainterPath();
-	void updateShape();
-	void addSegment(const Coordinates &c1, const Coordinates &c2);
+	qreal tolerance() const;
+	qreal shapeWidth() const;
+	QRectF mapRect(Map *map) const;
 
 	qreal xInM() const;
 	unsigned tickSize() const;
 
 	Path _path;
+	QList<QVector<float> > _significance;
 	Map *_map;
 	qreal _markerDistance;
 	int _digitalZoom;
 
 	qreal _width;
 	QPen _pen;
-	QPainterPath _shape;
+	mutable QPainterPath _shape;
 	QPainterPath _painterPath;
+	QList<QPainterPath> _chunks;
+	QTransform _preview;
+	QRectF _mapRect;
 	bool _showMarker;
 	bool _showTicks;
 
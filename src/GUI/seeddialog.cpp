@@ -0,0 +1,198 @@
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QFormLayout>
+#include <QDialogButtonBox>
+#include <QGroupBox>
+#include <QRadioButton>
+#include <QSpinBox>
+#include <QLabel>
+#include <QProgressBar>
+#include <QPushButton>
+#include "map/map.h"
+#include "units.h"
+#include "seeddialog.h"
+
+
+#define MAX_TILES 100000
+
+static QString size2str(qint64 size)
+{
+	if (size < 1024 * 1024)
+		return QString::number(size / 1024.0, 'f', 0) + UNIT_SPACE
+		  + QObject::tr("kB");
+	else
+		return QString::number(size / (1024.0 * 1024.0), 'f', 1)
+		  + UNIT_SPACE + QObject::tr("MB");
+}
+
+SeedDialog::SeedDialog(Map *map, const RectC &view, const RectC &data,
+  QWidget *parent) : QDialog(parent), _map(map), _view(view), _data(data),
+  _running(false)
+{
+	Range range(_map->seedZooms());
+
+	_viewArea = new QRadioButton(tr("Visible area"));
+	_dataArea = new QRadioButton(tr("Loaded data"));
+	_buffer = new QSpinBox();
+	_buffer->setRange(0, 100);
+	_buffer->setValue(5);
+	_buffer->setSuffix(UNIT_SPACE + tr("km"));
+	if (_data.isValid())
+		_dataArea->setChecked(true);
+	else {
+		_viewArea->setChecked(true);
+		_dataArea->setEnabled(false);
+		_buffer->setEnabled(false);
+	}
+	QHBoxLayout *dataLayout = new QHBoxLayout();
+	dataLayout->addWidget(_dataArea);
+	dataLayout->addWidget(new QLabel(tr("Buffer:")));
+	dataLayout->addWidget(_buffer);
+	dataLayout->addStretch();
+
+	_minZoom = new QSpinBox();
+	_minZoom->setRange(range.min(), range.max());
+	_minZoom->setValue(qBound(range.min(), _map->zoom(), range.max()));
+	_maxZoom = new QSpinBox();
+	_maxZoom->setRange(range.min(), range.max());
+	_maxZoom->setValue(range.max());
+	QHBoxLayout *zoomLayout = new QHBoxLayout();
+	zoomLayout->addWidget(_minZoom);
+	zoomLayout->addWidget(new QLabel("-"));
+	zoomLayout->addWidget(_maxZoom);
+	zoomLayout->addStretch();
+
+	_count = new QLabel();
+
+	QFormLayout *areaLayout = new QFormLayout();
+	areaLayout->addRow(tr("Area:"), _viewArea);
+	areaLayout->addRow(QString(), dataLayout);
+	areaLayout->addRow(tr("Zoom levels:"), zoomLayout);
+	areaLayout->addRow(tr("Tiles:"), _count);
+	QGroupBox *areaBox = new QGroupBox(tr("Map area"));
+	areaBox->setLayout(areaLayout);
+
+	_progress = new QProgressBar();
+	_status = new QLabel();
+	QVBoxLayout *progressLayout = new QVBoxLayout();
+	progressLayout->addWidget(_progress);
+	progressLayout->addWidget(_status);
+	QGroupBox *progressBox = new QGroupBox(tr("Progress"));
+	progressBox->setLayout(progressLayout);
+
+	QDialogButtonBox *buttonBox = new QDialogButtonBox();
+	_startStop = buttonBox->addButton(tr("Download"),
+	  QDialogButtonBox::ActionRole);
+	buttonBox->addButton(QDialogButtonBox::Close);
+	connect(_startStop, SIGNAL(clicked()), this, SLOT(startStop()));
+	connect(buttonBox, SIGNAL(rejected()), this, SLOT(reject()));
+
+	connect(_viewArea, SIGNAL(toggled(bool)), this, SLOT(updateCount()));
+	connect(_buffer, SIGNAL(valueChanged(int)), this, SLOT(updateCount()));
+	connect(_minZoom, SIGNAL(valueChanged(int)), this, SLOT(updateCount()));
+	connect(_maxZoom, SIGNAL(valueChanged(int)), this, SLOT(updateCount()));
+	connect(_map, SIGNAL(seedProgress(int, int, int, int, qint64)), this,
+	  SLOT(progress(int, int, int, int, qint64)));
+
+	QVBoxLayout *layout = new QVBoxLayout();
+	layout->addWidget(areaBox);
+	layout->addWidget(progressBox);
+	layout->addWidget(buttonBox);
+	setLayout(layout);
+
+	setWindowTitle(tr("Download map area"));
+	setWindowFlags(windowFlags() & ~Qt::WindowContextHelpButtonHint);
+
+	updateCount();
+}
+
+RectC SeedDialog::area() const
+{
+	if (_viewArea->isChecked())
+		return _view;
+
+	qreal buffer = _buffer->value() * KMINM;
+	return (buffer > 0)
+	  ? _data | RectC(_data.topLeft(), buffer)
+		| RectC(_data.bottomRight(), buffer)
+	  : _data;
+}
+
+Range SeedDialog::zooms() const
+{
+	return Range(qMin(_minZoom->value(), _maxZoom->value()),
+	  qMax(_minZoom->value(), _maxZoom->value()));
+}
+
+void SeedDialog::updateCount()
+{
+	qint64 count = _map->seedCount(area(), zooms());
+
+	if (count > MAX_TILES)
+		_count->setText(tr("%1 (the limit is %2)").arg(QString::number(count),
+		  QString::number(MAX_TILES)));
+	else
+		_count->setText(QString::number(count));
+	_startStop->setEnabled(_running || (count > 0 && count <= MAX_TILES));
+}
+
+void SeedDialog::startStop()
+{
+	if (_running) {
+		stop();
+		return;
+	}
+
+	_running = true;
+	_startStop->setText(tr("Stop"));
+	_progress->setValue(0);
+	_time.start();
+	_map->seed(area(), zooms());
+}
+
+void SeedDialog::stop()
+{
+	_map->cancelSeed();
+	_running = false;
+	_startStop->setText(tr("Download"));
+	updateCount();
+}
+
+/* The already stored tiles are skipped without any download, so the
+   throughput and the size estimate are computed from the downloaded tiles
+   only. */
+void SeedDialog::progress(int done, int skipped, int failed, int total,
+  qint64 size)
+{
+	if (!_running)
+		return;
+
+	_progress->setMaximum(total);
+	_progress->setValue(done);
+
+	int downloaded = done - skipped - failed;
+	qreal s = _time.elapsed() / 1000.0;
+	QString status(tr("%1 of %2 tiles (%3 downloaded, %4 already stored)")
+	  .arg(QString::number(done), QString::number(total),
+	  QString::number(downloaded), QString::number(skipped)));
+	if (failed > 0)
+		status += ", " + tr("%n failed", "", failed);
+	if (downloaded > 0) {
+		if (s > 0)
+			status += ", " + size2str(size / s) + "/s";
+		status += ", " + tr("estimated size: %1").arg(
+		  size2str(size * (total - skipped - failed) / downloaded));
+	}
+	_status->setText(status);
+
+	if (done >= total)
+		stop();
+}
+
+void SeedDialog::reject()
+{
+	if (_running)
+		stop();
+
+	QDialog::reject();
+}
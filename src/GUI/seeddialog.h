@@ -0,0 +1,54 @@
+#ifndef SEEDDIALOG_H
+#define SEEDDIALOG_H
+
+#include <QDialog>
+#include <QElapsedTimer>
+#include "common/rectc.h"
+#include "common/range.h"
+
+class QRadioButton;
+class QSpinBox;
+class QLabel;
+class QProgressBar;
+class QPushButton;
+class Map;
+
+class SeedDialog : public QDialog
+{
+	Q_OBJECT
+
+public:
+	SeedDialog(Map *map, const RectC &view, const RectC &data,
+	  QWidget *parent = 0);
+
+public slots:
+	void reject();
+
+private slots:
+	void updateCount();
+	void startStop();
+	void progress(int done, int skipped, int failed, int total,
+	  qint64 size);
+
+private:
+	RectC area() const;
+	Range zooms() const;
+	void stop();
+
+	Map *_map;
+	RectC _view, _data;
+	bool _running;
+	QElapsedTimer _time;
+
+	QRadioButton *_viewArea;
+	QRadioButton *_dataArea;
+	QSpinBox *_buffer;
+	QSpinBox *_minZoom;
+	QSpinBox *_maxZoom;
+	QLabel *_count;
+	QProgressBar *_progress;
+	QLabel *_status;
+	QPushButton *_startStop;
+};
+
+#endif // SEEDDIALOG_H
@@ -158,6 +158,8 @@
 #define ENABLE_HTTP2_DEFAULT              true
 #define PIXMAP_CACHE_SETTING              "pixmapCache"
 #define PIXMAP_CACHE_DEFAULT              256 /* MB */
+#define TILE_STORE_SETTING                "tileStore"
+#define TILE_STORE_DEFAULT                1024 /* MB */
 #define CONNECTION_TIMEOUT_SETTING        "connectionTimeout"
 #define CONNECTION_TIMEOUT_DEFAULT        30 /* s */
 #define HIRES_PRINT_SETTING               "hiresPrint"
@@ -182,6 +184,8 @@
 #define PROJECTION_DEFAULT                3857
 #define HIDPI_MAP_SETTING                 "HiDPIMap"
 #define HIDPI_MAP_DEFAULT                 true
+#define VECTOR_CACHE_SETTING              "vectorCache"
+#define VECTOR_CACHE_DEFAULT              false
 
 #define EVDATA_SETTINGS_GROUP             "EVData"
 #define EVDATA_SHOW_PREFIX_SETTINGS       "show_"
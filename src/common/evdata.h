@@ -2,6 +2,7 @@
 #define EVDATA_H
 
 #include <QDebug>
+#include <cmath>
 
 // Note: Must match the Wheellog CSV column headers
 #define ENUM_EVDATA_SCALARS(F) \
@@ -34,6 +35,12 @@ public:
 	const QString &mode() const {return _mode;}
 
 	bool hasAlert() const {return !_alert.isEmpty();}
+	bool isNull() const {
+		for (int i = 0; i < t_scalar_num; i++)
+			if (!std::isnan(_scalars[i]))
+				return false;
+		return _mode.isEmpty() && _alert.isEmpty();
+	}
 
 	// Return the plain CSV column name (internal name)
 	static const char *getInternalName(scalar_t id)
@@ -78,7 +85,7 @@ private:
 	QString _alert;
 };
 
-Q_DECLARE_TYPEINFO(EVData, Q_PRIMITIVE_TYPE);
+Q_DECLARE_TYPEINFO(EVData, Q_MOVABLE_TYPE);
 
 #ifndef QT_NO_DEBUG
 QDebug operator<<(QDebug dbg, const EVData &c);
@@ -0,0 +1,77 @@
+#include <limits>
+#include <QPointF>
+#include <QPair>
+#include "wgs84.h"
+#include "simplify.h"
+
+
+static qreal distance(const QPointF &p, const QPointF &a, const QPointF &b)
+{
+	QPointF ab(b - a), ap(p - a);
+	qreal l2 = ab.x() * ab.x() + ab.y() * ab.y();
+	qreal t = (l2 > 0) ? (ap.x() * ab.x() + ap.y() * ab.y()) / l2 : 0;
+	QPointF d(ap - qBound((qreal)0, t, (qreal)1) * ab);
+
+	return sqrt(d.x() * d.x() + d.y() * d.y());
+}
+
+QVector<float> Simplify::significance(const QVector<Coordinates> &points)
+{
+	const float max = std::numeric_limits<float>::max();
+	QVector<float> ret(points.size(), 0);
+	QVector<QPointF> xy(points.size());
+	QVector<QPair<int, int> > stack;
+	QVector<float> parent;
+
+	if (points.isEmpty())
+		return ret;
+
+	/* Local equirectangular projection, good enough for the purpose of
+	   the line simplification. */
+	qreal lat = 0;
+	for (int i = 0; i < points.size(); i++)
+		lat += points.at(i).lat();
+	qreal scale = cos(deg2rad(lat / points.size()));
+	for (int i = 0; i < points.size(); i++)
+		xy[i] = QPointF(deg2rad(points.at(i).lon()) * scale * WGS84_RADIUS,
+		  deg2rad(points.at(i).lat()) * WGS84_RADIUS);
+
+	ret[0] = max;
+	ret[points.size() - 1] = max;
+
+	stack.append(qMakePair(0, points.size() - 1));
+	parent.append(max);
+
+	while (!stack.isEmpty()) {
+		QPair<int, int> range(stack.last());
+		float ps = parent.last();
+		stack.removeLast();
+		parent.removeLast();
+
+		if (range.second - range.first < 2)
+			continue;
+
+		int idx = range.first + 1;
+		qreal dmax = -1;
+		for (int i = range.first + 1; i < range.second; i++) {
+			qreal d = distance(xy.at(i), xy.at(range.first),
+			  xy.at(range.second));
+			if (d > dmax) {
+				dmax = d;
+				idx = i;
+			}
+		}
+
+		/* A point can not be more significant than the point that split
+		   the range it belongs to, so the simplified lines are nested. */
+		float s = qMin((float)dmax, ps);
+		ret[idx] = s;
+
+		stack.append(qMakePair(range.first, idx));
+		parent.append(s);
+		stack.append(qMakePair(idx, range.second));
+		parent.append(s);
+	}
+
+	return ret;
+}
@@ -0,0 +1,15 @@
+#ifndef SIMPLIFY_H
+#define SIMPLIFY_H
+
+#include <QVector>
+#include "coordinates.h"
+
+namespace Simplify
+{
+	/* Douglas-Peucker significance of the line points in meters. The line
+	   simplified with tolerance t consists of the points with significance
+	   >= t, the end points are always part of it. */
+	QVector<float> significance(const QVector<Coordinates> &points);
+}
+
+#endif // SIMPLIFY_H
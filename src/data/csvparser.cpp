@@ -82,11 +82,8 @@ bool CSVParser::parse_waypoints(QFile *file, QList<TrackData> &tracks,
 // (https://github.com/palachzzz/WheelLogAndroid.git)
 
 // Log file column header (first line)
-static struct {
-	const char *name;
-	int column;
-} WlColumns[] = {
-#define F_STRUCT(n)	{#n, -1},
+static const char *WlColumns[] = {
+#define F_STRUCT(n)	#n,
 ENUM_WHEELLOG_COLUMNS(F_STRUCT)
 #undef F_STRUCT
 };
@@ -98,9 +95,10 @@ ENUM_WHEELLOG_COLUMNS(F_ENUM)
 	wl_idx_total
 } WlColumn_t;
 
-static QString get_column_str(const QList<QByteArray> &list, WlColumn_t column)
+static QString get_column_str(const QList<QByteArray> &list,
+  const int *columns, WlColumn_t column)
 {
-	int col = WlColumns[column].column;
+	int col = columns[column];
 	if (col == -1) {
 		return QString::Null();
 	}
@@ -128,8 +126,9 @@ bool CSVParser::parse_wheellog(QFile *file, QList<TrackData> &tracks,
 	}
 
 	// Obtain the column indicies to be extracted
-	for (size_t idx = 0; idx < sizeof(WlColumns) / sizeof(*WlColumns); idx++)
-		WlColumns[idx].column = -1;
+	int columns[wl_idx_total];
+	for (size_t idx = 0; idx < wl_idx_total; idx++)
+		columns[idx] = -1;
 	for (int col = 0; col < header_list.size(); col++) {
 		QByteArray ba = header_list[col].trimmed();
 		QString name = QString::fromUtf8(ba.data(), ba.size());		
@@ -144,9 +143,9 @@ bool CSVParser::parse_wheellog(QFile *file, QList<TrackData> &tracks,
 
 		// Lookup the column name
 		for (size_t idx = 0; idx < sizeof(WlColumns) / sizeof(*WlColumns); idx++) {
-			if (name == WlColumns[idx].name) {
-				if (WlColumns[idx].column == -1) {
-					WlColumns[idx].column = col;
+			if (name == WlColumns[idx]) {
+				if (columns[idx] == -1) {
+					columns[idx] = col;
 					break;
 				}
 				else {
@@ -158,7 +157,7 @@ bool CSVParser::parse_wheellog(QFile *file, QList<TrackData> &tracks,
 	}
 
 	// Check for mandatory columns
-	if (WlColumns[wl_latitude_idx].column == -1 || WlColumns[wl_longitude_idx].column == -1) {
+	if (columns[wl_latitude_idx] == -1 || columns[wl_longitude_idx] == -1) {
 		_errorString = "Missing latitude and/or longitude columns";
 		return false;
 	}
@@ -204,7 +203,8 @@ bool CSVParser::parse_wheellog(QFile *file, QList<TrackData> &tracks,
 		EVData evdata;
 
 		for (int idx = 0; idx < sizeof(WlColumns) / sizeof(*WlColumns); idx++) {
-			QString str_val = get_column_str(list, static_cast<WlColumn_t>(idx));
+			QString str_val = get_column_str(list, columns,
+			  static_cast<WlColumn_t>(idx));
 			bool res = !str_val.isNull();
 			if (!res)
 				continue;
@@ -215,12 +215,12 @@ bool CSVParser::parse_wheellog(QFile *file, QList<TrackData> &tracks,
 			{
 			// These columns contain strings or date-time
 			case wl_date_idx: case wl_time_idx: case wl_datetime_idx: case wl_mode_idx: case wl_alert_idx:
-				//qDebug("%d(%s): %s\n", idx, WlColumns[idx].name, qUtf8Printable(str_val));
+				//qDebug("%d(%s): %s\n", idx, WlColumns[idx], qUtf8Printable(str_val));
 				break;
 			// Other columns contain float numbers
 			default:
 				float_val = str_val.toDouble(&res);
-				//qDebug("%d(%s): %f\n", idx, WlColumns[idx].name, float_val);
+				//qDebug("%d(%s): %f\n", idx, WlColumns[idx], float_val);
 			}
 			if (!res)
 				continue;
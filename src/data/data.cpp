@@ -1,7 +1,14 @@
+#include <cctype>
 #include <QApplication>
 #include <QFile>
 #include <QFileInfo>
 #include <QLineF>
+#include <QXmlStreamReader>
+#if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
+#include <QtCore>
+#else // QT_VERSION < 5
+#include <QtConcurrent>
+#endif // QT_VERSION < 5
 #include "common/config.h"
 #include "gpxparser.h"
 #include "tcxparser.h"
@@ -23,71 +30,142 @@
 #include "data.h"
 
 
-static GPXParser gpx;
-static TCXParser tcx;
-static KMLParser kml;
-static FITParser fit;
-static CSVParser csv;
-static IGCParser igc;
-static NMEAParser nmea;
-static PLTParser plt;
-static WPTParser wpt;
-static RTEParser rte;
-static LOCParser loc;
-static SLFParser slf;
-#ifdef ENABLE_GEOJSON
-static GeoJSONParser geojson;
-#endif // ENABLE_GEOJSON
-static EXIFParser exif;
-static CUPParser cup;
-static GPIParser gpi;
-static SMLParser sml;
+template<class T> static Parser *create()
+{
+	return new T();
+}
 
-static QMap<QString, Parser*> parsers()
+static QMap<QString, Data::ParserFactory> parsers()
 {
-	QMap<QString, Parser*> map;
-
-	map.insert("gpx", &gpx);
-	map.insert("tcx", &tcx);
-	map.insert("kml", &kml);
-	map.insert("fit", &fit);
-	map.insert("csv", &csv);
-	map.insert("igc", &igc);
-	map.insert("nmea", &nmea);
-	map.insert("plt", &plt);
-	map.insert("wpt", &wpt);
-	map.insert("rte", &rte);
-	map.insert("loc", &loc);
-	map.insert("slf", &slf);
+	QMap<QString, Data::ParserFactory> map;
+
+	map.insert("gpx", &create<GPXParser>);
+	map.insert("tcx", &create<TCXParser>);
+	map.insert("kml", &create<KMLParser>);
+	map.insert("fit", &create<FITParser>);
+	map.insert("csv", &create<CSVParser>);
+	map.insert("igc", &create<IGCParser>);
+	map.insert("nmea", &create<NMEAParser>);
+	map.insert("plt", &create<PLTParser>);
+	map.insert("wpt", &create<WPTParser>);
+	map.insert("rte", &create<RTEParser>);
+	map.insert("loc", &create<LOCParser>);
+	map.insert("slf", &create<SLFParser>);
 #ifdef ENABLE_GEOJSON
-	map.insert("json", &geojson);
-	map.insert("geojson", &geojson);
+	map.insert("json", &create<GeoJSONParser>);
+	map.insert("geojson", &create<GeoJSONParser>);
 #endif // ENABLE_GEOJSON
-	map.insert("jpeg", &exif);
-	map.insert("jpg", &exif);
-	map.insert("cup", &cup);
-	map.insert("gpi", &gpi);
-	map.insert("sml", &sml);
+	map.insert("jpeg", &create<EXIFParser>);
+	map.insert("jpg", &create<EXIFParser>);
+	map.insert("cup", &create<CUPParser>);
+	map.insert("gpi", &create<GPIParser>);
+	map.insert("sml", &create<SMLParser>);
 
 	return map;
 }
 
-QMap<QString, Parser*> Data::_parsers = parsers();
+QMap<QString, Data::ParserFactory> Data::_parsers = parsers();
 
-void Data::processData(QList<TrackData> &trackData, QList<RouteData> &routeData)
+/* IGC files start with the A record - 'A' followed by the three character
+   manufacturer code */
+static bool isIGC(const QByteArray &line)
 {
-	for (int i = 0; i < trackData.count(); i++)
-		_tracks.append(Track(trackData.at(i)));
-	for (int i = 0; i < routeData.count(); i++)
-		_routes.append(Route(routeData.at(i)));
+	if (line.size() < 4 || line.at(0) != 'A' || line.contains(','))
+		return false;
+	for (int i = 1; i < 4; i++)
+		if (!isalnum((uchar)line.at(i)))
+			return false;
+
+	return true;
+}
+
+/* Detects the file format from the file content. Returns the parsers map key
+   of the format or an empty string when the format is unknown. */
+static QString format(QFile &file)
+{
+	QByteArray data(file.peek(4096));
+
+	if (data.size() >= 12 && (uchar)data.at(0) >= 12
+	  && data.mid(8, 4) == ".FIT")
+		return "fit";
+	if (data.startsWith("\xFF\xD8\xFF"))
+		return "jpg";
+	if (data.left(16).contains("GRMREC"))
+		return "gpi";
+	if (data.contains('\0'))
+		return QString();
+
+	if (data.startsWith("\xEF\xBB\xBF"))
+		data.remove(0, 3);
+	QByteArray text(data.trimmed());
+	QByteArray line(text.left(text.indexOf('\n')).trimmed());
+
+	if (text.startsWith('<')) {
+		QXmlStreamReader reader(data);
+		while (!reader.atEnd() && !reader.isStartElement())
+			reader.readNext();
+		if (!reader.isStartElement())
+			return QString();
+
+		if (reader.name() == QLatin1String("gpx"))
+			return "gpx";
+		else if (reader.name() == QLatin1String("TrainingCenterDatabase"))
+			return "tcx";
+		else if (reader.name() == QLatin1String("kml"))
+			return "kml";
+		else if (reader.name() == QLatin1String("loc"))
+			return "loc";
+		else if (reader.name() == QLatin1String("Activity"))
+			return "slf";
+		else if (reader.name() == QLatin1String("sml"))
+			return "sml";
+		else
+			return QString();
+	} else if (text.startsWith('{')) {
+#ifdef ENABLE_GEOJSON
+		return "geojson";
+#else // ENABLE_GEOJSON
+		return QString();
+#endif // ENABLE_GEOJSON
+	} else if (line.startsWith("OziExplorer Track Point File"))
+		return "plt";
+	else if (line.startsWith("OziExplorer Waypoint File"))
+		return "wpt";
+	else if (line.startsWith("OziExplorer Route File"))
+		return "rte";
+	else if (line.startsWith('$'))
+		return "nmea";
+	else if (isIGC(line))
+		return "igc";
+
+	QList<QByteArray> header(line.toLower().replace('"', "").split(','));
+	if (header.size() >= 11 && header.at(3) == "lat" && header.at(4) == "lon")
+		return "cup";
+	else if (header.size() >= 3)
+		return "csv";
+	else
+		return QString();
+}
+
+void Data::processData()
+{
+	for (int i = 0; i < _trackData.count(); i++)
+		_tracks.append(Track(_trackData.at(i)));
+	for (int i = 0; i < _routeData.count(); i++)
+		_routes.append(Route(_routeData.at(i)));
+}
+
+void Data::reprocess()
+{
+	_tracks.clear();
+	for (int i = 0; i < _trackData.count(); i++)
+		_tracks.append(Track(_trackData.at(i)));
 }
 
 Data::Data(const QString &fileName)
 {
 	QFile file(fileName);
 	QFileInfo fi(fileName);
-	QList<TrackData> trackData;
-	QList<RouteData> routeData;
 
 	_valid = false;
 	_errorLine = 0;
@@ -97,36 +175,43 @@ Data::Data(const QString &fileName)
 		return;
 	}
 
-	QMap<QString, Parser*>::iterator it;
-	if ((it = _parsers.find(fi.suffix().toLower())) != _parsers.end()) {
-		if (it.value()->parse(&file, trackData, routeData, _polygons,
-		  _waypoints)) {
-			processData(trackData, routeData);
-			_valid = true;
-			return;
-		} else {
-			_errorLine = it.value()->errorLine();
-			_errorString = it.value()->errorString();
-		}
-	} else {
-		for (it = _parsers.begin(); it != _parsers.end(); it++) {
-			if (it.value()->parse(&file, trackData, routeData, _polygons,
-			  _waypoints)) {
-				processData(trackData, routeData);
-				_valid = true;
-				return;
-			}
-			file.reset();
-		}
-
-		qWarning("Error loading data file: %s:", qPrintable(fileName));
-		for (it = _parsers.begin(); it != _parsers.end(); it++)
-			qWarning("%s: line %d: %s", qPrintable(it.key()),
-			  it.value()->errorLine(), qPrintable(it.value()->errorString()));
-
-		_errorLine = 0;
+	QMap<QString, ParserFactory>::const_iterator it;
+	if ((it = _parsers.constFind(fi.suffix().toLower())) == _parsers.constEnd())
+		it = _parsers.constFind(format(file));
+	if (it == _parsers.constEnd()) {
 		_errorString = "Unknown format";
+		return;
+	}
+
+	Parser *parser = it.value()();
+	if (parser->parse(&file, _trackData, _routeData, _polygons, _waypoints)) {
+		processData();
+		_valid = true;
+	} else {
+		_errorLine = parser->errorLine();
+		_errorString = parser->errorString();
+	}
+	delete parser;
+}
+
+static Data *loadData(const QString &fileName)
+{
+	return new Data(fileName);
+}
+
+QList<Data> Data::load(const QStringList &files)
+{
+	QFuture<Data*> future = QtConcurrent::mapped(files, loadData);
+	future.waitForFinished();
+
+	QList<Data> list;
+	for (int i = 0; i < future.resultCount(); i++) {
+		Data *data = future.resultAt(i);
+		list.append(*data);
+		delete data;
 	}
+
+	return list;
 }
 
 QString Data::formats()
@@ -157,8 +242,8 @@ QStringList Data::filter()
 {
 	QStringList filter;
 
-	for (QMap<QString, Parser*>::iterator it = _parsers.begin();
-	  it != _parsers.end(); it++)
+	for (QMap<QString, ParserFactory>::const_iterator it
+	  = _parsers.constBegin(); it != _parsers.constEnd(); it++)
 		filter << "*." + it.key();
 
 	return filter;
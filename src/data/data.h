@@ -14,6 +14,8 @@
 class Data
 {
 public:
+	typedef Parser *(*ParserFactory)();
+
 	Data(const QString &fileName);
 
 	bool isValid() const {return _valid;}
@@ -25,22 +27,33 @@ public:
 	const QVector<Waypoint> &waypoints() const {return _waypoints;}
 	const QList<Area> &areas() const {return _polygons;}
 
+	/* Rebuilds the tracks from the parsed data using the current Track
+	   segmentation settings (pause and outlier detection), without re-reading
+	   the file. The other settings do not require a rebuild. */
+	void reprocess();
+
+	/* Loads the files in parallel, the list is in the order of files. Every
+	   parse uses its own parser instance. */
+	static QList<Data> load(const QStringList &files);
+
 	static QString formats();
 	static QStringList filter();
 
 private:
-	void processData(QList<TrackData> &trackData, QList<RouteData> &routeData);
+	void processData();
 
 	bool _valid;
 	QString _errorString;
 	int _errorLine;
 
+	QList<TrackData> _trackData;
+	QList<RouteData> _routeData;
 	QList<Track> _tracks;
 	QList<Route> _routes;
 	QList<Area> _polygons;
 	QVector<Waypoint> _waypoints;
 
-	static QMap<QString, Parser*> _parsers;
+	static QMap<QString, ParserFactory> _parsers;
 };
 
 #endif // DATA_H
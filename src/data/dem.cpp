@@ -5,7 +5,6 @@
 #include <QtMath>
 #endif // QT5
 #include <QDir>
-#include <QFile>
 #include "common/coordinates.h"
 #include "dem.h"
 
@@ -16,6 +15,8 @@
 #define SRTM_SIZE(samples) \
 	((samples) * (samples) * 2)
 
+#define CACHE_SIZE (256 * 1024 * 1024) /* bytes */
+
 static qreal interpolate(qreal dx, qreal dy, qreal p0, qreal p1, qreal p2,
   qreal p3)
 {
@@ -23,41 +24,74 @@ static qreal interpolate(qreal dx, qreal dy, qreal p0, qreal p1, qreal p2,
 	  + p3 * dx * dy;
 }
 
-static qreal value(int col, int row, int samples, const QByteArray *data)
+
+DEM::Tile::Tile(const QString &fileName)
+  : _file(fileName), _data(0), _size(0), _samples(0)
 {
-	int pos = ((samples - 1 - row) * samples + col) * 2;
-	qint16 val = qFromBigEndian(*((const qint16*)(data->constData() + pos)));
+	if (!_file.open(QIODevice::ReadOnly)) {
+		qWarning("%s: %s", qPrintable(_file.fileName()),
+		  qPrintable(_file.errorString()));
+		return;
+	}
+
+	qint64 size = _file.size();
+	if (size == SRTM_SIZE(SRTM3_SAMPLES))
+		_samples = SRTM3_SAMPLES;
+	else if (size == SRTM_SIZE(SRTM1_SAMPLES))
+		_samples = SRTM1_SAMPLES;
+	else {
+		qWarning("%s: Invalid DEM file size", qPrintable(_file.fileName()));
+		return;
+	}
+
+	/* Only the pages actually used by the tracks get loaded when the file is
+	   mapped. Fallback to reading the whole file where mapping fails. */
+	_data = _file.map(0, size);
+	if (!_data) {
+		_buffer = _file.readAll();
+		if (_buffer.size() != size) {
+			_buffer.clear();
+			return;
+		}
+		_data = (const uchar*)_buffer.constData();
+		_file.close();
+	}
 
-	return (val == -32768) ? NAN : val;
+	_size = (int)size;
 }
 
-static qreal height(const Coordinates &c, const QByteArray *data)
+qreal DEM::Tile::value(int col, int row) const
 {
-	int samples;
+	int pos = ((_samples - 1 - row) * _samples + col) * 2;
+	qint16 val = qFromBigEndian<qint16>(_data + pos);
+
+	return (val == -32768) ? NAN : val;
+}
 
-	if (data->size() == SRTM_SIZE(SRTM3_SAMPLES))
-		samples = SRTM3_SAMPLES;
-	else if (data->size() == SRTM_SIZE(SRTM1_SAMPLES))
-		samples = SRTM1_SAMPLES;
-	else
+qreal DEM::Tile::height(const Coordinates &c) const
+{
+	if (!_data)
 		return NAN;
 
-	int row = (int)((c.lat() - qFloor(c.lat())) * (samples - 1));
-	int col = (int)((c.lon() - qFloor(c.lon())) * (samples - 1));
-	qreal dx = ((c.lon() - qFloor(c.lon())) * (samples - 1)) - col;
-	qreal dy = ((c.lat() - qFloor(c.lat())) * (samples - 1)) - row;
+	qreal x = (c.lon() - qFloor(c.lon())) * (_samples - 1);
+	qreal y = (c.lat() - qFloor(c.lat())) * (_samples - 1);
+	int col = (int)x;
+	int row = (int)y;
+	qreal dx = x - col;
+	qreal dy = y - row;
 
-	qreal p0 = value(col, row, samples, data);
-	qreal p1 = value(col + 1, row, samples, data);
-	qreal p2 = value(col, row + 1, samples, data);
-	qreal p3 = value(col + 1, row + 1, samples, data);
+	qreal p0 = value(col, row);
+	qreal p1 = value(col + 1, row);
+	qreal p2 = value(col, row + 1);
+	qreal p3 = value(col + 1, row + 1);
 
 	return interpolate(dx, dy, p0, p1, p2, p3);
 }
 
 
 QString DEM::_dir;
-QCache<DEM::Key, QByteArray> DEM::_data;
+QCache<DEM::Key, DEM::Tile> DEM::_data(CACHE_SIZE);
+QMutex DEM::_lock;
 
 QString DEM::fileName(const Key &key)
 {
@@ -70,32 +104,61 @@ QString DEM::fileName(const Key &key)
 	return QDir(_dir).absoluteFilePath(basename);
 }
 
+/* Must be called with the lock held. Missing/invalid tiles are cached as
+   well (with a minimal cost) to not retry opening them for every point. */
+DEM::Tile *DEM::tile(const Key &key)
+{
+	Tile *t = _data.object(key);
+
+	if (!t) {
+		t = new Tile(fileName(key));
+		_data.insert(key, t, qMax(t->size(), 1));
+	}
+
+	return t;
+}
+
 void DEM::setDir(const QString &path)
 {
+	QMutexLocker locker(&_lock);
+
 	_dir = path;
+	_data.clear();
 }
 
 qreal DEM::elevation(const Coordinates &c)
 {
+	QMutexLocker locker(&_lock);
+
 	if (_dir.isEmpty())
 		return NAN;
 
-	Key k(qFloor(c.lon()), qFloor(c.lat()));
-
-	QByteArray *ba = _data[k];
-	if (!ba) {
-		QFile file(fileName(k));
-		if (!file.open(QIODevice::ReadOnly)) {
-			qWarning("%s: %s", qPrintable(file.fileName()),
-			  qPrintable(file.errorString()));
-			_data.insert(k, new QByteArray());
-			return NAN;
-		} else {
-			ba = new QByteArray(file.readAll());
-			qreal ele = height(c, ba);
-			_data.insert(k, ba);
-			return ele;
+	return tile(Key(qFloor(c.lon()), qFloor(c.lat())))->height(c);
+}
+
+QVector<qreal> DEM::elevation(const SegmentData &data)
+{
+	QMutexLocker locker(&_lock);
+	QVector<qreal> ret(data.size(), NAN);
+
+	if (_dir.isEmpty())
+		return ret;
+
+	/* Track points are mostly ordered, so the tile lookup is done only when
+	   the track crosses a tile border. */
+	Key key(0, 0);
+	Tile *t = 0;
+
+	for (int i = 0; i < data.size(); i++) {
+		const Coordinates &c = data.coordinates(i);
+		Key k(qFloor(c.lon()), qFloor(c.lat()));
+
+		if (!t || !(k == key)) {
+			key = k;
+			t = tile(key);
 		}
-	} else
-		return height(c, ba);
+		ret[i] = t->height(c);
+	}
+
+	return ret;
 }
@@ -4,10 +4,17 @@
 #include <QString>
 #include <QCache>
 #include <QByteArray>
+#include <QFile>
+#include <QMutex>
+#include <QVector>
+#include "trackdata.h"
 
 class QString;
 class Coordinates;
 
+/* SRTM DEM. The .hgt tiles are memory mapped (or read whole when mapping is
+   not possible) and kept in a cache with a byte size limit. All the functions
+   are thread-safe. */
 class DEM
 {
 private:
@@ -27,14 +34,34 @@ private:
 		int _lon, _lat;
 	};
 
+	class Tile {
+	public:
+		Tile(const QString &fileName);
+
+		int size() const {return _size;}
+		qreal height(const Coordinates &c) const;
+
+	private:
+		qreal value(int col, int row) const;
+
+		QFile _file;
+		QByteArray _buffer;
+		const uchar *_data;
+		int _size;
+		int _samples;
+	};
+
 	static QString fileName(const Key &key);
+	static Tile *tile(const Key &key);
 
 	static QString _dir;
-	static QCache<Key, QByteArray> _data;
+	static QCache<Key, Tile> _data;
+	static QMutex _lock;
 
 public:
 	static void setDir(const QString &path);
 	static qreal elevation(const Coordinates &c);
+	static QVector<qreal> elevation(const SegmentData &data);
 
 	friend uint qHash(const Key &key);
 };
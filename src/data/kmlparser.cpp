@@ -170,11 +170,12 @@ bool KMLParser::lineCoordinates(SegmentData &segment)
 			if (!res)
 				return false;
 
-			segment.append(Trackpoint(Coordinates(val[0], val[1])));
-			if (!segment.last().coordinates().isValid())
+			Trackpoint t(Coordinates(val[0], val[1]));
+			if (!t.coordinates().isValid())
 				return false;
 			if (c == 2)
-				segment.last().setElevation(val[2]);
+				t.setElevation(val[2]);
+			segment.append(t);
 
 			while (cp->isSpace())
 				cp++;
@@ -335,9 +336,11 @@ void KMLParser::heartRate(SegmentData &segment, int start)
 
 	while (_reader.readNextStartElement()) {
 		if (_reader.name() == QLatin1String("value")) {
-			if (i < segment.size())
-				segment[i++].setHeartRate(number());
-			else {
+			if (i < segment.size()) {
+				Trackpoint t(segment.at(i));
+				t.setHeartRate(number());
+				segment.replace(i++, t);
+			} else {
 				_reader.raiseError(error);
 				return;
 			}
@@ -356,9 +359,11 @@ void KMLParser::cadence(SegmentData &segment, int start)
 
 	while (_reader.readNextStartElement()) {
 		if (_reader.name() == QLatin1String("value")) {
-			if (i < segment.size())
-				segment[i++].setCadence(number());
-			else {
+			if (i < segment.size()) {
+				Trackpoint t(segment.at(i));
+				t.setCadence(number());
+				segment.replace(i++, t);
+			} else {
 				_reader.raiseError(error);
 				return;
 			}
@@ -377,9 +382,11 @@ void KMLParser::speed(SegmentData &segment, int start)
 
 	while (_reader.readNextStartElement()) {
 		if (_reader.name() == QLatin1String("value")) {
-			if (i < segment.size())
-				segment[i++].setSpeed(number());
-			else {
+			if (i < segment.size()) {
+				Trackpoint t(segment.at(i));
+				t.setSpeed(number());
+				segment.replace(i++, t);
+			} else {
 				_reader.raiseError(error);
 				return;
 			}
@@ -398,9 +405,11 @@ void KMLParser::temperature(SegmentData &segment, int start)
 
 	while (_reader.readNextStartElement()) {
 		if (_reader.name() == QLatin1String("value")) {
-			if (i < segment.size())
-				segment[i++].setTemperature(number());
-			else {
+			if (i < segment.size()) {
+				Trackpoint t(segment.at(i));
+				t.setTemperature(number());
+				segment.replace(i++, t);
+			} else {
 				_reader.raiseError(error);
 				return;
 			}
@@ -452,17 +461,20 @@ void KMLParser::track(SegmentData &segment)
 
 	while (_reader.readNextStartElement()) {
 		if (_reader.name() == QLatin1String("when")) {
-			segment.append(Trackpoint());
-			segment.last().setTimestamp(time());
+			Trackpoint t;
+			t.setTimestamp(time());
+			segment.append(t);
 		} else if (_reader.name() == QLatin1String("coord")) {
 			if (i == segment.size()) {
 				_reader.raiseError(error);
 				return;
-			} else if (!coord(segment[i])) {
+			}
+			Trackpoint t(segment.at(i));
+			if (!coord(t)) {
 				_reader.raiseError("Invalid coordinates");
 				return;
 			}
-			i++;
+			segment.replace(i++, t);
 		} else if (_reader.name() == QLatin1String("ExtendedData"))
 			extendedData(segment, first);
 		else
@@ -281,8 +281,11 @@ bool NMEAParser::readRMC(CTX &ctx, const char *line, int len,
 	}
 
 	if (!date.isNull()) {
-		if (ctx.date.isNull() && !ctx.time.isNull() && !segment.isEmpty())
-			segment.last().setTimestamp(QDateTime(date, ctx.time, Qt::UTC));
+		if (ctx.date.isNull() && !ctx.time.isNull() && !segment.isEmpty()) {
+			Trackpoint t(segment.last());
+			t.setTimestamp(QDateTime(date, ctx.time, Qt::UTC));
+			segment.replace(segment.size() - 1, t);
+		}
 		ctx.date = date;
 	}
 
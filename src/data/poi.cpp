@@ -18,7 +18,11 @@ POI::POI(QObject *parent) : QObject(parent)
 
 bool POI::loadFile(const QString &path)
 {
-	Data data(path);
+	return loadFile(path, Data(path));
+}
+
+bool POI::loadFile(const QString &path, const Data &data)
+{
 	FileIndex index;
 
 	index.enabled = true;
@@ -50,7 +54,7 @@ bool POI::loadFile(const QString &path)
 	return true;
 }
 
-void POI::loadDir(const QString &path)
+static void dirFiles(const QString &path, QStringList &files)
 {
 	QDir md(path);
 	md.setFilter(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot);
@@ -60,14 +64,25 @@ void POI::loadDir(const QString &path)
 		const QFileInfo &fi = fl.at(i);
 
 		if (fi.isDir())
-			loadDir(fi.absoluteFilePath());
+			dirFiles(fi.absoluteFilePath(), files);
 		else
-			if (!loadFile(fi.absoluteFilePath()))
-				qWarning("%s: %s", qPrintable(fi.absoluteFilePath()),
-				  qPrintable(_errorString));
+			files.append(fi.absoluteFilePath());
 	}
 }
 
+void POI::loadDir(const QString &path)
+{
+	QStringList files;
+
+	dirFiles(path, files);
+	QList<Data> data(Data::load(files));
+
+	for (int i = 0; i < data.size(); i++)
+		if (!loadFile(files.at(i), data.at(i)))
+			qWarning("%s: %s", qPrintable(files.at(i)),
+			  qPrintable(_errorString));
+}
+
 static bool cb(size_t data, void* context)
 {
 	QSet<int> *set = (QSet<int>*) context;
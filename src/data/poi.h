@@ -11,6 +11,7 @@
 class Path;
 class Area;
 class RectC;
+class Data;
 
 class POI : public QObject
 {
@@ -46,7 +47,7 @@ private:
 		bool enabled;
 	};
 
-	bool loadFile(const QString &path, bool dir);
+	bool loadFile(const QString &path, const Data &data);
 	void search(const RectC &rect, QSet<int> &set) const;
 
 	POITree _tree;
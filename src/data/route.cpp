@@ -4,7 +4,8 @@
 bool Route::_useDEM = false;
 bool Route::_show2ndElevation = false;
 
-Route::Route(const RouteData &data) : _data(data)
+Route::Route(const RouteData &data)
+  : _data(data), _hasGPSElevation(false), _hasDEMElevation(false)
 {
 	qreal dist = 0;
 
@@ -18,18 +19,23 @@ Route::Route(const RouteData &data) : _data(data)
 
 Path Route::path() const
 {
-	Path ret;
-	ret.append(PathSegment());
-	PathSegment &ps = ret.last();
+	if (!_path.isEmpty())
+		return _path;
+
+	_path.append(PathSegment());
+	PathSegment &ps = _path.last();
 
 	for (int i = 0; i < _data.size(); i++)
 		ps.append(PathPoint(_data.at(i).coordinates(), _distance.at(i)));
 
-	return ret;
+	return _path;
 }
 
 Graph Route::gpsElevation() const
 {
+	if (_hasGPSElevation)
+		return _gpsElevation;
+
 	Graph graph;
 	graph.append(GraphSegment());
 	GraphSegment &gs = graph.last();
@@ -38,11 +44,17 @@ Graph Route::gpsElevation() const
 		if (_data.at(i).hasElevation())
 			gs.append(GraphPoint(_distance.at(i), NAN, _data.at(i).elevation()));
 
+	_gpsElevation = graph;
+	_hasGPSElevation = true;
+
 	return graph;
 }
 
 Graph Route::demElevation() const
 {
+	if (_hasDEMElevation)
+		return _demElevation;
+
 	Graph graph;
 	graph.append(GraphSegment());
 	GraphSegment &gs = graph.last();
@@ -53,6 +65,9 @@ Graph Route::demElevation() const
 			gs.append(GraphPoint(_distance.at(i), NAN, dem));
 	}
 
+	_demElevation = graph;
+	_hasDEMElevation = true;
+
 	return graph;
 }
 
@@ -34,6 +34,10 @@ private:
 	RouteData _data;
 	QVector<qreal> _distance;
 
+	mutable Graph _gpsElevation, _demElevation;
+	mutable bool _hasGPSElevation, _hasDEMElevation;
+	mutable Path _path;
+
 	static bool _useDEM;
 	static bool _show2ndElevation;
 };
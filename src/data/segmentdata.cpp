@@ -0,0 +1,132 @@
+#include <limits>
+#include "segmentdata.h"
+
+
+const qint64 SegmentData::_nullTime = std::numeric_limits<qint64>::min();
+const EVData SegmentData::_nullEVData;
+
+void SegmentData::setValue(QVector<float> &column, int i, qreal value)
+{
+	if (std::isnan(value)) {
+		if (!column.isEmpty())
+			column[i] = NAN;
+	} else {
+		if (column.isEmpty())
+			column.fill(NAN, size());
+		column[i] = value;
+	}
+}
+
+SegmentData::Zone SegmentData::zone(const QDateTime &timestamp)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 2, 0)
+	return Zone((timestamp.timeSpec() == Qt::TimeZone)
+	  ? Qt::OffsetFromUTC : timestamp.timeSpec(), timestamp.offsetFromUtc());
+#else // QT >= 5.2
+	return Zone(timestamp.timeSpec(), 0);
+#endif // QT >= 5.2
+}
+
+void SegmentData::setTime(int i, const QDateTime &timestamp)
+{
+	if (!timestamp.isValid()) {
+		if (!_time.isEmpty())
+			_time[i] = _nullTime;
+		return;
+	}
+
+	Zone z(zone(timestamp));
+	if (_time.isEmpty()) {
+		_time.fill(_nullTime, size());
+		_zone = z;
+	} else if (_zones.isEmpty() && z != _zone)
+		_zones.fill(_zone, size());
+	if (!_zones.isEmpty())
+		_zones[i] = z;
+
+	_time[i] = timestamp.toMSecsSinceEpoch();
+}
+
+void SegmentData::set(int i, const Trackpoint &trackpoint)
+{
+	setTime(i, trackpoint.timestamp());
+	setValue(_elevation, i, trackpoint.elevation());
+	setValue(_speed, i, trackpoint.speed());
+	setValue(_heartRate, i, trackpoint.heartRate());
+	setValue(_temperature, i, trackpoint.temperature());
+	setValue(_cadence, i, trackpoint.cadence());
+	setValue(_power, i, trackpoint.power());
+	setValue(_ratio, i, trackpoint.ratio());
+
+	if (!trackpoint.evData().isNull()) {
+		if (_evData.isEmpty())
+			_evData.fill(EVData(), size());
+		_evData[i] = trackpoint.evData();
+	} else if (!_evData.isEmpty())
+		_evData[i] = EVData();
+}
+
+void SegmentData::append(const Trackpoint &trackpoint)
+{
+	_coordinates.append(trackpoint.coordinates());
+
+	if (!_time.isEmpty())
+		_time.append(_nullTime);
+	if (!_elevation.isEmpty())
+		_elevation.append(NAN);
+	if (!_speed.isEmpty())
+		_speed.append(NAN);
+	if (!_heartRate.isEmpty())
+		_heartRate.append(NAN);
+	if (!_temperature.isEmpty())
+		_temperature.append(NAN);
+	if (!_cadence.isEmpty())
+		_cadence.append(NAN);
+	if (!_power.isEmpty())
+		_power.append(NAN);
+	if (!_ratio.isEmpty())
+		_ratio.append(NAN);
+	if (!_evData.isEmpty())
+		_evData.append(EVData());
+	if (!_zones.isEmpty())
+		_zones.append(_zone);
+
+	set(size() - 1, trackpoint);
+}
+
+void SegmentData::replace(int i, const Trackpoint &trackpoint)
+{
+	_coordinates[i] = trackpoint.coordinates();
+	set(i, trackpoint);
+}
+
+QDateTime SegmentData::timestamp(int i) const
+{
+	if (!hasTimestamp(i))
+		return QDateTime();
+
+	const Zone &z = _zones.isEmpty() ? _zone : _zones.at(i);
+#if QT_VERSION >= QT_VERSION_CHECK(5, 2, 0)
+	return QDateTime::fromMSecsSinceEpoch(_time.at(i), z.spec, z.offset);
+#else // QT >= 5.2
+	QDateTime dt(QDateTime::fromMSecsSinceEpoch(_time.at(i)));
+	return (z.spec == Qt::UTC) ? dt.toUTC() : dt;
+#endif // QT >= 5.2
+}
+
+Trackpoint SegmentData::at(int i) const
+{
+	Trackpoint trackpoint(_coordinates.at(i));
+
+	trackpoint.setTimestamp(timestamp(i));
+	trackpoint.setElevation(elevation(i));
+	trackpoint.setSpeed(speed(i));
+	trackpoint.setHeartRate(heartRate(i));
+	trackpoint.setTemperature(temperature(i));
+	trackpoint.setCadence(cadence(i));
+	trackpoint.setPower(power(i));
+	trackpoint.setRatio(ratio(i));
+	trackpoint.setEVData(evData(i));
+
+	return trackpoint;
+}
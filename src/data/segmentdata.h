@@ -0,0 +1,96 @@
+#ifndef SEGMENTDATA_H
+#define SEGMENTDATA_H
+
+#include <QVector>
+#include <QDateTime>
+#include <cmath>
+#include "trackpoint.h"
+
+/* Column-oriented track segment storage. Every sensor channel is a separate
+   float column that is only allocated once a point with the value has been
+   added, timestamps are stored as milliseconds since epoch and the EV data
+   live in an optional side table. The time spec (and UTC offset) is kept per
+   segment, a per point side table is only allocated when the segment mixes
+   timestamps with different specs. */
+class SegmentData
+{
+public:
+	SegmentData() {}
+
+	int size() const {return _coordinates.size();}
+	int count() const {return _coordinates.size();}
+	bool isEmpty() const {return _coordinates.isEmpty();}
+
+	void append(const Trackpoint &trackpoint);
+	void replace(int i, const Trackpoint &trackpoint);
+
+	Trackpoint at(int i) const;
+	Trackpoint first() const {return at(0);}
+	Trackpoint last() const {return at(size() - 1);}
+
+	const Coordinates &coordinates(int i) const {return _coordinates.at(i);}
+	qint64 time(int i) const
+	  {return _time.isEmpty() ? _nullTime : _time.at(i);}
+	QDateTime timestamp(int i) const;
+	qreal elevation(int i) const {return value(_elevation, i);}
+	qreal speed(int i) const {return value(_speed, i);}
+	qreal heartRate(int i) const {return value(_heartRate, i);}
+	qreal temperature(int i) const {return value(_temperature, i);}
+	qreal cadence(int i) const {return value(_cadence, i);}
+	qreal power(int i) const {return value(_power, i);}
+	qreal ratio(int i) const {return value(_ratio, i);}
+	const EVData &evData(int i) const
+	  {return _evData.isEmpty() ? _nullEVData : _evData.at(i);}
+
+	bool hasTimestamp(int i) const
+	  {return !_time.isEmpty() && _time.at(i) != _nullTime;}
+	bool hasElevation(int i) const {return !std::isnan(elevation(i));}
+	bool hasSpeed(int i) const {return !std::isnan(speed(i));}
+	bool hasHeartRate(int i) const {return !std::isnan(heartRate(i));}
+	bool hasTemperature(int i) const {return !std::isnan(temperature(i));}
+	bool hasCadence(int i) const {return !std::isnan(cadence(i));}
+	bool hasPower(int i) const {return !std::isnan(power(i));}
+	bool hasRatio(int i) const {return !std::isnan(ratio(i));}
+
+private:
+	struct Zone {
+		Zone() : spec(Qt::LocalTime), offset(0) {}
+		Zone(Qt::TimeSpec spec, int offset) : spec(spec), offset(offset) {}
+
+		bool operator==(const Zone &other) const
+		  {return (spec == other.spec && offset == other.offset);}
+		bool operator!=(const Zone &other) const {return !(*this == other);}
+
+		Qt::TimeSpec spec;
+		int offset;
+	};
+
+	static Zone zone(const QDateTime &timestamp);
+	static qreal value(const QVector<float> &column, int i)
+	  {return column.isEmpty() ? NAN : column.at(i);}
+
+	void set(int i, const Trackpoint &trackpoint);
+	void setTime(int i, const QDateTime &timestamp);
+	void setValue(QVector<float> &column, int i, qreal value);
+
+	QVector<Coordinates> _coordinates;
+	QVector<qint64> _time;
+	QVector<float> _elevation;
+	QVector<float> _speed;
+	QVector<float> _heartRate;
+	QVector<float> _temperature;
+	QVector<float> _cadence;
+	QVector<float> _power;
+	QVector<float> _ratio;
+	QVector<EVData> _evData;
+	QVector<Zone> _zones;
+
+	Zone _zone;
+
+	static const qint64 _nullTime;
+	static const EVData _nullEVData;
+};
+
+Q_DECLARE_TYPEINFO(SegmentData, Q_MOVABLE_TYPE);
+
+#endif // SEGMENTDATA_H
@@ -108,13 +108,15 @@ void SMLParser::samples(SegmentData &segment)
 	}
 
 	for (int i = 0; i < segment.size(); i++) {
-		Trackpoint &t = segment[i];
-		if ((it = sensors.lowerBound(t.timestamp())) != sensors.constEnd()) {
+		if ((it = sensors.lowerBound(segment.timestamp(i)))
+		  != sensors.constEnd()) {
+			Trackpoint t(segment.at(i));
 			t.setCadence(it->cadence * 60);
 			t.setTemperature(it->temperature - 273.15);
 			t.setHeartRate(it->hr * 60);
 			t.setPower(it->power);
 			t.setSpeed(it->speed);
+			segment.replace(i, t);
 		}
 	}
 }
@@ -88,7 +88,8 @@ static GraphSegment filter(const GraphSegment &g, int window)
 }
 
 
-Track::Track(const TrackData &data) : _data(data), _pause(0)
+Track::Track(const TrackData &data)
+  : _data(data), _pause(0), _hasPath(false)
 {
 	qreal ds, dt;
 
@@ -107,23 +108,21 @@ Track::Track(const TrackData &data) : _data(data), _pause(0)
 		  ? _segments.at(i-1).distance.last() : 0);
 		seg.time.append(i && !_segments.at(i-1).time.isEmpty()
 		  ? _segments.at(i-1).time.last() :
-		  sd.first().hasTimestamp() ? 0 : NAN);
-		seg.speed.append(sd.first().hasTimestamp() ? 0 : NAN);
-		acceleration.append(sd.first().hasTimestamp() ? 0 : NAN);
+		  sd.hasTimestamp(0) ? 0 : NAN);
+		seg.speed.append(sd.hasTimestamp(0) ? 0 : NAN);
+		acceleration.append(sd.hasTimestamp(0) ? 0 : NAN);
 		bool hasTime = !std::isnan(seg.time.first());
 
 		for (int j = 1; j < sd.size(); j++) {
-			ds = sd.at(j).coordinates().distanceTo(
-			  sd.at(j-1).coordinates());
+			ds = sd.coordinates(j).distanceTo(sd.coordinates(j-1));
 			seg.distance.append(seg.distance.last() + ds);
 
-			if (hasTime && sd.at(j).timestamp().isValid()) {
-				if (sd.at(j).timestamp() > sd.at(j-1).timestamp())
-					dt = sd.at(j-1).timestamp().msecsTo(
-					  sd.at(j).timestamp()) / 1000.0;
+			if (hasTime && sd.hasTimestamp(j)) {
+				if (sd.time(j) > sd.time(j-1))
+					dt = (sd.time(j) - sd.time(j-1)) / 1000.0;
 				else {
 					qWarning("%s: %s: time skew detected", qPrintable(
-					  _data.name()), qPrintable(sd.at(j).timestamp().toString(
+					  _data.name()), qPrintable(sd.timestamp(j).toString(
 					  Qt::ISODate)));
 					dt = 0;
 				}
@@ -211,8 +210,7 @@ Track::Track(const TrackData &data) : _data(data), _pause(0)
 				seg.distance[j] = seg.distance.at(last);
 				seg.speed[j] = 0;
 			} else {
-				ds = sd.at(j).coordinates().distanceTo(
-				  sd.at(last).coordinates());
+				ds = sd.coordinates(j).distanceTo(sd.coordinates(last));
 				seg.distance[j] = seg.distance.at(last) + ds;
 
 				dt = seg.time.at(j) - seg.time.at(last);
@@ -225,6 +223,9 @@ Track::Track(const TrackData &data) : _data(data), _pause(0)
 
 Graph Track::gpsElevation() const
 {
+	if (_gpsElevation.window == _elevationWindow)
+		return _gpsElevation.graph;
+
 	Graph ret;
 
 	for (int i = 0; i < _data.size(); i++) {
@@ -235,20 +236,25 @@ Graph Track::gpsElevation() const
 		GraphSegment gs;
 
 		for (int j = 0; j < sd.size(); j++) {
-			if (!sd.at(j).hasElevation() || seg.outliers.contains(j))
+			if (!sd.hasElevation(j) || seg.outliers.contains(j))
 				continue;
 			gs.append(GraphPoint(seg.distance.at(j), seg.time.at(j),
-			  sd.at(j).elevation()));
+			  sd.elevation(j)));
 		}
 
 		ret.append(filter(gs, _elevationWindow));
 	}
 
+	_gpsElevation = Series(ret, _elevationWindow);
+
 	return ret;
 }
 
 Graph Track::demElevation() const
 {
+	if (_demElevation.window == _elevationWindow)
+		return _demElevation.graph;
+
 	Graph ret;
 
 	for (int i = 0; i < _data.size(); i++) {
@@ -256,18 +262,21 @@ Graph Track::demElevation() const
 		if (sd.size() < 2)
 			continue;
 		const Segment &seg = _segments.at(i);
+		QVector<qreal> dem(DEM::elevation(sd));
 		GraphSegment gs;
 
 		for (int j = 0; j < sd.size(); j++) {
-			qreal dem = DEM::elevation(sd.at(j).coordinates());
-			if (std::isnan(dem) || seg.outliers.contains(j))
+			if (std::isnan(dem.at(j)) || seg.outliers.contains(j))
 				continue;
-			gs.append(GraphPoint(seg.distance.at(j), seg.time.at(j), dem));
+			gs.append(GraphPoint(seg.distance.at(j), seg.time.at(j),
+			  dem.at(j)));
 		}
 
 		ret.append(filter(gs, _elevationWindow));
 	}
 
+	_demElevation = Series(ret, _elevationWindow);
+
 	return ret;
 }
 
@@ -290,6 +299,9 @@ GraphPair Track::elevation() const
 
 Graph Track::computedSpeed() const
 {
+	if (_computedSpeed.window == _speedWindow)
+		return _computedSpeed.graph;
+
 	Graph ret;
 
 	for (int i = 0; i < _data.size(); i++) {
@@ -320,11 +332,16 @@ Graph Track::computedSpeed() const
 			filtered[stop.at(j)].setY(0);
 	}
 
+	_computedSpeed = Series(ret, _speedWindow);
+
 	return ret;
 }
 
 Graph Track::reportedSpeed() const
 {
+	if (_reportedSpeed.window == _speedWindow)
+		return _reportedSpeed.graph;
+
 	Graph ret;
 
 	for (int i = 0; i < _data.size(); i++) {
@@ -337,11 +354,11 @@ Graph Track::reportedSpeed() const
 		qreal v;
 
 		for (int j = 0; j < sd.size(); j++) {
-			if (seg.stop.contains(j) && sd.at(j).hasSpeed()) {
+			if (seg.stop.contains(j) && sd.hasSpeed(j)) {
 				v = 0;
 				stop.append(gs.size());
-			} else if (sd.at(j).hasSpeed() && !seg.outliers.contains(j))
-				v = sd.at(j).speed();
+			} else if (sd.hasSpeed(j) && !seg.outliers.contains(j))
+				v = sd.speed(j);
 			else
 				continue;
 
@@ -355,6 +372,8 @@ Graph Track::reportedSpeed() const
 			filtered[stop.at(j)].setY(0);
 	}
 
+	_reportedSpeed = Series(ret, _speedWindow);
+
 	return ret;
 }
 
@@ -379,6 +398,9 @@ GraphPair Track::speed() const
 
 Graph Track::heartRate() const
 {
+	if (_heartRate.window == _heartRateWindow)
+		return _heartRate.graph;
+
 	Graph ret;
 
 	for (int i = 0; i < _data.size(); i++) {
@@ -389,18 +411,23 @@ Graph Track::heartRate() const
 		GraphSegment gs;
 
 		for (int j = 0; j < sd.size(); j++)
-			if (sd.at(j).hasHeartRate() && !seg.outliers.contains(j))
+			if (sd.hasHeartRate(j) && !seg.outliers.contains(j))
 				gs.append(GraphPoint(seg.distance.at(j), seg.time.at(j),
-				  sd.at(j).heartRate()));
+				  sd.heartRate(j)));
 
 		ret.append(filter(gs, _heartRateWindow));
 	}
 
+	_heartRate = Series(ret, _heartRateWindow);
+
 	return ret;
 }
 
 Graph Track::temperature() const
 {
+	if (_temperature.window == 0)
+		return _temperature.graph;
+
 	Graph ret;
 
 	for (int i = 0; i < _data.size(); i++) {
@@ -411,19 +438,24 @@ Graph Track::temperature() const
 		GraphSegment gs;
 
 		for (int j = 0; j < sd.count(); j++) {
-			if (sd.at(j).hasTemperature() && !seg.outliers.contains(j))
+			if (sd.hasTemperature(j) && !seg.outliers.contains(j))
 				gs.append(GraphPoint(seg.distance.at(j), seg.time.at(j),
-				  sd.at(j).temperature()));
+				  sd.temperature(j)));
 		}
 
 		ret.append(gs);
 	}
 
+	_temperature = Series(ret, 0);
+
 	return ret;
 }
 
 Graph Track::ratio() const
 {
+	if (_ratio.window == 0)
+		return _ratio.graph;
+
 	Graph ret;
 
 	for (int i = 0; i < _data.size(); i++) {
@@ -434,18 +466,23 @@ Graph Track::ratio() const
 		GraphSegment gs;
 
 		for (int j = 0; j < sd.size(); j++)
-			if (sd.at(j).hasRatio() && !seg.outliers.contains(j))
+			if (sd.hasRatio(j) && !seg.outliers.contains(j))
 				gs.append(GraphPoint(seg.distance.at(j), seg.time.at(j),
-				  sd.at(j).ratio()));
+				  sd.ratio(j)));
 
 		ret.append(gs);
 	}
 
+	_ratio = Series(ret, 0);
+
 	return ret;
 }
 
 Graph Track::cadence() const
 {
+	if (_cadence.window == _cadenceWindow)
+		return _cadence.graph;
+
 	Graph ret;
 
 	for (int i = 0; i < _data.size(); i++) {
@@ -458,11 +495,11 @@ Graph Track::cadence() const
 		qreal c;
 
 		for (int j = 0; j < sd.size(); j++) {
-			if (sd.at(j).hasCadence() && seg.stop.contains(j)) {
+			if (sd.hasCadence(j) && seg.stop.contains(j)) {
 				c = 0;
 				stop.append(gs.size());
-			} else if (sd.at(j).hasCadence() && !seg.outliers.contains(j))
-				c = sd.at(j).cadence();
+			} else if (sd.hasCadence(j) && !seg.outliers.contains(j))
+				c = sd.cadence(j);
 			else
 				continue;
 
@@ -476,11 +513,16 @@ Graph Track::cadence() const
 			filtered[stop.at(j)].setY(0);
 	}
 
+	_cadence = Series(ret, _cadenceWindow);
+
 	return ret;
 }
 
 Graph Track::power() const
 {
+	if (_power.window == _powerWindow)
+		return _power.graph;
+
 	Graph ret;
 	QList<int> stop;
 	qreal p;
@@ -494,11 +536,11 @@ Graph Track::power() const
 		GraphSegment gs;
 
 		for (int j = 0; j < sd.size(); j++) {
-			if (sd.at(j).hasPower() && seg.stop.contains(j)) {
+			if (sd.hasPower(j) && seg.stop.contains(j)) {
 				p = 0;
 				stop.append(gs.size());
-			} else if (sd.at(j).hasPower() && !seg.outliers.contains(j))
-				p = sd.at(j).power();
+			} else if (sd.hasPower(j) && !seg.outliers.contains(j))
+				p = sd.power(j);
 			else
 				continue;
 
@@ -512,11 +554,17 @@ Graph Track::power() const
 			filtered[stop.at(j)].setY(0);
 	}
 
+	_power = Series(ret, _powerWindow);
+
 	return ret;
 }
 
 Graph Track::evScalar(EVData::scalar_t id) const
 {
+	QHash<int, Graph>::const_iterator it = _evScalar.find(id);
+	if (it != _evScalar.constEnd())
+		return *it;
+
 	Graph ret;
 
 	for (int i = 0; i < _data.size(); i++) {
@@ -527,7 +575,7 @@ Graph Track::evScalar(EVData::scalar_t id) const
 		GraphSegment gs;
 
 		for (int j = 0; j < sd.count(); j++) {
-			qreal val = sd.at(j).evData().scalar(id);
+			qreal val = sd.evData(j).scalar(id);
 			if (!std::isnan(val) && !seg.outliers.contains(j))
 				gs.append(GraphPoint(seg.distance.at(j), seg.time.at(j), val));
 		}
@@ -535,6 +583,8 @@ Graph Track::evScalar(EVData::scalar_t id) const
 		ret.append(gs);
 	}
 
+	_evScalar.insert(id, ret);
+
 	return ret;
 }
 
@@ -572,11 +622,14 @@ qreal Track::movingTime() const
 QDateTime Track::date() const
 {
 	return (_data.size() && _data.first().size())
-	  ? _data.first().first().timestamp() : QDateTime();
+	  ? _data.first().timestamp(0) : QDateTime();
 }
 
 Path Track::path() const
 {
+	if (_hasPath)
+		return _path;
+
 	Path ret;
 
 	for (int i = 0; i < _data.size(); i++) {
@@ -589,10 +642,13 @@ Path Track::path() const
 
 		for (int j = 0; j < sd.size(); j++)
 			if (!seg.outliers.contains(j) && !discardStopPoint(seg, j))
-				ps.append(PathPoint(sd.at(j).coordinates(),
+				ps.append(PathPoint(sd.coordinates(j),
 				  seg.distance.at(j)));
 	}
 
+	_path = ret;
+	_hasPath = true;
+
 	return ret;
 }
 
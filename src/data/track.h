@@ -3,6 +3,7 @@
 
 #include <QVector>
 #include <QSet>
+#include <QHash>
 #include <QDateTime>
 #include <QDir>
 #include "trackdata.h"
@@ -64,6 +65,16 @@ private:
 		QSet<int> stop;
 	};
 
+	/* A lazily computed graph together with the filter window it was
+	   computed with (-1 = not computed yet). */
+	struct Series {
+		Series() : window(-1) {}
+		Series(const Graph &g, int w) : graph(g), window(w) {}
+
+		Graph graph;
+		int window;
+	};
+
 	bool discardStopPoint(const Segment &seg, int i) const;
 
 	Graph demElevation() const;
@@ -75,6 +86,14 @@ private:
 	QList<Segment> _segments;
 	qreal _pause;
 
+	mutable Series _gpsElevation, _demElevation;
+	mutable Series _computedSpeed, _reportedSpeed;
+	mutable Series _heartRate, _cadence, _power;
+	mutable Series _temperature, _ratio;
+	mutable QHash<int, Graph> _evScalar;
+	mutable Path _path;
+	mutable bool _hasPath;
+
 	static bool _outlierEliminate;
 	static int _elevationWindow;
 	static int _speedWindow;
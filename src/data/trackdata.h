@@ -4,11 +4,9 @@
 #include <QList>
 #include <QVector>
 #include <QString>
-#include "trackpoint.h"
+#include "segmentdata.h"
 #include "link.h"
 
-typedef QVector<Trackpoint> SegmentData;
-
 class TrackData : public QList<SegmentData>
 {
 public:
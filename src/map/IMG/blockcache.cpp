@@ -0,0 +1,48 @@
+#include <QCache>
+#include <QMutex>
+#include <QAtomicInt>
+#include "blockcache.h"
+
+
+#define CACHE_SIZE (16 * 1024 * 1024) /* bytes */
+
+static inline quint64 key(quint32 file, int block)
+{
+	return ((quint64)file << 32) | (quint32)block;
+}
+
+static QMutex &lock()
+{
+	static QMutex lock;
+	return lock;
+}
+
+static QCache<quint64, QByteArray> &cache()
+{
+	static QCache<quint64, QByteArray> cache(CACHE_SIZE);
+	return cache;
+}
+
+quint32 BlockCache::id()
+{
+	static QAtomicInt id(0);
+	return (quint32)id.fetchAndAddOrdered(1);
+}
+
+bool BlockCache::find(quint32 file, int block, QByteArray &data)
+{
+	QMutexLocker locker(&lock());
+	QByteArray *ba = cache().object(key(file, block));
+
+	if (!ba)
+		return false;
+	data = *ba;
+
+	return true;
+}
+
+void BlockCache::insert(quint32 file, int block, const QByteArray &data)
+{
+	QMutexLocker locker(&lock());
+	cache().insert(key(file, block), new QByteArray(data), data.size());
+}
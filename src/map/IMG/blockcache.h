@@ -0,0 +1,17 @@
+#ifndef BLOCKCACHE_H
+#define BLOCKCACHE_H
+
+#include <QByteArray>
+
+/* Process-wide LRU cache of the raw IMG/GMAP file blocks shared by all the
+   sub-files and threads. The files are identified by an unique ID obtained
+   with BlockCache::id(). */
+namespace BlockCache
+{
+	quint32 id();
+
+	bool find(quint32 file, int block, QByteArray &data);
+	void insert(quint32 file, int block, const QByteArray &data);
+}
+
+#endif // BLOCKCACHE_H
@@ -0,0 +1,223 @@
+#include <QFileInfo>
+#include <QDir>
+#include <QDateTime>
+#include <QStringList>
+#include <QAtomicInt>
+#include <QSqlQuery>
+#include <QVariant>
+#include "diskcache.h"
+
+
+#define IDENTITY_KEY "identity"
+#define VERSION_KEY  "version"
+#define VERSION      "2"
+#define CACHE_LIMIT  (256LL * 1024LL * 1024LL) /* bytes */
+#define ATIME_DELAY  3600 /* s */
+#define BUSY_TIMEOUT "QSQLITE_BUSY_TIMEOUT=1000" /* ms */
+
+static qint64 now()
+{
+	return QDateTime::currentMSecsSinceEpoch() / 1000;
+}
+
+DiskCache::DiskCache(const QString &fileName, const QString &identity)
+  : _fileName(fileName), _connection("IMG-" + fileName), _valid(false),
+  _size(0)
+{
+	if (!QDir().mkpath(QFileInfo(fileName).absolutePath())) {
+		qWarning("%s: Error creating cache directory", qPrintable(fileName));
+		return;
+	}
+
+	_db = QSqlDatabase::addDatabase("QSQLITE", _connection);
+	_db.setDatabaseName(fileName);
+	_db.setConnectOptions(BUSY_TIMEOUT);
+	if (!_db.open()) {
+		qWarning("%s: Error opening cache database", qPrintable(fileName));
+		return;
+	}
+
+	if (!init(identity)) {
+		qWarning("%s: Error initializing cache database",
+		  qPrintable(fileName));
+		_db.close();
+		return;
+	}
+
+	_valid = true;
+}
+
+DiskCache::~DiskCache()
+{
+	_db.close();
+	_db = QSqlDatabase();
+	QSqlDatabase::removeDatabase(_connection);
+}
+
+bool DiskCache::init(const QString &identity)
+{
+	QSqlQuery query(_db);
+
+	/* The database is a pure cache, it is not worth to wait for the data to
+	   reach the disk on every tile insert. */
+	query.exec("PRAGMA synchronous = OFF");
+
+	if (!query.exec("CREATE TABLE IF NOT EXISTS metadata "
+	  "(name TEXT PRIMARY KEY, value TEXT)"))
+		return false;
+
+	/* Caches of the older versions have no access times, they are simply
+	   dropped */
+	if (!query.prepare("SELECT value FROM metadata WHERE name = ?"))
+		return false;
+	query.addBindValue(VERSION_KEY);
+	if (!query.exec())
+		return false;
+	if (!(query.first() && query.value(0).toString() == VERSION)) {
+		if (!query.exec("DROP TABLE IF EXISTS tiles"))
+			return false;
+		if (!query.prepare("INSERT OR REPLACE INTO metadata (name, value) "
+		  "VALUES (?, ?)"))
+			return false;
+		query.addBindValue(VERSION_KEY);
+		query.addBindValue(VERSION);
+		if (!query.exec())
+			return false;
+	}
+
+	if (!query.exec("CREATE TABLE IF NOT EXISTS tiles "
+	  "(key TEXT PRIMARY KEY, data BLOB, atime INTEGER, size INTEGER)")
+	  || !query.exec("CREATE INDEX IF NOT EXISTS tiles_atime ON tiles (atime)"))
+		return false;
+
+	if (!query.prepare("SELECT value FROM metadata WHERE name = ?"))
+		return false;
+	query.addBindValue(IDENTITY_KEY);
+	if (!query.exec())
+		return false;
+	if (query.first() && query.value(0).toString() == identity) {
+		if (query.exec("SELECT SUM(size) FROM tiles") && query.first())
+			_size = query.value(0).toLongLong();
+		return true;
+	}
+
+	if (!query.exec("DELETE FROM tiles"))
+		return false;
+	if (!query.prepare("INSERT OR REPLACE INTO metadata (name, value) "
+	  "VALUES (?, ?)"))
+		return false;
+	query.addBindValue(IDENTITY_KEY);
+	query.addBindValue(identity);
+
+	return query.exec();
+}
+
+/* A SQL connection may only be used from the thread that created it, so the
+   lookup opens its own connection to be usable from the render jobs. */
+bool DiskCache::find(const QString &fileName, const QString &key,
+  QByteArray &data)
+{
+	static QAtomicInt id(0);
+	QString connection("IMG-reader-"
+	  + QString::number(id.fetchAndAddRelaxed(1)));
+	bool ret = false;
+
+	{
+		QSqlDatabase db(QSqlDatabase::addDatabase("QSQLITE", connection));
+		db.setDatabaseName(fileName);
+		db.setConnectOptions(BUSY_TIMEOUT);
+		if (db.open()) {
+			QSqlQuery query(db);
+			query.prepare("SELECT data, atime FROM tiles WHERE key = ?");
+			query.addBindValue(key);
+			if (query.exec() && query.first()) {
+				data = query.value(0).toByteArray();
+				ret = !data.isEmpty();
+
+				/* The access time is only needed for the eviction order, so
+				   it is not updated on every access */
+				qint64 t = now();
+				if (t - query.value(1).toLongLong() > ATIME_DELAY) {
+					query.finish();
+					query.prepare("UPDATE tiles SET atime = ? WHERE key = ?");
+					query.addBindValue(t);
+					query.addBindValue(key);
+					query.exec();
+				}
+			}
+			db.close();
+		}
+	}
+	QSqlDatabase::removeDatabase(connection);
+
+	return ret;
+}
+
+void DiskCache::insert(const QString &key, const QByteArray &data)
+{
+	if (!_valid)
+		return;
+
+	QSqlQuery query(_db);
+	qint64 old = 0;
+
+	/* A replaced tile must not be accounted twice */
+	query.prepare("SELECT size FROM tiles WHERE key = ?");
+	query.addBindValue(key);
+	if (query.exec() && query.first())
+		old = query.value(0).toLongLong();
+	query.finish();
+
+	query.prepare("INSERT OR REPLACE INTO tiles (key, data, atime, size) "
+	  "VALUES (?, ?, ?, ?)");
+	query.addBindValue(key);
+	query.addBindValue(data);
+	query.addBindValue(now());
+	query.addBindValue(data.size());
+	if (query.exec())
+		_size += data.size() - old;
+
+	if (_size > CACHE_LIMIT)
+		evict();
+}
+
+/* Drops the least recently used tiles until the cache size gets 10% below
+   the limit. */
+void DiskCache::evict()
+{
+	QSqlQuery query(_db);
+	QStringList keys;
+
+	if (query.exec("SELECT SUM(size) FROM tiles") && query.first())
+		_size = query.value(0).toLongLong();
+	if (_size <= CACHE_LIMIT)
+		return;
+
+	qint64 target = CACHE_LIMIT - CACHE_LIMIT / 10;
+	if (!query.exec("SELECT key, size FROM tiles ORDER BY atime"))
+		return;
+	while (_size > target && query.next()) {
+		keys.append(query.value(0).toString());
+		_size -= query.value(1).toLongLong();
+	}
+	query.finish();
+
+	_db.transaction();
+	query.prepare("DELETE FROM tiles WHERE key = ?");
+	for (int i = 0; i < keys.size(); i++) {
+		query.addBindValue(keys.at(i));
+		query.exec();
+	}
+	_db.commit();
+}
+
+void DiskCache::clear()
+{
+	if (!_valid)
+		return;
+
+	QSqlQuery query(_db);
+	query.exec("DELETE FROM tiles");
+	query.exec("VACUUM");
+	_size = 0;
+}
@@ -0,0 +1,38 @@
+#ifndef DISKCACHE_H
+#define DISKCACHE_H
+
+#include <QString>
+#include <QByteArray>
+#include <QSqlDatabase>
+
+/* Persistent cache of rendered (encoded) raster tiles. One SQLite database
+   per map, the whole content is dropped when the identity of the rendering
+   inputs (map files, TYP style, ...) differs from the stored one. The cache
+   size is limited, the least recently used tiles are dropped first. */
+class DiskCache
+{
+public:
+	DiskCache(const QString &fileName, const QString &identity);
+	~DiskCache();
+
+	bool isValid() const {return _valid;}
+	const QString &fileName() const {return _fileName;}
+
+	void insert(const QString &key, const QByteArray &data);
+	void clear();
+
+	static bool find(const QString &fileName, const QString &key,
+	  QByteArray &data);
+
+private:
+	bool init(const QString &identity);
+	void evict();
+
+	QString _fileName;
+	QString _connection;
+	QSqlDatabase _db;
+	bool _valid;
+	qint64 _size;
+};
+
+#endif // DISKCACHE_H
@@ -1,6 +1,7 @@
 #include <QMap>
 #include <QtEndian>
 #include "vectortile.h"
+#include "blockcache.h"
 #include "img.h"
 
 
@@ -24,7 +25,8 @@ static SubFile::Type tileType(const char str[3])
 		return SubFile::Unknown;
 }
 
-IMG::IMG(const QString &fileName) : _file(fileName)
+IMG::IMG(const QString &fileName)
+  : _file(fileName), _id(BlockCache::id()), _map(0), _mapSize(0)
 {
 #define CHECK(condition) \
 	if (!(condition)) { \
@@ -61,6 +63,14 @@ IMG::IMG(const QString &fileName) : _file(fileName)
 	_name = QString::fromLatin1(nba.constData(), nba.size()-1).trimmed();
 	_blockBits = e1 + e2;
 
+	/* Map the whole file into memory if possible (not XOR-ed, enough address
+	   space) so the sub-files can be decoded without copying the data. */
+	if (!_key) {
+		_mapSize = _file.size();
+		if (!(_map = _file.map(0, _mapSize)))
+			_mapSize = 0;
+	}
+
 	// Read the FAT table
 	quint8 flag;
 	quint64 offset = 0x200;
@@ -199,12 +209,24 @@ template<class T> bool IMG::readValue(T &val)
 	return true;
 }
 
-bool IMG::readBlock(int blockNum, char *data)
+bool IMG::readBlock(int blockNum, QByteArray &data)
 {
-	if (!_file.seek((quint64)blockNum << _blockBits))
-		return false;
-	if (read(data, 1U<<_blockBits) < 1U<<_blockBits)
+	if (BlockCache::find(_id, blockNum, data))
+		return true;
+
+	QByteArray block;
+	block.resize(1U<<_blockBits);
+
+	_lock.lock();
+	bool ret = _file.seek((quint64)blockNum << _blockBits)
+	  && read(block.data(), 1U<<_blockBits) == 1U<<_blockBits;
+	_lock.unlock();
+
+	if (!ret)
 		return false;
 
+	BlockCache::insert(_id, blockNum, block);
+	data = block;
+
 	return true;
 }
@@ -2,6 +2,7 @@
 #define IMG_H
 
 #include <QFile>
+#include <QMutex>
 #include "mapdata.h"
 
 class IMG : public MapData
@@ -15,13 +16,17 @@ private:
 	friend class SubFile;
 
 	unsigned blockBits() const {return _blockBits;}
-	bool readBlock(int blockNum, char *data);
+	bool readBlock(int blockNum, QByteArray &data);
 	qint64 read(char *data, qint64 maxSize);
 	template<class T> bool readValue(T &val);
 
 	QFile _file;
 	quint8 _key;
 	unsigned _blockBits;
+	quint32 _id;
+	QMutex _lock;
+	const quint8 *_map;
+	qint64 _mapSize;
 };
 
 #endif // IMG_H
@@ -19,12 +19,13 @@ public:
 	  _codec(0), _offset(0), _size(0), _poiOffset(0), _poiSize(0),
 	  _poiMultiplier(0), _multiplier(0), _encoding(0) {}
 
+	bool initialized() const {return (_multiplier != 0);}
+	bool init(Handle &hdl);
+
 	Label label(Handle &hdl, quint32 offset, bool poi = false,
 	  bool capitalize = true);
 
 private:
-	bool init(Handle &hdl);
-
 	Label label6b(Handle &hdl, quint32 offset, bool capitalize) const;
 	Label label8b(Handle &hdl, quint32 offset, bool capitalize) const;
 
@@ -10,9 +10,9 @@ struct PolyCTX
 {
 	PolyCTX(const RectC &rect, int bits, bool baseMap,
 	  QList<MapData::Poly> *polygons, QList<MapData::Poly> *lines,
-	  QCache<const SubDiv*, MapData::Polys> *polyCache)
+	  QCache<const SubDiv*, MapData::Polys> *polyCache, QMutex *lock)
 	  : rect(rect), bits(bits), baseMap(baseMap), polygons(polygons),
-	  lines(lines), polyCache(polyCache) {}
+	  lines(lines), polyCache(polyCache), lock(lock) {}
 
 	const RectC &rect;
 	int bits;
@@ -20,28 +20,30 @@ struct PolyCTX
 	QList<MapData::Poly> *polygons;
 	QList<MapData::Poly> *lines;
 	QCache<const SubDiv*, MapData::Polys> *polyCache;
+	QMutex *lock;
 };
 
 struct PointCTX
 {
 	PointCTX(const RectC &rect, int bits, bool baseMap,
 	  QList<MapData::Point> *points,
-	  QCache<const SubDiv*, QList<MapData::Point> > *pointCache)
+	  QCache<const SubDiv*, QList<MapData::Point> > *pointCache, QMutex *lock)
 	  : rect(rect), bits(bits), baseMap(baseMap), points(points),
-	  pointCache(pointCache) {}
+	  pointCache(pointCache), lock(lock) {}
 
 	const RectC &rect;
 	int bits;
 	bool baseMap;
 	QList<MapData::Point> *points;
 	QCache<const SubDiv*, QList<MapData::Point> > *pointCache;
+	QMutex *lock;
 };
 
 inline bool polyCb(VectorTile *tile, void *context)
 {
 	PolyCTX *ctx = (PolyCTX*)context;
 	tile->polys(ctx->rect, ctx->bits, ctx->baseMap, ctx->polygons, ctx->lines,
-	  ctx->polyCache);
+	  ctx->polyCache, ctx->lock);
 	return true;
 }
 
@@ -49,7 +51,7 @@ inline bool pointCb(VectorTile *tile, void *context)
 {
 	PointCTX *ctx = (PointCTX*)context;
 	tile->points(ctx->rect, ctx->bits, ctx->baseMap, ctx->points,
-	  ctx->pointCache);
+	  ctx->pointCache, ctx->lock);
 	return true;
 }
 
@@ -74,7 +76,7 @@ MapData::~MapData()
 void MapData::polys(const RectC &rect, int bits, QList<Poly> *polygons,
   QList<Poly> *lines)
 {
-	PolyCTX ctx(rect, bits, _baseMap, polygons, lines, &_polyCache);
+	PolyCTX ctx(rect, bits, _baseMap, polygons, lines, &_polyCache, &_lock);
 	double min[2], max[2];
 
 	min[0] = rect.left();
@@ -87,7 +89,7 @@ void MapData::polys(const RectC &rect, int bits, QList<Poly> *polygons,
 
 void MapData::points(const RectC &rect, int bits, QList<Point> *points)
 {
-	PointCTX ctx(rect, bits, _baseMap, points, &_pointCache);
+	PointCTX ctx(rect, bits, _baseMap, points, &_pointCache, &_lock);
 	double min[2], max[2];
 
 	min[0] = rect.left();
@@ -123,6 +125,8 @@ void MapData::clear()
 	delete _style;
 	_style = 0;
 
+	_lock.lock();
 	_polyCache.clear();
 	_pointCache.clear();
+	_lock.unlock();
 }
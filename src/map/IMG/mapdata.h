@@ -4,6 +4,7 @@
 #include <QList>
 #include <QPointF>
 #include <QCache>
+#include <QMutex>
 #include <QDebug>
 #include "common/rectc.h"
 #include "common/rtree.h"
@@ -20,9 +21,8 @@ class MapData
 public:
 	struct Poly {
 		/* QPointF insted of Coordinates for performance reasons (no need to
-		   duplicate all the vectors for drawing). Note, that we do not want to
-		   ll2xy() the points in the IMG class as this can not be done in
-		   parallel. */
+		   duplicate all the vectors for drawing). The points are converted
+		   to image coordinates in place by the rendering job. */
 		QVector<QPointF> points;
 		Label label;
 		quint32 type;
@@ -90,6 +90,7 @@ protected:
 private:
 	QCache<const SubDiv*, Polys> _polyCache;
 	QCache<const SubDiv*, QList<Point> > _pointCache;
+	QMutex _lock;
 };
 
 #ifndef QT_NO_DEBUG
@@ -21,14 +21,15 @@ public:
 	  _offset(0), _size(0), _linksOffset(0), _linksSize(0), _multiplier(0),
 	  _linksShift(0) {}
 
+	bool initialized() const {return (_multiplier != 0);}
+	bool init(Handle &hdl);
+
 	bool lblOffset(Handle &hdl, quint32 netOffset, quint32 &lblOffset);
 	bool link(const SubDiv *subdiv, Handle &hdl, NODFile *nod, Handle &nodHdl,
 	  const NODFile::BlockInfo blockInfo, quint8 linkId, quint8 lineId,
 	  const HuffmanTable &table, QList<IMG::Poly> *lines);
 
 private:
-	bool init(Handle &hdl);
-
 	quint32 _offset, _size, _linksOffset, _linksSize;
 	quint8 _multiplier, _linksShift;
 	quint8 _tableId;
@@ -35,6 +35,9 @@ public:
 	  _blockSize(0), _indexRecordSize(0), _blockRecordSize(0), _blockShift(0),
 	  _nodeShift(0) {}
 
+	bool initialized() const {return (_indexRecordSize != 0);}
+	bool init(Handle &hdl);
+
 	quint32 indexIdSize(Handle &hdl);
 	bool blockInfo(Handle &hdl, quint32 blockIndexId,
 	  BlockInfo &blockInfo) const;
@@ -44,8 +47,6 @@ public:
 	  quint32 &type) const;
 
 private:
-	bool init(Handle &hdl);
-
 	quint32 _indexOffset, _indexSize, _indexFlags, _blockOffset, _blockSize;
 	quint16 _indexRecordSize, _blockRecordSize;
 	quint8 _blockShift, _nodeShift;
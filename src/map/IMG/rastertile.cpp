@@ -1,7 +1,9 @@
 #include <QFont>
 #include <QPainter>
+#include "map/rectd.h"
 #include "textpathitem.h"
 #include "textpointitem.h"
+#include "textitemindex.h"
 #include "bitmapline.h"
 #include "style.h"
 #include "rastertile.h"
@@ -10,6 +12,8 @@
 #define AREA(rect) \
 	(rect.size().width() * rect.size().height())
 
+#define TEXT_EXTENT 160
+
 static const QColor shieldColor(Qt::white);
 static const QColor shieldBgColor1("#dd3e3e");
 static const QColor shieldBgColor2("#379947");
@@ -162,9 +166,60 @@ static bool rectNearPolygon(const QPolygonF &polygon, const QRectF &rect)
 }
 
 
+RectC RasterTile::rectC(const QRectF &rect) const
+{
+	QRectF r(rect & _bounds.adjusted(0.5, 0.5, -0.5, -0.5));
+	RectD rd(_transform.img2proj(r.topLeft()),
+	  _transform.img2proj(r.bottomRight()));
+
+	return rd.toRectC(_proj, 4);
+}
+
+void RasterTile::ll2xy(QList<MapData::Poly> &polys) const
+{
+	QVector<Coordinates> c;
+	QVector<PointD> pp;
+
+	for (int i = 0; i < polys.size(); i++) {
+		QVector<QPointF> &points = polys[i].points;
+		int n = points.size();
+
+		c.resize(n);
+		pp.resize(n);
+		for (int j = 0; j < n; j++)
+			c[j] = Coordinates(points.at(j).x(), points.at(j).y());
+
+		_proj.ll2xy(c.constData(), pp.data(), n);
+		_transform.proj2img(pp.constData(), points.data(), n);
+	}
+}
+
+void RasterTile::ll2xy(QList<MapData::Point> &points) const
+{
+	for (int i = 0; i < points.size(); i++) {
+		QPointF p(ll2xy(points.at(i).coordinates));
+		points[i].coordinates = Coordinates(p.x(), p.y());
+	}
+}
+
+void RasterTile::fetchData()
+{
+	QRectF polyRect(_xy, QSizeF(_img.width(), _img.height()));
+	_data->polys(rectC(polyRect), _zoom, &_polygons, &_lines);
+	ll2xy(_polygons);
+	ll2xy(_lines);
+
+	QRectF pointRect(polyRect.adjusted(-TEXT_EXTENT, -TEXT_EXTENT,
+	  TEXT_EXTENT, TEXT_EXTENT));
+	_data->points(rectC(pointRect), _zoom, &_points);
+	ll2xy(_points);
+}
+
 void RasterTile::render()
 {
-	QList<TextItem*> textItems;
+	TextItemIndex textItems;
+
+	fetchData();
 
 	processPoints(textItems);
 	processPolygons(textItems);
@@ -182,62 +237,90 @@ void RasterTile::render()
 	drawTextItems(&painter, textItems);
 	//painter.setPen(Qt::red);
 	//painter.drawRect(QRect(_xy, _img.size()));
-
-	qDeleteAll(textItems);
 }
 
 void RasterTile::drawPolygons(QPainter *painter)
 {
-	for (int n = 0; n < _style->drawOrder().size(); n++) {
-		for (int i = 0; i < _polygons.size(); i++) {
-			const MapData::Poly &poly = _polygons.at(i);
-			if (poly.type != _style->drawOrder().at(n))
-				continue;
-			const Style::Polygon &style = _style->polygon(poly.type);
+	const QList<quint32> &drawOrder = _style->drawOrder();
+	QVector<int> levels(_polygons.size());
+	QVector<int> offsets(drawOrder.size() + 1, 0);
 
-			painter->setPen(style.pen());
-			painter->setBrush(style.brush());
-			painter->drawPolygon(poly.points);
-		}
+	// Counting sort of the polygons by their draw order level
+	for (int i = 0; i < _polygons.size(); i++) {
+		levels[i] = _style->drawOrderLevel(_polygons.at(i).type);
+		if (levels.at(i) >= 0)
+			offsets[levels.at(i) + 1]++;
+	}
+	for (int n = 1; n < offsets.size(); n++)
+		offsets[n] += offsets.at(n - 1);
+
+	QVector<int> index(offsets.last());
+	QVector<int> pos(offsets);
+	for (int i = 0; i < _polygons.size(); i++)
+		if (levels.at(i) >= 0)
+			index[pos[levels.at(i)]++] = i;
+
+	for (int n = 0; n < drawOrder.size(); n++) {
+		if (offsets.at(n) == offsets.at(n + 1))
+			continue;
+
+		const Style::Polygon &style = _style->polygon(drawOrder.at(n));
+		painter->setPen(style.pen());
+		painter->setBrush(style.brush());
+
+		for (int i = offsets.at(n); i < offsets.at(n + 1); i++)
+			painter->drawPolygon(_polygons.at(index.at(i)).points);
 	}
 }
 
 void RasterTile::drawLines(QPainter *painter)
 {
+	/* The lines are sorted by type in processLines() so the painter state
+	   changes only when the line type changes. */
+	const Style::Line *style = 0;
+
 	painter->setBrush(Qt::NoBrush);
 
 	for (int i = 0; i < _lines.size(); i++) {
 		const MapData::Poly &poly = _lines.at(i);
-		const Style::Line &style = _style->line(poly.type);
 
-		if (style.background() == Qt::NoPen)
+		if (!i || poly.type != _lines.at(i - 1).type) {
+			style = &_style->line(poly.type);
+			if (style->background() != Qt::NoPen)
+				painter->setPen(style->background());
+		}
+		if (style->background() == Qt::NoPen)
 			continue;
 
-		painter->setPen(style.background());
 		painter->drawPolyline(poly.points);
 	}
 
 	for (int i = 0; i < _lines.size(); i++) {
 		const MapData::Poly &poly = _lines.at(i);
-		const Style::Line &style = _style->line(poly.type);
 
-		if (!style.img().isNull())
-			BitmapLine::draw(painter, poly.points, style.img());
-		else if (style.foreground() != Qt::NoPen) {
-			painter->setPen(style.foreground());
-			painter->drawPolyline(poly.points);
+		if (!i || poly.type != _lines.at(i - 1).type) {
+			style = &_style->line(poly.type);
+			if (style->img().isNull() && style->foreground() != Qt::NoPen)
+				painter->setPen(style->foreground());
 		}
+
+		if (!style->img().isNull())
+			BitmapLine::draw(painter, poly.points, style->img());
+		else if (style->foreground() != Qt::NoPen)
+			painter->drawPolyline(poly.points);
 	}
 }
 
 void RasterTile::drawTextItems(QPainter *painter,
-  const QList<TextItem*> &textItems)
+  const TextItemIndex &textItems)
 {
-	for (int i = 0; i < textItems.size(); i++)
-		textItems.at(i)->paint(painter);
+	const QList<TextItem*> &items = textItems.items();
+
+	for (int i = 0; i < items.size(); i++)
+		items.at(i)->paint(painter);
 }
 
-void RasterTile::processPolygons(QList<TextItem*> &textItems)
+void RasterTile::processPolygons(TextItemIndex &textItems)
 {
 	for (int i = 0; i < _polygons.size(); i++) {
 		MapData::Poly &poly = _polygons[i];
@@ -252,16 +335,16 @@ void RasterTile::processPolygons(QList<TextItem*> &textItems)
 			TextPointItem *item = new TextPointItem(
 			  centroid(poly.points).toPoint(), &poly.label.text(),
 			  poiFont(), 0, &style.brush().color());
-			if (item->isValid() && !item->collides(textItems)
+			if (item->isValid() && !textItems.collides(item)
 			  && rectNearPolygon(poly.points, item->boundingRect()))
-				textItems.append(item);
+				textItems.insert(item);
 			else
 				delete item;
 		}
 	}
 }
 
-void RasterTile::processLines(QList<TextItem*> &textItems)
+void RasterTile::processLines(TextItemIndex &textItems)
 {
 	QRect tileRect(_xy, _img.size());
 
@@ -273,7 +356,7 @@ void RasterTile::processLines(QList<TextItem*> &textItems)
 }
 
 void RasterTile::processStreetNames(const QRect &tileRect,
-  QList<TextItem*> &textItems)
+  TextItemIndex &textItems)
 {
 	for (int i = 0; i < _lines.size(); i++) {
 		MapData::Poly &poly = _lines[i];
@@ -294,15 +377,15 @@ void RasterTile::processStreetNames(const QRect &tileRect,
 
 		TextPathItem *item = new TextPathItem(poly.points,
 		  &poly.label.text(), tileRect, fnt, color);
-		if (item->isValid() && !item->collides(textItems))
-			textItems.append(item);
+		if (item->isValid() && !textItems.collides(item))
+			textItems.insert(item);
 		else
 			delete item;
 	}
 }
 
 void RasterTile::processShields(const QRect &tileRect,
-  QList<TextItem*> &textItems)
+  TextItemIndex &textItems)
 {
 	for (int type = FIRST_SHIELD; type <= LAST_SHIELD; type++) {
 		if (minShieldZoom(static_cast<Label::Shield::Type>(type)) > _zoom)
@@ -347,7 +430,7 @@ void RasterTile::processShields(const QRect &tileRect,
 
 			bool valid = false;
 			while (true) {
-				if (!item->collides(textItems)
+				if (!textItems.collides(item)
 				  && tileRect.contains(item->boundingRect().toRect())) {
 					valid = true;
 					break;
@@ -358,14 +441,14 @@ void RasterTile::processShields(const QRect &tileRect,
 			}
 
 			if (valid)
-				textItems.append(item);
+				textItems.insert(item);
 			else
 				delete item;
 		}
 	}
 }
 
-void RasterTile::processPoints(QList<TextItem*> &textItems)
+void RasterTile::processPoints(TextItemIndex &textItems)
 {
 	qSort(_points);
 
@@ -397,8 +480,8 @@ void RasterTile::processPoints(QList<TextItem*> &textItems)
 
 		TextPointItem *item = new TextPointItem(QPoint(point.coordinates.lon(),
 		  point.coordinates.lat()), label, fnt, img, color);
-		if (item->isValid() && !item->collides(textItems))
-			textItems.append(item);
+		if (item->isValid() && !textItems.collides(item))
+			textItems.insert(item);
 		else
 			delete item;
 	}
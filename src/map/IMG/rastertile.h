@@ -2,43 +2,57 @@
 #define RASTERTILE_H
 
 #include <QImage>
+#include "map/projection.h"
+#include "map/transform.h"
+#include "map/tilecache.h"
 #include "mapdata.h"
 
 class QPainter;
-class TextItem;
+class TextItemIndex;
 class Style;
 
 class RasterTile
 {
 public:
-	RasterTile(const Style *style, int zoom, const QRect &rect,
-	  const QString &key, const QList<MapData::Poly> &polygons,
-	  const QList<MapData::Poly> &lines, QList<MapData::Point> &points)
-	  : _style(style), _zoom(zoom), _xy(rect.topLeft()),
-	  _key(key), _img(rect.size(), QImage::Format_ARGB32_Premultiplied),
-	  _polygons(polygons), _lines(lines), _points(points) {}
-
-	const QString &key() const {return _key;}
+	RasterTile(MapData *data, const Projection &proj,
+	  const Transform &transform, const QRectF &bounds, int zoom,
+	  const QRect &rect, const TileCache::Key &key)
+	  : _data(data), _proj(proj), _transform(transform), _bounds(bounds),
+	  _style(data->style()), _zoom(zoom), _xy(rect.topLeft()), _key(key),
+	  _img(rect.size(), QImage::Format_ARGB32_Premultiplied) {}
+
+	const TileCache::Key &key() const {return _key;}
 	const QPoint &xy() const {return _xy;}
 	const QImage &img() const {return _img;}
 
 	void render();
 
 private:
+	void fetchData();
+	RectC rectC(const QRectF &rect) const;
+	QPointF ll2xy(const Coordinates &c) const
+	  {return _transform.proj2img(_proj.ll2xy(c));}
+	void ll2xy(QList<MapData::Poly> &polys) const;
+	void ll2xy(QList<MapData::Point> &points) const;
+
 	void drawPolygons(QPainter *painter);
 	void drawLines(QPainter *painter);
-	void drawTextItems(QPainter *painter, const QList<TextItem*> &textItems);
-
-	void processPolygons(QList<TextItem *> &textItems);
-	void processLines(QList<TextItem*> &textItems);
-	void processPoints(QList<TextItem*> &textItems);
-	void processShields(const QRect &tileRect, QList<TextItem*> &textItems);
-	void processStreetNames(const QRect &tileRect, QList<TextItem*> &textItems);
-
+	void drawTextItems(QPainter *painter, const TextItemIndex &textItems);
+
+	void processPolygons(TextItemIndex &textItems);
+	void processLines(TextItemIndex &textItems);
+	void processPoints(TextItemIndex &textItems);
+	void processShields(const QRect &tileRect, TextItemIndex &textItems);
+	void processStreetNames(const QRect &tileRect, TextItemIndex &textItems);
+
+	MapData *_data;
+	Projection _proj;
+	Transform _transform;
+	QRectF _bounds;
 	const Style *_style;
 	int _zoom;
 	QPoint _xy;
-	QString _key;
+	TileCache::Key _key;
 	QImage _img;
 	QList<MapData::Poly> _polygons;
 	QList<MapData::Poly> _lines;
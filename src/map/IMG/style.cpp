@@ -957,6 +957,10 @@ Style::Style(SubFile *typ)
 
 	if (typ)
 		parseTYPFile(typ);
+
+	for (int i = 0; i < _drawOrder.size(); i++)
+		if (!_drawOrderLevels.contains(_drawOrder.at(i)))
+			_drawOrderLevels.insert(_drawOrder.at(i), i);
 }
 
 const Style::Line &Style::line(quint32 type) const
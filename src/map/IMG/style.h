@@ -1,6 +1,7 @@
 #ifndef STYLE_H
 #define STYLE_H
 
+#include <QHash>
 #include <QPen>
 #include <QBrush>
 #include <QDebug>
@@ -107,6 +108,8 @@ public:
 	const Polygon &polygon(quint32 type) const;
 	const Point &point(quint32 type) const;
 	const QList<quint32> &drawOrder() const {return _drawOrder;}
+	int drawOrderLevel(quint32 type) const
+	  {return _drawOrderLevels.value(type, -1);}
 
 	static bool isContourLine(quint32 type)
 	  {return ((type >= TYPE(0x20) && type <= TYPE(0x25))
@@ -161,6 +164,7 @@ private:
 	QMap<quint32, Polygon> _polygons;
 	QMap<quint32, Point> _points;
 	QList<quint32> _drawOrder;
+	QHash<quint32, int> _drawOrderLevels;
 };
 
 #ifndef QT_NO_DEBUG
@@ -1,36 +1,146 @@
+#include <climits>
 #include <QFile>
 #include "img.h"
+#include "blockcache.h"
 #include "subfile.h"
 
 
 #define mod2n(x, m) ((x) & ((m) - 1));
 
+#define MAX_OPEN_FILES 64
+
+static QMutex &fileLock()
+{
+	static QMutex lock;
+	return lock;
+}
+
+/* Open files, least recently used first. Must be accessed with the fileLock()
+   locked. */
+QList<SubFile::File*> &SubFile::File::openFiles()
+{
+	static QList<File*> list;
+	return list;
+}
+
+SubFile::File::File(const QString &path) : file(path), id(BlockCache::id())
+{
+}
+
+SubFile::File::~File()
+{
+	QMutexLocker locker(&fileLock());
+	openFiles().removeOne(this);
+}
+
+/* Only files that are not being read by another thread are closed to free
+   a file descriptor. If all of them are busy, the pool temporarily grows
+   over the limit. */
+bool SubFile::File::open()
+{
+	QMutexLocker locker(&fileLock());
+	QList<File*> &list = openFiles();
+
+	if (file.isOpen()) {
+		list.removeOne(this);
+		list.append(this);
+		return true;
+	}
+
+	if (list.size() >= MAX_OPEN_FILES) {
+		for (int i = 0; i < list.size(); i++) {
+			File *f = list.at(i);
+			if (f->lock.tryLock()) {
+				list.removeAt(i);
+				f->file.close();
+				f->lock.unlock();
+				break;
+			}
+		}
+	}
+	if (!file.open(QIODevice::ReadOnly))
+		return false;
+	list.append(this);
+
+	return true;
+}
+
+bool SubFile::readBlock(int blockNum, QByteArray &data) const
+{
+	if (BlockCache::find(_file->id, blockNum, data))
+		return true;
+
+	QByteArray block;
+	block.resize(1<<BLOCK_BITS);
+
+	_file->lock.lock();
+	bool ret = _file->open()
+	  && _file->file.seek((quint64)blockNum << BLOCK_BITS)
+	  && _file->file.read(block.data(), (1<<BLOCK_BITS)) >= 0;
+	_file->lock.unlock();
+
+	if (!ret)
+		return false;
+
+	BlockCache::insert(_file->id, blockNum, block);
+	data = block;
+
+	return true;
+}
+
 bool SubFile::seek(Handle &handle, quint32 pos) const
 {
-	if (handle._file) {
+	if (_file) {
 		int blockNum = pos >> BLOCK_BITS;
 
 		if (handle._blockNum != blockNum) {
-			if (!handle._file->seek((quint64)blockNum << BLOCK_BITS))
-				return false;
-			if (handle._file->read(handle._data.data(), (1<<BLOCK_BITS)) < 0)
+			if (!readBlock(blockNum, handle._data))
 				return false;
+			handle._block = (const quint8*)handle._data.constData();
+			handle._blockSize = 1<<BLOCK_BITS;
 			handle._blockNum = blockNum;
 		}
 
 		handle._blockPos = mod2n(pos, 1U<<BLOCK_BITS);
 		handle._pos = pos;
 
+		return true;
+	} else if (_img->_map && _blocks->contiguous && !_blocks->list.isEmpty()) {
+		quint32 blockBits = _img->blockBits();
+		quint64 offset = (quint64)_blocks->list.first() << blockBits;
+		quint64 size = (quint64)_blocks->list.size() << blockBits;
+
+		if (pos >= size || offset + size > (quint64)_img->_mapSize)
+			return false;
+
+		/* The handle positions are int, larger sub-files can not be read
+		   past INT_MAX anyway */
+		handle._block = _img->_map + offset;
+		handle._blockSize = (int)qMin(size, (quint64)INT_MAX);
+		handle._blockNum = 0;
+		handle._blockPos = pos;
+		handle._pos = pos;
+
 		return true;
 	} else {
 		quint32 blockBits = _img->blockBits();
 		int blockNum = pos >> blockBits;
 
 		if (handle._blockNum != blockNum) {
-			if (blockNum >= _blocks->size())
-				return false;
-			if (!_img->readBlock(_blocks->at(blockNum), handle._data.data()))
+			if (blockNum >= _blocks->list.size())
 				return false;
+			if (_img->_map) {
+				quint64 offset = (quint64)_blocks->list.at(blockNum)
+				  << blockBits;
+				if (offset + (1U<<blockBits) > (quint64)_img->_mapSize)
+					return false;
+				handle._block = _img->_map + offset;
+			} else {
+				if (!_img->readBlock(_blocks->list.at(blockNum), handle._data))
+					return false;
+				handle._block = (const quint8*)handle._data.constData();
+			}
+			handle._blockSize = 1<<blockBits;
 			handle._blockNum = blockNum;
 		}
 
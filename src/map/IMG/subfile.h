@@ -3,6 +3,8 @@
 
 #include <QVector>
 #include <QFile>
+#include <QMutex>
+#include <QtEndian>
 #include "img.h"
 
 
@@ -16,45 +18,45 @@ public:
 	class Handle
 	{
 	public:
-		Handle(const SubFile *subFile)
-		  : _file(0), _blockNum(-1), _blockPos(-1), _pos(-1)
-		{
-			if (subFile && subFile->_path) {
-				_file = new QFile(*(subFile->_path));
-				_file->open(QIODevice::ReadOnly);
-				_data.resize(1U<<BLOCK_BITS);
-			} else if (subFile)
-				_data.resize(1U<<subFile->_img->blockBits());
-		}
-		~Handle() {delete _file;}
+		/* The handle does not own any file resources, the blocks data are
+		   either shared with the block cache or point directly to the memory
+		   mapped IMG file. */
+		Handle(const SubFile *subFile) : _block(0), _blockSize(0),
+		  _blockNum(-1), _blockPos(-1), _pos(-1) {Q_UNUSED(subFile);}
 
 		int pos() const {return _pos;}
 
 	private:
 		friend class SubFile;
 
-		QFile *_file;
 		QByteArray _data;
+		const quint8 *_block;
+		int _blockSize;
 		int _blockNum;
 		int _blockPos;
 		int _pos;
 	};
 
 	SubFile(IMG *img)
-	  : _gmpOffset(0), _img(img), _blocks(new QVector<quint16>()), _path(0) {}
+	  : _gmpOffset(0), _img(img), _blocks(new Blocks()), _file(0) {}
 	SubFile(SubFile *gmp, quint32 offset) : _gmpOffset(offset), _img(gmp->_img),
-	  _blocks(gmp->_blocks), _path(gmp->_path) {}
+	  _blocks(gmp->_blocks), _file(gmp->_file) {}
 	SubFile(const QString &path)
-	  : _gmpOffset(0), _img(0), _blocks(0), _path(new QString(path)) {}
+	  : _gmpOffset(0), _img(0), _blocks(0), _file(new File(path)) {}
 	~SubFile()
 	{
 		if (!_gmpOffset) {
 			delete _blocks;
-			delete _path;
+			delete _file;
 		}
 	}
 
-	void addBlock(quint16 block) {_blocks->append(block);}
+	void addBlock(quint16 block)
+	{
+		_blocks->contiguous = _blocks->contiguous && (_blocks->list.isEmpty()
+		  || block == _blocks->list.last() + 1);
+		_blocks->list.append(block);
+	}
 
 	bool seek(Handle &handle, quint32 pos) const;
 
@@ -71,6 +73,12 @@ public:
 	template<typename T>
 	bool readUInt16(Handle &handle, T &val) const
 	{
+		if (handle._blockPos + 2 < handle._blockSize) {
+			val = qFromLittleEndian<quint16>(handle._block + handle._blockPos);
+			skip(handle, 2);
+			return true;
+		}
+
 		quint8 b0, b1;
 		if (!(readByte(handle, b0) && readByte(handle, b1)))
 			return false;
@@ -89,6 +97,13 @@ public:
 
 	bool readUInt24(Handle &handle, quint32 &val) const
 	{
+		if (handle._blockPos + 3 < handle._blockSize) {
+			const quint8 *p = handle._block + handle._blockPos;
+			val = p[0] | ((quint32)p[1]) << 8 | ((quint32)p[2]) << 16;
+			skip(handle, 3);
+			return true;
+		}
+
 		quint8 b0, b1, b2;
 		if (!(readByte(handle, b0) && readByte(handle, b1)
 		  && readByte(handle, b2)))
@@ -108,6 +123,12 @@ public:
 
 	bool readUInt32(Handle &handle, quint32 &val) const
 	{
+		if (handle._blockPos + 4 < handle._blockSize) {
+			val = qFromLittleEndian<quint32>(handle._block + handle._blockPos);
+			skip(handle, 4);
+			return true;
+		}
+
 		quint8 b0, b1, b2, b3;
 		if (!(readByte(handle, b0) && readByte(handle, b1)
 		  && readByte(handle, b2) && readByte(handle, b3)))
@@ -135,24 +156,57 @@ public:
 	bool readVUInt32(Handle &hdl, quint32 bytes, quint32 &val) const;
 	bool readVBitfield32(Handle &hdl, quint32 &bitfield) const;
 
-	QString fileName() const {return _path ? *_path : _img->fileName();}
+	QString fileName() const
+	  {return _file ? _file->file.fileName() : _img->fileName();}
 
 protected:
 	quint32 _gmpOffset;
 
 private:
+	/* Standalone (GMAP) sub-file shared by all the handles. The files are
+	   opened on demand and kept open in a limited pool of file descriptors.
+	   Every file has its own lock, the pool is guarded by a global lock. */
+	struct File {
+		File(const QString &path);
+		~File();
+
+		// The caller must hold the file lock
+		bool open();
+
+		QFile file;
+		QMutex lock;
+		quint32 id;
+
+		static QList<File*> &openFiles();
+	};
+
+	/* IMG container sub-file blocks. Consecutive blocks of a memory mapped
+	   IMG file are accessed as one contiguous span of memory. */
+	struct Blocks {
+		Blocks() : contiguous(true) {}
+
+		QVector<quint16> list;
+		bool contiguous;
+	};
+
+	bool readBlock(int blockNum, QByteArray &data) const;
 	bool readByte(Handle &handle, quint8 &val) const
 	{
-		int blockSize = _img ? 1U<<_img->blockBits() : 1U<<BLOCK_BITS;
-		val = handle._data.at(handle._blockPos++);
+		val = handle._block[handle._blockPos++];
 		handle._pos++;
-		return (handle._blockPos >= blockSize)
+		return (handle._blockPos >= handle._blockSize)
 		  ? seek(handle, handle._pos) : true;
 	}
+	// The caller must assure that the block end is not reached
+	void skip(Handle &handle, int bytes) const
+	{
+		handle._blockPos += bytes;
+		handle._pos += bytes;
+	}
 
 	IMG *_img;
-	QVector<quint16> *_blocks;
-	QString *_path;
+	Blocks *_blocks;
+	File *_file;
 };
 
 #endif // SUBFILE_H
@@ -1,7 +1,6 @@
 #ifndef TEXTITEM_H
 #define TEXTITEM_H
 
-#include <QList>
 #include <QRectF>
 #include <QPainterPath>
 
@@ -15,8 +14,6 @@ public:
 	virtual QPainterPath shape() const = 0;
 	virtual QRectF boundingRect() const = 0;
 	virtual void paint(QPainter *painter) const = 0;
-
-	bool collides(const QList<TextItem*> &list) const;
 };
 
 #endif // TEXTITEM_H
@@ -0,0 +1,69 @@
+#include "textitem.h"
+#include "textitemindex.h"
+
+
+struct CollisionCTX
+{
+	CollisionCTX(const TextItem *item)
+	  : item(item), rect(item->boundingRect()), collides(false) {}
+
+	const TextItem *item;
+	QRectF rect;
+	bool collides;
+};
+
+static bool cb(TextItem *item, void *context)
+{
+	CollisionCTX *ctx = (CollisionCTX*)context;
+
+	if (ctx->rect.intersects(item->boundingRect())
+	  && item->shape().intersects(ctx->item->shape())) {
+		ctx->collides = true;
+		return false;
+	}
+
+	return true;
+}
+
+
+TextItemIndex::~TextItemIndex()
+{
+	qDeleteAll(_items);
+}
+
+bool TextItemIndex::collides(const TextItem *item) const
+{
+	CollisionCTX ctx(item);
+	qreal min[2], max[2];
+
+	if (ctx.rect.isEmpty())
+		return false;
+
+	min[0] = ctx.rect.left();
+	min[1] = ctx.rect.top();
+	max[0] = ctx.rect.right();
+	max[1] = ctx.rect.bottom();
+
+	_tree.Search(min, max, cb, &ctx);
+
+	return ctx.collides;
+}
+
+void TextItemIndex::insert(TextItem *item)
+{
+	QRectF rect(item->boundingRect());
+	qreal min[2], max[2];
+
+	_items.append(item);
+
+	// Items with an empty bounding rectangle never collide
+	if (rect.isEmpty())
+		return;
+
+	min[0] = rect.left();
+	min[1] = rect.top();
+	max[0] = rect.right();
+	max[1] = rect.bottom();
+
+	_tree.Insert(min, max, item);
+}
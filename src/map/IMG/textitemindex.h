@@ -0,0 +1,29 @@
+#ifndef TEXTITEMINDEX_H
+#define TEXTITEMINDEX_H
+
+#include <QList>
+#include "common/rtree.h"
+
+class TextItem;
+
+/* Text items (labels) placed on a tile. The items are indexed by their
+   bounding rectangles, so only the items whose bounding rectangles intersect
+   are tested for the exact shape collision. The index owns the items. */
+class TextItemIndex
+{
+public:
+	~TextItemIndex();
+
+	bool collides(const TextItem *item) const;
+	void insert(TextItem *item);
+
+	const QList<TextItem*> &items() const {return _items;}
+
+private:
+	typedef RTree<TextItem*, qreal, 2> TextItemTree;
+
+	QList<TextItem*> _items;
+	TextItemTree _tree;
+};
+
+#endif // TEXTITEMINDEX_H
@@ -120,77 +120,138 @@ bool VectorTile::initGMP()
 	return true;
 }
 
+void VectorTile::clear()
+{
+	QMutexLocker locker(&_lock);
+	_tre->clear();
+}
+
+bool VectorTile::load(SubFile::Handle &rgnHdl, SubFile::Handle &lblHdl,
+  SubFile::Handle &netHdl, SubFile::Handle &nodHdl)
+{
+	/* The optional subfiles are initialized here rather than on the first
+	   usage to not race on their headers. Subfiles with an invalid header
+	   are not used at all. */
+	if (!_rgn->init(rgnHdl))
+		return false;
+	if (_lbl)
+		_lbl->init(lblHdl);
+	if (_net)
+		_net->init(netHdl);
+	if (_nod)
+		_nod->init(nodHdl);
+
+	_loaded = true;
+
+	return true;
+}
+
+QList<SubDiv*> VectorTile::findSubdivs(const RectC &rect, int bits,
+  bool baseMap, SubFile::Handle &rgnHdl, SubFile::Handle &lblHdl,
+  SubFile::Handle &netHdl, SubFile::Handle &nodHdl)
+{
+	QMutexLocker locker(&_lock);
+
+	if (!_loaded && !load(rgnHdl, lblHdl, netHdl, nodHdl))
+		return QList<SubDiv*>();
+
+	QList<SubDiv*> list(_tre->subdivs(rect, bits, baseMap));
+	for (int i = 0; i < list.size(); i++) {
+		SubDiv *subdiv = list.at(i);
+		if (!subdiv->initialized() && !_rgn->subdivInit(rgnHdl, subdiv))
+			list.removeAt(i--);
+	}
+
+	return list;
+}
+
 void VectorTile::polys(const RectC &rect, int bits, bool baseMap,
   QList<IMG::Poly> *polygons, QList<IMG::Poly> *lines,
-  QCache<const SubDiv *, IMG::Polys> *polyCache) const
+  QCache<const SubDiv *, IMG::Polys> *polyCache, QMutex *cacheLock)
 {
 	SubFile::Handle rgnHdl(_rgn), lblHdl(_lbl), netHdl(_net), nodHdl(_nod);
 
-	if (!_rgn->initialized() && !_rgn->init(rgnHdl))
+	QList<SubDiv*> subdivs(findSubdivs(rect, bits, baseMap, rgnHdl, lblHdl,
+	  netHdl, nodHdl));
+	if (subdivs.isEmpty())
 		return;
 
-	QList<SubDiv*> subdivs = _tre->subdivs(rect, bits, baseMap);
+	LBLFile *lbl = (_lbl && _lbl->initialized()) ? _lbl : 0;
+	NETFile *net = (_net && _net->initialized()) ? _net : 0;
+	NODFile *nod = (_nod && _nod->initialized()) ? _nod : 0;
+
 	for (int i = 0; i < subdivs.size(); i++) {
 		SubDiv *subdiv = subdivs.at(i);
 
+		cacheLock->lock();
 		IMG::Polys *polys = polyCache->object(subdiv);
+		if (polys) {
+			copyPolys(rect, &(polys->polygons), polygons);
+			copyPolys(rect, &(polys->lines), lines);
+		}
+		cacheLock->unlock();
+
 		if (!polys) {
 			quint32 shift = _tre->shift(subdiv->bits());
 			QList<IMG::Poly> p, l;
 
-			if (!subdiv->initialized() && !_rgn->subdivInit(rgnHdl, subdiv))
-				continue;
-
-			_rgn->polyObjects(rgnHdl, subdiv, RGNFile::Polygon, _lbl, lblHdl,
-			  _net, netHdl, &p);
-			_rgn->polyObjects(rgnHdl, subdiv, RGNFile::Line, _lbl, lblHdl,
-			  _net, netHdl, &l);
-			_rgn->extPolyObjects(rgnHdl, subdiv, shift, RGNFile::Polygon, _lbl,
+			_rgn->polyObjects(rgnHdl, subdiv, RGNFile::Polygon, lbl, lblHdl,
+			  net, netHdl, &p);
+			_rgn->polyObjects(rgnHdl, subdiv, RGNFile::Line, lbl, lblHdl,
+			  net, netHdl, &l);
+			_rgn->extPolyObjects(rgnHdl, subdiv, shift, RGNFile::Polygon, lbl,
 			  lblHdl, &p);
-			_rgn->extPolyObjects(rgnHdl, subdiv, shift, RGNFile::Line, _lbl,
+			_rgn->extPolyObjects(rgnHdl, subdiv, shift, RGNFile::Line, lbl,
 			  lblHdl, &l);
-			_rgn->links(rgnHdl, subdiv, _net, netHdl, _nod, nodHdl, &l);
+			_rgn->links(rgnHdl, subdiv, net, netHdl, nod, nodHdl, &l);
 
 			copyPolys(rect, &p, polygons);
 			copyPolys(rect, &l, lines);
+
+			cacheLock->lock();
 			polyCache->insert(subdiv, new IMG::Polys(p, l));
-		} else {
-			copyPolys(rect, &(polys->polygons), polygons);
-			copyPolys(rect, &(polys->lines), lines);
+			cacheLock->unlock();
 		}
 	}
 }
 
 void VectorTile::points(const RectC &rect, int bits, bool baseMap,
   QList<IMG::Point> *points, QCache<const SubDiv *,
-  QList<IMG::Point> > *pointCache) const
+  QList<IMG::Point> > *pointCache, QMutex *cacheLock)
 {
-	SubFile::Handle rgnHdl(_rgn), lblHdl(_lbl);
+	SubFile::Handle rgnHdl(_rgn), lblHdl(_lbl), netHdl(_net), nodHdl(_nod);
 
-	if (!_rgn->initialized() && !_rgn->init(rgnHdl))
+	QList<SubDiv*> subdivs(findSubdivs(rect, bits, baseMap, rgnHdl, lblHdl,
+	  netHdl, nodHdl));
+	if (subdivs.isEmpty())
 		return;
 
-	QList<SubDiv*> subdivs = _tre->subdivs(rect, bits, baseMap);
+	LBLFile *lbl = (_lbl && _lbl->initialized()) ? _lbl : 0;
+
 	for (int i = 0; i < subdivs.size(); i++) {
 		SubDiv *subdiv = subdivs.at(i);
 
+		cacheLock->lock();
 		QList<IMG::Point> *pl = pointCache->object(subdiv);
+		if (pl)
+			copyPoints(rect, pl, points);
+		cacheLock->unlock();
+
 		if (!pl) {
 			QList<IMG::Point> p;
 
-			if (!subdiv->initialized() && !_rgn->subdivInit(rgnHdl, subdiv))
-				continue;
-
-			_rgn->pointObjects(rgnHdl, subdiv, RGNFile::Point, _lbl, lblHdl,
+			_rgn->pointObjects(rgnHdl, subdiv, RGNFile::Point, lbl, lblHdl,
 			  &p);
-			_rgn->pointObjects(rgnHdl, subdiv, RGNFile::IndexedPoint, _lbl,
+			_rgn->pointObjects(rgnHdl, subdiv, RGNFile::IndexedPoint, lbl,
 			  lblHdl, &p);
-			_rgn->extPointObjects(rgnHdl, subdiv, _lbl, lblHdl, &p);
+			_rgn->extPointObjects(rgnHdl, subdiv, lbl, lblHdl, &p);
 
 			copyPoints(rect, &p, points);
+
+			cacheLock->lock();
 			pointCache->insert(subdiv, new QList<IMG::Point>(p));
-		} else
-			copyPoints(rect, pl, points);
+			cacheLock->unlock();
+		}
 	}
 }
 
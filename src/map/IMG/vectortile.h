@@ -1,7 +1,7 @@
 #ifndef VECTORTILE_H
 #define VECTORTILE_H
 
-#include "trefile.h"
+#include <QMutex>
 #include "trefile.h"
 #include "rgnfile.h"
 #include "lblfile.h"
@@ -10,7 +10,8 @@
 
 class VectorTile {
 public:
-	VectorTile() : _tre(0), _rgn(0), _lbl(0), _net(0), _nod(0), _gmp(0) {}
+	VectorTile()
+	  : _tre(0), _rgn(0), _lbl(0), _net(0), _nod(0), _gmp(0), _loaded(false) {}
 	~VectorTile()
 	{
 		delete _tre; delete _rgn; delete _lbl; delete _net; delete _nod;
@@ -19,7 +20,7 @@ public:
 
 	bool init();
 	void markAsBasemap() {_tre->markAsBasemap();}
-	void clear() {_tre->clear();}
+	void clear();
 
 	const RectC &bounds() const {return _tre->bounds();}
 	Range zooms() const {return _tre->zooms();}
@@ -30,10 +31,10 @@ public:
 
 	void polys(const RectC &rect, int bits, bool baseMap,
 	  QList<IMG::Poly> *polygons, QList<IMG::Poly> *lines,
-	  QCache<const SubDiv *, IMG::Polys> *polyCache) const;
+	  QCache<const SubDiv *, IMG::Polys> *polyCache, QMutex *cacheLock);
 	void points(const RectC &rect, int bits, bool baseMap,
 	  QList<IMG::Point> *points, QCache<const SubDiv*,
-	  QList<IMG::Point> > *pointCache) const;
+	  QList<IMG::Point> > *pointCache, QMutex *cacheLock);
 
 	static bool isTileFile(SubFile::Type type)
 	{
@@ -44,6 +45,11 @@ public:
 
 private:
 	bool initGMP();
+	bool load(SubFile::Handle &rgnHdl, SubFile::Handle &lblHdl,
+	  SubFile::Handle &netHdl, SubFile::Handle &nodHdl);
+	QList<SubDiv*> findSubdivs(const RectC &rect, int bits, bool baseMap,
+	  SubFile::Handle &rgnHdl, SubFile::Handle &lblHdl,
+	  SubFile::Handle &netHdl, SubFile::Handle &nodHdl);
 
 	TREFile *_tre;
 	RGNFile *_rgn;
@@ -51,6 +57,12 @@ private:
 	NETFile *_net;
 	NODFile *_nod;
 	SubFile *_gmp;
+
+	/* Guards the lazy loaded TRE levels, the RGN/LBL/NET/NOD headers and the
+	   subdivs initialization as the tile is accessed from the rendering
+	   threads in parallel. */
+	QMutex _lock;
+	bool _loaded;
 };
 
 #ifndef QT_NO_DEBUG
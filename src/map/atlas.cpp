@@ -170,7 +170,7 @@ QRectF Atlas::bounds()
 int Atlas::zoomFit(const QSize &size, const RectC &br)
 {
 	_zoom = 0;
-	_mapIndex = -1;
+	_mapIndex.fetchAndStoreRelaxed(-1);
 
 	if (!br.isValid()) {
 		_zoom = _zooms.size() - 1;
@@ -199,14 +199,14 @@ int Atlas::zoomFit(const QSize &size, const RectC &br)
 
 void Atlas::setZoom(int zoom)
 {
-	_mapIndex = -1;
+	_mapIndex.fetchAndStoreRelaxed(-1);
 	_zoom = zoom;
 }
 
 int Atlas::zoomIn()
 {
 	_zoom = qMin(_zoom + 1, _zooms.size() - 1);
-	_mapIndex = -1;
+	_mapIndex.fetchAndStoreRelaxed(-1);
 
 	return _zoom;
 }
@@ -214,30 +214,36 @@ int Atlas::zoomIn()
 int Atlas::zoomOut()
 {
 	_zoom = qMax(_zoom - 1, 0);
-	_mapIndex = -1;
+	_mapIndex.fetchAndStoreRelaxed(-1);
 
 	return _zoom;
 }
 
+/* The last used map index is only a lookup hint shared by the ll2xy() calls
+   from several threads, so it is an atomic accessed with relaxed ordering
+   (the fetch-and-* API is available in both Qt 4 and Qt 5) and the
+   computation itself only uses the local copy. */
 QPointF Atlas::ll2xy(const Coordinates &c)
 {
+	int idx = _mapIndex.fetchAndAddRelaxed(0);
 	PointD pp;
 
-	if (_mapIndex >= 0)
-		pp = _maps.at(_mapIndex)->ll2pp(c);
-	if (_mapIndex < 0 || !_bounds.at(_mapIndex).pp.contains(pp)) {
-		_mapIndex = _zooms.at(_zoom).first;
+	if (idx >= 0)
+		pp = _maps.at(idx)->ll2pp(c);
+	if (idx < 0 || !_bounds.at(idx).pp.contains(pp)) {
+		idx = _zooms.at(_zoom).first;
 		for (int i = _zooms.at(_zoom).first; i <= _zooms.at(_zoom).last; i++) {
 			pp = _maps.at(i)->ll2pp(c);
 			if (_bounds.at(i).pp.contains(pp)) {
-				_mapIndex = i;
+				idx = i;
 				break;
 			}
 		}
+		_mapIndex.fetchAndStoreRelaxed(idx);
 	}
 
-	QPointF p = _maps.at(_mapIndex)->pp2xy(pp);
-	return p + _bounds.at(_mapIndex).xy.topLeft();
+	QPointF p = _maps.at(idx)->pp2xy(pp);
+	return p + _bounds.at(idx).xy.topLeft();
 }
 
 Coordinates Atlas::xy2ll(const QPointF &p)
@@ -287,8 +293,14 @@ void Atlas::draw(QPainter *painter, const QRectF &rect, int mapIndex,
 	painter->translate(-offset);
 }
 
+void Atlas::load()
+{
+	_mapIndex.fetchAndStoreRelaxed(-1);
+}
+
 void Atlas::unload()
 {
+	_mapIndex.fetchAndStoreRelaxed(-1);
 	for (int i = 0; i < _maps.count(); i++)
 		_maps.at(i)->unload();
 }
@@ -1,6 +1,7 @@
 #ifndef ATLAS_H
 #define ATLAS_H
 
+#include <QAtomicInt>
 #include "map.h"
 #include "rectd.h"
 
@@ -29,6 +30,7 @@ public:
 	void draw(QPainter *painter, const QRectF &rect, Flags flags);
 
 	void setDevicePixelRatio(qreal deviceRatio, qreal mapRatio);
+	void load();
 	void unload();
 
 	bool isValid() const {return _valid;}
@@ -63,7 +65,7 @@ private:
 	QVector<Zoom> _zooms;
 	QVector<Bounds> _bounds;
 	int _zoom;
-	int _mapIndex;
+	QAtomicInt _mapIndex;
 
 	bool _valid;
 	QString _errorString;
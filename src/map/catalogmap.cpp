@@ -0,0 +1,28 @@
+#include "emptymap.h"
+#include "catalogmap.h"
+
+
+CatalogMap::CatalogMap(const MapCatalog::Entry &entry, QObject *parent)
+  : Map(parent), _entry(entry), _map(0)
+{
+}
+
+Map *CatalogMap::map()
+{
+	if (_map)
+		return _map;
+
+	_map = MapList::createMap(_entry.format, _entry.path, _errorString);
+	if (_map) {
+		_map->setParent(this);
+		connect(_map, SIGNAL(tilesLoaded()), this, SIGNAL(tilesLoaded()));
+		connect(_map, SIGNAL(mapLoaded()), this, SIGNAL(mapLoaded()));
+		connect(_map, SIGNAL(seedProgress(int, int, int, int, qint64)),
+		  this, SIGNAL(seedProgress(int, int, int, int, qint64)));
+	} else {
+		qWarning("%s: %s", qPrintable(_entry.path), qPrintable(_errorString));
+		_map = new EmptyMap(this);
+	}
+
+	return _map;
+}
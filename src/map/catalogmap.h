@@ -0,0 +1,69 @@
+#ifndef CATALOGMAP_H
+#define CATALOGMAP_H
+
+#include "mapcatalog.h"
+#include "map.h"
+
+/* Map catalog proxy. Answers the name (and the seed zooms) from the catalog
+   entry, the real map is created on the first use and replaced with an empty
+   map if the file can no more be loaded. */
+class CatalogMap : public Map
+{
+	Q_OBJECT
+
+public:
+	CatalogMap(const MapCatalog::Entry &entry, QObject *parent = 0);
+
+	QString name() const {return _entry.name;}
+
+	QRectF bounds() {return map()->bounds();}
+	qreal resolution(const QRectF &rect) {return map()->resolution(rect);}
+
+	int zoom() const {return _map ? _map->zoom() : 0;}
+	void setZoom(int zoom) {map()->setZoom(zoom);}
+	int zoomFit(const QSize &size, const RectC &rect)
+	  {return map()->zoomFit(size, rect);}
+	int zoomIn() {return map()->zoomIn();}
+	int zoomOut() {return map()->zoomOut();}
+
+	QPointF ll2xy(const Coordinates &c) {return map()->ll2xy(c);}
+	Coordinates xy2ll(const QPointF &p) {return map()->xy2ll(p);}
+	void ll2xy(const Coordinates *c, QPointF *p, int n)
+	  {map()->ll2xy(c, p, n);}
+
+	void draw(QPainter *painter, const QRectF &rect, Flags flags)
+	  {map()->draw(painter, rect, flags);}
+	void prefetch(const QRectF &rect, const QRectF &ahead)
+	  {map()->prefetch(rect, ahead);}
+	void cancelPrefetch() {if (_map) _map->cancelPrefetch();}
+
+	Range seedZooms() const {return _map ? _map->seedZooms() : _entry.zooms;}
+	QRect seedRange(const RectC &rect, int zoom) const
+	  {return _map ? _map->seedRange(rect, zoom) : QRect();}
+	void seed(const RectC &rect, const Range &zooms)
+	  {map()->seed(rect, zooms);}
+	void cancelSeed() {if (_map) _map->cancelSeed();}
+
+	void clearCache() {map()->clearCache();}
+	void load() {map()->load();}
+	void unload() {if (_map) _map->unload();}
+	void setDevicePixelRatio(qreal deviceRatio, qreal mapRatio)
+	  {map()->setDevicePixelRatio(deviceRatio, mapRatio);}
+	void setProjection(const Projection &projection)
+	  {map()->setProjection(projection);}
+
+	bool isReady() const {return _map ? _map->isReady() : true;}
+	QString errorString() const {return _errorString;}
+
+	bool isLoaded() const {return (_map != 0);}
+	Map *loadedMap() const {return _errorString.isNull() ? _map : 0;}
+
+private:
+	Map *map();
+
+	MapCatalog::Entry _entry;
+	Map *_map;
+	QString _errorString;
+};
+
+#endif // CATALOGMAP_H
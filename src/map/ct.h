@@ -13,6 +13,11 @@ public:
 
 	virtual PointD ll2xy(const Coordinates &c) const = 0;
 	virtual Coordinates xy2ll(const PointD &p) const = 0;
+
+	/* Batch version of ll2xy(). Implementations override it with a loop
+	   without the virtual call and the per-point setup. */
+	virtual void ll2xy(const Coordinates *c, PointD *p, int n) const
+	  {for (int i = 0; i < n; i++) p[i] = ll2xy(c[i]);}
 };
 
 #endif // CT_H
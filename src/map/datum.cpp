@@ -116,6 +116,27 @@ Coordinates Datum::fromWGS84(const Coordinates &c) const
 	}
 }
 
+void Datum::fromWGS84(const Coordinates *c, Coordinates *out, int n) const
+{
+	const Ellipsoid *e = WGS84().ellipsoid();
+
+	switch (_transformation) {
+		case Helmert:
+			for (int i = 0; i < n; i++)
+				out[i] = Geocentric::toGeodetic(helmertr(
+				  Geocentric::fromGeodetic(c[i], e)), ellipsoid());
+			break;
+		case Molodensky:
+			for (int i = 0; i < n; i++)
+				out[i] = molodensky(c[i], WGS84(), *this);
+			break;
+		default:
+			if (out != c)
+				for (int i = 0; i < n; i++)
+					out[i] = c[i];
+	}
+}
+
 #ifndef QT_NO_DEBUG
 QDebug operator<<(QDebug dbg, const Datum &datum)
 {
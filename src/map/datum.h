@@ -32,8 +32,11 @@ public:
 		&& !std::isnan(_dz) && !std::isnan(_scale) && !std::isnan(_rx)
 		&& !std::isnan(_ry) && !std::isnan(_rz));}
 
+	bool isWGS84() const {return (_transformation == None);}
+
 	Coordinates toWGS84(const Coordinates &c) const;
 	Coordinates fromWGS84(const Coordinates &c) const;
+	void fromWGS84(const Coordinates *c, Coordinates *out, int n) const;
 
 	static const Datum &WGS84();
 
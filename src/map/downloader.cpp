@@ -29,7 +29,12 @@
 
 #define MAX_REDIRECT_LEVEL 5
 #define RETRIES 3
+#define MAX_HOST_DOWNLOADS 6
 
+static bool priorityLessThan(const Download &d1, const Download &d2)
+{
+	return d1.priority() < d2.priority();
+}
 
 Authorization::Authorization(const QString &username, const QString &password)
 {
@@ -97,11 +102,14 @@ bool Downloader::doDownload(const Download &dl,
 		qWarning("%s: Invalid URL", qPrintable(url.toString()));
 		if (redirect)
 			_errorDownloads.insert(redirect->origin(), RETRIES);
+		emit failed(dl.file());
 		return false;
 	}
 
-	if (_errorDownloads.value(url) >= RETRIES)
+	if (_errorDownloads.value(url) >= RETRIES) {
+		emit failed(dl.file());
 		return false;
+	}
 	if (_currentDownloads.contains(url) && !redirect)
 		return false;
 
@@ -112,6 +120,10 @@ bool Downloader::doDownload(const Download &dl,
 		request.setAttribute(ATTR_LEVEL, QVariant(redirect->level()));
 	}
 	request.setRawHeader("User-Agent", USER_AGENT);
+	if (!dl.etag().isEmpty())
+		request.setRawHeader("If-None-Match", dl.etag());
+	if (!dl.lastModified().isEmpty())
+		request.setRawHeader("If-Modified-Since", dl.lastModified());
 	if (!authorization.isNull())
 		request.setRawHeader("Authorization", authorization);
 #ifdef ENABLE_HTTP2
@@ -122,13 +134,16 @@ bool Downloader::doDownload(const Download &dl,
 	Q_ASSERT(_manager);
 	QNetworkReply *reply = _manager->get(request);
 	if (reply && reply->isRunning()) {
-		_currentDownloads.insert(url);
+		_currentDownloads.insert(url, reply);
+		_hostDownloads[url.host()]++;
 		ReplyTimeout::setTimeout(reply, _timeout);
 		connect(reply, SIGNAL(finished()), this, SLOT(emitFinished()));
 	} else if (reply)
 		downloadFinished(reply);
-	else
+	else {
+		emit failed(dl.file());
 		return false;
+	}
 
 	return true;
 }
@@ -165,10 +180,12 @@ void Downloader::insertError(const QUrl &url, QNetworkReply::NetworkError error)
 void Downloader::downloadFinished(QNetworkReply *reply)
 {
 	QUrl url(reply->request().url());
+	QUrl origin(reply->request().attribute(ATTR_ORIGIN).toUrl());
+	QString filename(reply->request().attribute(ATTR_FILE).toString());
 	QNetworkReply::NetworkError error = reply->error();
+	bool redirected = false;
 
 	if (error) {
-		QUrl origin(reply->request().attribute(ATTR_ORIGIN).toUrl());
 		if (origin.isEmpty()) {
 			insertError(url, error);
 			qWarning("Error downloading file: %s: %s",
@@ -179,12 +196,11 @@ void Downloader::downloadFinished(QNetworkReply *reply)
 			  origin.toEncoded().constData(), url.toEncoded().constData(),
 			  qPrintable(reply->errorString()));
 		}
+		emit failed(filename);
 	} else {
 		QUrl location(reply->attribute(ATTR_REDIRECT).toUrl());
-		QString filename(reply->request().attribute(ATTR_FILE).toString());
 
 		if (!location.isEmpty()) {
-			QUrl origin(reply->request().attribute(ATTR_ORIGIN).toUrl());
 			int level = reply->request().attribute(ATTR_LEVEL).toInt();
 
 			if (level >= MAX_REDIRECT_LEVEL) {
@@ -192,6 +208,7 @@ void Downloader::downloadFinished(QNetworkReply *reply)
 				qWarning("Error downloading file: %s: "
 				  "redirect level limit reached (redirect loop?)",
 				  origin.toEncoded().constData());
+				emit failed(filename);
 			} else {
 				QUrl redirectUrl;
 				if (location.isRelative()) {
@@ -203,18 +220,32 @@ void Downloader::downloadFinished(QNetworkReply *reply)
 
 				Redirect redirect(origin.isEmpty() ? url : origin, level + 1);
 				Download dl(redirectUrl, filename);
-				doDownload(dl, reply->request().rawHeader("Authorization"),
-				  &redirect);
+				redirected = doDownload(dl,
+				  reply->request().rawHeader("Authorization"), &redirect);
 			}
+		} else if (_streaming) {
+			if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute)
+			  .toInt() == 304)
+				emit notModified(filename);
+			else
+				emit downloaded(filename, reply->readAll(),
+				  reply->rawHeader("ETag"), reply->rawHeader("Last-Modified"));
 		} else {
 			if (!saveToDisk(filename, reply))
 				_errorDownloads.insert(url, RETRIES);
 		}
 	}
 
-	_currentDownloads.remove(url);
+	if (_currentDownloads.remove(url))
+		_hostDownloads[url.host()]--;
+	if (!redirected) {
+		_scheduled.remove(origin.isEmpty() ? url : origin);
+		_finished++;
+	}
 	reply->deleteLater();
 
+	startScheduled();
+
 	if (_currentDownloads.isEmpty())
 		emit finished();
 }
@@ -230,6 +261,114 @@ bool Downloader::get(const QList<Download> &list,
 	return finishEmitted;
 }
 
+/* Scheduled downloads are queued and started in the priority order (lower
+   value first) with at most MAX_HOST_DOWNLOADS concurrent downloads per host.
+   Scheduling an already queued download updates its priority. */
+void Downloader::schedule(const QList<Download> &list,
+  const Authorization &authorization)
+{
+	QSet<QUrl> urls;
+	QList<Download> queue;
+
+	for (int i = 0; i < list.size(); i++)
+		urls.insert(list.at(i).url());
+	for (int i = 0; i < _queue.size(); i++)
+		if (!urls.contains(_queue.at(i).url()))
+			queue.append(_queue.at(i));
+	for (int i = 0; i < list.size(); i++) {
+		const Download &dl = list.at(i);
+		if (_errorDownloads.value(dl.url()) >= RETRIES)
+			emit failed(dl.file());
+		else if (!_currentDownloads.contains(dl.url()))
+			queue.append(dl);
+	}
+
+	qStableSort(queue.begin(), queue.end(), priorityLessThan);
+	_queue = queue;
+	_queueAuthorization = authorization.header();
+
+	startScheduled();
+}
+
+void Downloader::startScheduled()
+{
+	int i = 0;
+
+	while (i < _queue.size()) {
+		if (_hostDownloads.value(_queue.at(i).url().host())
+		  >= MAX_HOST_DOWNLOADS) {
+			i++;
+			continue;
+		}
+
+		Download dl(_queue.takeAt(i));
+		_scheduled.insert(dl.url());
+		if (!doDownload(dl, _queueAuthorization))
+			_scheduled.remove(dl.url());
+	}
+}
+
+/* Cancels all the queued and running scheduled downloads that are not in the
+   keep set. Downloads started using get() are never cancelled. */
+void Downloader::cancel(const QSet<QUrl> &keep)
+{
+	QList<Download> queue;
+	QList<QNetworkReply*> replies;
+
+	for (int i = 0; i < _queue.size(); i++) {
+		if (keep.contains(_queue.at(i).url()))
+			queue.append(_queue.at(i));
+		else {
+			_cancelled++;
+			emit failed(_queue.at(i).file());
+		}
+	}
+	_queue = queue;
+
+	for (QHash<QUrl, QNetworkReply*>::const_iterator it
+	  = _currentDownloads.constBegin(); it != _currentDownloads.constEnd();
+	  ++it) {
+		QUrl origin(it.value()->request().attribute(ATTR_ORIGIN).toUrl());
+		if (origin.isEmpty())
+			origin = it.key();
+		if (_scheduled.contains(origin) && !keep.contains(origin))
+			replies.append(it.value());
+	}
+	for (int i = 0; i < replies.size(); i++)
+		abort(replies.at(i));
+
+	startScheduled();
+}
+
+void Downloader::abort(QNetworkReply *reply)
+{
+	QUrl url(reply->request().url());
+	QUrl origin(reply->request().attribute(ATTR_ORIGIN).toUrl());
+
+	disconnect(reply, SIGNAL(finished()), this, SLOT(emitFinished()));
+	reply->abort();
+	reply->deleteLater();
+
+	_currentDownloads.remove(url);
+	_hostDownloads[url.host()]--;
+	_scheduled.remove(origin.isEmpty() ? url : origin);
+	_cancelled++;
+
+	emit failed(reply->request().attribute(ATTR_FILE).toString());
+}
+
+Downloader::Stats Downloader::stats() const
+{
+	Stats stats;
+
+	stats.queued = _queue.size();
+	stats.running = _currentDownloads.size();
+	stats.finished = _finished;
+	stats.cancelled = _cancelled;
+
+	return stats;
+}
+
 #ifdef ENABLE_HTTP2
 void Downloader::enableHTTP2(bool enable)
 {
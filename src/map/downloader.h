@@ -13,14 +13,26 @@
 class Download
 {
 public:
-	Download(const QUrl &url, const QString &file) : _url(url), _file(file) {}
+	Download(const QUrl &url, const QString &file, int priority = 0)
+	  : _url(url), _file(file), _priority(priority) {}
 
 	const QUrl &url() const {return _url;}
 	const QString &file() const {return _file;}
+	int priority() const {return _priority;}
+
+	/* HTTP validators of the cached data, the download is conditional when
+	   set */
+	const QByteArray &etag() const {return _etag;}
+	const QByteArray &lastModified() const {return _lastModified;}
+	void setValidators(const QByteArray &etag, const QByteArray &lastModified)
+	  {_etag = etag; _lastModified = lastModified;}
 
 private:
 	QUrl _url;
 	QString _file;
+	int _priority;
+	QByteArray _etag;
+	QByteArray _lastModified;
 };
 
 class Authorization
@@ -40,11 +52,29 @@ class Downloader : public QObject
 	Q_OBJECT
 
 public:
-	Downloader(QObject *parent = 0) : QObject(parent) {}
+	struct Stats
+	{
+		int queued;
+		int running;
+		int finished;
+		int cancelled;
+	};
+
+	Downloader(QObject *parent = 0) : QObject(parent), _streaming(false),
+	  _finished(0), _cancelled(0) {}
+
+	/* In the streaming mode the downloaded data are not written to the disk
+	   but passed to the downloaded() signal, the download file is just an
+	   identifier. */
+	void setStreaming(bool streaming) {_streaming = streaming;}
 
 	bool get(const QList<Download> &list, const Authorization &authorization
 	  = Authorization());
+	void schedule(const QList<Download> &list, const Authorization
+	  &authorization = Authorization());
+	void cancel(const QSet<QUrl> &keep);
 	void clearErrors() {_errorDownloads.clear();}
+	Stats stats() const;
 
 	static void setNetworkManager(QNetworkAccessManager *manager)
 	  {_manager = manager;}
@@ -55,6 +85,11 @@ public:
 
 signals:
 	void finished();
+	void downloaded(const QString &file, const QByteArray &data,
+	  const QByteArray &etag, const QByteArray &lastModified);
+	void notModified(const QString &file);
+	/* Download error, cancel or abort */
+	void failed(const QString &file);
 
 private slots:
 	void emitFinished();
@@ -68,9 +103,17 @@ private:
 	bool doDownload(const Download &dl, const QByteArray &authorization,
 	  const Redirect *redirect = 0);
 	bool saveToDisk(const QString &filename, QIODevice *data);
+	void startScheduled();
+	void abort(QNetworkReply *reply);
 
-	QSet<QUrl> _currentDownloads;
+	bool _streaming;
+	QHash<QUrl, QNetworkReply*> _currentDownloads;
 	QHash<QUrl, int> _errorDownloads;
+	QList<Download> _queue;
+	QByteArray _queueAuthorization;
+	QSet<QUrl> _scheduled;
+	QHash<QString, int> _hostDownloads;
+	int _finished, _cancelled;
 
 	static QNetworkAccessManager *_manager;
 	static int _timeout;
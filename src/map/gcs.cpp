@@ -229,6 +229,16 @@ Coordinates GCS::fromWGS84(const Coordinates &c) const
 	return Coordinates(_primeMeridian.fromGreenwich(ds.lon()), ds.lat());
 }
 
+void GCS::fromWGS84(const Coordinates *c, Coordinates *out, int n) const
+{
+	datum().fromWGS84(c, out, n);
+
+	if (!_primeMeridian.isGreenwich())
+		for (int i = 0; i < n; i++)
+			out[i] = Coordinates(_primeMeridian.fromGreenwich(out[i].lon()),
+			  out[i].lat());
+}
+
 QList<KV<int, QString> > GCS::list()
 {
 	QList<KV<int, QString> > list;
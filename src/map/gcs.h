@@ -31,6 +31,9 @@ public:
 
 	Coordinates toWGS84(const Coordinates &c) const;
 	Coordinates fromWGS84(const Coordinates &c) const;
+	void fromWGS84(const Coordinates *c, Coordinates *out, int n) const;
+	bool isWGS84() const
+	  {return _datum.isWGS84() && _primeMeridian.isGreenwich();}
 
 	static const GCS *gcs(int id);
 	static const GCS *gcs(int geodeticDatum, int primeMeridian,
@@ -1,21 +1,38 @@
 #include <QFileInfo>
 #include <QPainter>
 #include <QImageReader>
+#include <QVector>
 #include "common/config.h"
+#include "common/rectc.h"
+#include "rectd.h"
 #include "geotiff.h"
 #include "image.h"
+#include "tiffimage.h"
+#include "tilecache.h"
 #include "geotiffmap.h"
 
 
 GeoTIFFMap::GeoTIFFMap(const QString &fileName, QObject *parent)
-  : Map(parent), _fileName(fileName), _img(0), _ratio(1.0), _valid(false)
+  : Map(parent), _fileName(fileName), _tiff(0), _img(0), _zoom(0),
+  _ratio(1.0), _id(TileCache::id()), _valid(false)
 {
-	QImageReader ir(fileName);
-	if (!ir.canRead()) {
-		_errorString = "Unsupported/invalid image file";
-		return;
+	/* Images that can not be read by blocks (unsupported sample formats,
+	   large compressed strips, ...) are loaded as a whole by Image */
+	_tiff = new TIFFImage(fileName);
+	if (_tiff->isValid()) {
+		for (int i = 0; i < _tiff->levels(); i++)
+			_zooms.append(_tiff->size(i));
+	} else {
+		delete _tiff;
+		_tiff = 0;
+
+		QImageReader ir(fileName);
+		if (!ir.canRead()) {
+			_errorString = "Unsupported/invalid image file";
+			return;
+		}
+		_zooms.append(ir.size());
 	}
-	_size = ir.size();
 
 	GeoTIFF gt(fileName);
 	if (!gt.isValid()) {
@@ -32,6 +49,7 @@ GeoTIFFMap::GeoTIFFMap(const QString &fileName, QObject *parent)
 GeoTIFFMap::~GeoTIFFMap()
 {
 	delete _img;
+	delete _tiff;
 }
 
 QString GeoTIFFMap::name() const
@@ -40,25 +58,133 @@ QString GeoTIFFMap::name() const
 	return fi.fileName();
 }
 
+QPointF GeoTIFFMap::scale() const
+{
+	const QSize &s = _zooms.at(_zoom);
+	const QSize &s0 = _zooms.first();
+
+	return QPointF((qreal)s.width() / (qreal)s0.width(),
+	  (qreal)s.height() / (qreal)s0.height());
+}
+
+QRectF GeoTIFFMap::bounds()
+{
+	return QRectF(QPointF(0, 0), _zooms.at(_zoom) / _ratio);
+}
+
+int GeoTIFFMap::zoomFit(const QSize &size, const RectC &rect)
+{
+	if (!rect.isValid())
+		_zoom = 0;
+	else {
+		RectD prect(rect, _projection);
+		QRectF sbr(_transform.proj2img(prect.topLeft()),
+		  _transform.proj2img(prect.bottomRight()));
+
+		for (int i = 0; i < _zooms.size(); i++) {
+			_zoom = i;
+			QPointF s(scale());
+			if (sbr.size().width() * s.x() <= size.width()
+			  && sbr.size().height() * s.y() <= size.height())
+				break;
+		}
+	}
+
+	return _zoom;
+}
+
+int GeoTIFFMap::zoomIn()
+{
+	_zoom = qMax(_zoom - 1, 0);
+	return _zoom;
+}
+
+int GeoTIFFMap::zoomOut()
+{
+	_zoom = qMin(_zoom + 1, _zooms.size() - 1);
+	return _zoom;
+}
+
 QPointF GeoTIFFMap::ll2xy(const Coordinates &c)
 {
-	return QPointF(_transform.proj2img(_projection.ll2xy(c))) / _ratio;
+	QPointF s(scale());
+	QPointF p(_transform.proj2img(_projection.ll2xy(c)));
+	return QPointF(p.x() * s.x(), p.y() * s.y()) / _ratio;
 }
 
-Coordinates GeoTIFFMap::xy2ll(const QPointF &p)
+void GeoTIFFMap::ll2xy(const Coordinates *c, QPointF *p, int n)
 {
-	return _projection.xy2ll(_transform.img2proj(p * _ratio));
+	QVector<PointD> pp(n);
+	QPointF s(scale());
+
+	_projection.ll2xy(c, pp.data(), n);
+	_transform.proj2img(pp.constData(), p, n);
+	if (s.x() != 1.0 || s.y() != 1.0 || _ratio != 1.0)
+		for (int i = 0; i < n; i++)
+			p[i] = QPointF(p[i].x() * s.x(), p[i].y() * s.y()) / _ratio;
 }
 
-QRectF GeoTIFFMap::bounds()
+Coordinates GeoTIFFMap::xy2ll(const QPointF &p)
 {
-	return QRectF(QPointF(0, 0), _size / _ratio);
+	QPointF s(scale());
+	return _projection.xy2ll(_transform.img2proj(QPointF(p.x() / s.x(),
+	  p.y() / s.y()) * _ratio));
 }
 
 void GeoTIFFMap::draw(QPainter *painter, const QRectF &rect, Flags flags)
 {
-	if (_img)
+	if (_img) {
 		_img->draw(painter, rect, flags);
+		return;
+	} else if (!_tiff || !_tiff->isOpen())
+		return;
+
+	QSize tileSize(_tiff->tileSize(_zoom));
+	QSizeF ts(tileSize.width() / _ratio, tileSize.height() / _ratio);
+	QPointF tl(floor(rect.left() / ts.width()) * ts.width(),
+	  floor(rect.top() / ts.height()) * ts.height());
+	QList<TIFFImage::Tile> tiles;
+
+	QSizeF s(rect.right() - tl.x(), rect.bottom() - tl.y());
+	for (int i = 0; i < ceil(s.width() / ts.width()); i++) {
+		for (int j = 0; j < ceil(s.height() / ts.height()); j++) {
+			int x = round(tl.x() * _ratio + i * tileSize.width());
+			int y = round(tl.y() * _ratio + j * tileSize.height());
+			QPointF tp(tl.x() + i * ts.width(), tl.y() + j * ts.height());
+
+			QPixmap pixmap;
+			TileCache::Key key(_id, _zoom, x, y);
+			if (TileCache::find(key, pixmap))
+				drawTile(painter, pixmap, tp);
+			else
+				tiles.append(TIFFImage::Tile(key, tp, QRect(QPoint(x, y),
+				  tileSize)));
+		}
+	}
+
+	_tiff->load(_zoom, tiles);
+
+	for (int i = 0; i < tiles.size(); i++) {
+		const TIFFImage::Tile &t = tiles.at(i);
+		QPixmap pixmap(t.pixmap());
+
+		if (pixmap.isNull())
+			qWarning("%s: %d_%d_%d: error loading tile image",
+			  qPrintable(_fileName), _zoom, t.key().x(), t.key().y());
+		else {
+			TileCache::insert(t.key(), pixmap);
+			drawTile(painter, pixmap, t.pos());
+		}
+	}
+}
+
+void GeoTIFFMap::drawTile(QPainter *painter, QPixmap &pixmap,
+  const QPointF &tp)
+{
+#ifdef ENABLE_HIDPI
+	pixmap.setDevicePixelRatio(_ratio);
+#endif // ENABLE_HIDPI
+	painter->drawPixmap(tp, pixmap);
 }
 
 void GeoTIFFMap::setDevicePixelRatio(qreal deviceRatio, qreal mapRatio)
@@ -72,12 +198,21 @@ void GeoTIFFMap::setDevicePixelRatio(qreal deviceRatio, qreal mapRatio)
 
 void GeoTIFFMap::load()
 {
-	if (!_img)
+	if (_tiff) {
+		if (!_tiff->open()) {
+			_errorString = "Error opening image file";
+			qWarning("%s: %s", qPrintable(_fileName), qPrintable(_errorString));
+		}
+	} else if (!_img) {
 		_img = new Image(_fileName);
+		_img->setDevicePixelRatio(_ratio);
+	}
 }
 
 void GeoTIFFMap::unload()
 {
+	if (_tiff)
+		_tiff->close();
 	delete _img;
 	_img = 0;
 }
@@ -5,7 +5,9 @@
 #include "projection.h"
 #include "map.h"
 
+class QPixmap;
 class Image;
+class TIFFImage;
 
 class GeoTIFFMap : public Map
 {
@@ -18,8 +20,16 @@ public:
 	QString name() const;
 
 	QRectF bounds();
+
+	int zoom() const {return _zoom;}
+	void setZoom(int zoom) {_zoom = zoom;}
+	int zoomFit(const QSize &size, const RectC &rect);
+	int zoomIn();
+	int zoomOut();
+
 	QPointF ll2xy(const Coordinates &c);
 	Coordinates xy2ll(const QPointF &p);
+	void ll2xy(const Coordinates *c, QPointF *p, int n);
 
 	void draw(QPainter *painter, const QRectF &rect, Flags flags);
 
@@ -31,12 +41,18 @@ public:
 	QString errorString() const {return _errorString;}
 
 private:
+	QPointF scale() const;
+	void drawTile(QPainter *painter, QPixmap &pixmap, const QPointF &tp);
+
 	QString _fileName;
 	Projection _projection;
 	Transform _transform;
+	TIFFImage *_tiff;
 	Image *_img;
-	QSize _size;
+	QList<QSize> _zooms;
+	int _zoom;
 	qreal _ratio;
+	quint32 _id;
 
 	bool _valid;
 	QString _errorString;
@@ -1,12 +1,12 @@
 #include <QPainter>
-#include <QPixmapCache>
 #include "common/config.h"
+#include "tilecache.h"
 #include "image.h"
 
 
 #define TILE_SIZE 256
 
-Image::Image(const QString &fileName) : _img(fileName), _fileName(fileName)
+Image::Image(const QString &fileName) : _img(fileName), _id(TileCache::id())
 {
 }
 
@@ -22,16 +22,15 @@ void Image::draw(QPainter *painter, const QRectF &rect, Map::Flags flags)
 	if (flags & Map::OpenGL) {
 		for (int i = sr.left()/TILE_SIZE; i <= sr.right()/TILE_SIZE; i++) {
 			for (int j = sr.top()/TILE_SIZE; j <= sr.bottom()/TILE_SIZE; j++) {
-				QString key = _fileName + "-" + QString::number(i) + "_"
-				  + QString::number(j);
+				TileCache::Key key(_id, 0, i, j);
 				QPoint tl(i * TILE_SIZE, j * TILE_SIZE);
 				QPixmap pm;
 
-				if (!QPixmapCache::find(key, &pm)) {
+				if (!TileCache::find(key, pm)) {
 					QRect tile(tl, QSize(TILE_SIZE, TILE_SIZE));
 					pm = QPixmap::fromImage(_img.copy(tile));
 					if (!pm.isNull())
-						QPixmapCache::insert(key, pm);
+						TileCache::insert(key, pm);
 				}
 #ifdef ENABLE_HIDPI
 				pm.setDevicePixelRatio(ratio);
@@ -16,7 +16,7 @@ public:
 
 private:
 	QImage _img;
-	QString _fileName;
+	quint32 _id;
 };
 
 #endif // IMAGE_H
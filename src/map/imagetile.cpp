@@ -0,0 +1,37 @@
+#include <QtGlobal>
+#if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
+#include <QtCore>
+#else // QT_VERSION < 5
+#include <QtConcurrent>
+#endif // QT_VERSION < 5
+#include "imagetile.h"
+
+
+void ImageTile::load()
+{
+	if (_data.isEmpty())
+		return;
+
+	if (_size.isValid()) {
+		QByteArray uba(qUncompress(_data));
+		if (uba.size() >= _size.width() * _size.height()) {
+			QImage img((const uchar*)uba.constData(), _size.width(),
+			  _size.height(), QImage::Format_Indexed8);
+			img.setColorTable(_palette);
+			_image = _mirrored ? img.mirrored() : img.copy();
+		}
+	} else
+		_image = QImage::fromData(_data);
+
+	_data = QByteArray();
+}
+
+void ImageTile::decode(QList<ImageTile> &tiles)
+{
+	if (tiles.size() == 1)
+		tiles.first().load();
+	else if (tiles.size() > 1) {
+		QFuture<void> future = QtConcurrent::map(tiles, &ImageTile::load);
+		future.waitForFinished();
+	}
+}
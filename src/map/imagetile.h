@@ -0,0 +1,46 @@
+#ifndef IMAGETILE_H
+#define IMAGETILE_H
+
+#include <QByteArray>
+#include <QImage>
+#include <QPixmap>
+#include <QVector>
+#include <QPointF>
+#include <QList>
+#include "tilecache.h"
+
+/* Raw (compressed) local raster map tile. The tile data are read on the GUI
+   thread, decoded in parallel by decode() and converted to pixmaps on the GUI
+   thread again. */
+class ImageTile
+{
+public:
+	ImageTile(const TileCache::Key &key, const QPointF &pos)
+	  : _key(key), _pos(pos), _mirrored(false) {}
+
+	const TileCache::Key &key() const {return _key;}
+	const QPointF &pos() const {return _pos;}
+	QPixmap pixmap() const {return QPixmap::fromImage(_image);}
+
+	/* Encoded image data in any format supported by QImageReader */
+	void setData(const QByteArray &data) {_data = data;}
+	/* Zlib compressed (qUncompress() format) 8bit indexed image data */
+	void setData(const QByteArray &data, const QSize &size,
+	  const QVector<QRgb> &palette, bool mirrored = false)
+	  {_data = data; _size = size; _palette = palette; _mirrored = mirrored;}
+
+	void load();
+
+	static void decode(QList<ImageTile> &tiles);
+
+private:
+	TileCache::Key _key;
+	QPointF _pos;
+	QByteArray _data;
+	QSize _size;
+	QVector<QRgb> _palette;
+	bool _mirrored;
+	QImage _image;
+};
+
+#endif // IMAGETILE_H
@@ -1,6 +1,10 @@
 #include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QDir>
+#include <QBuffer>
+#include <QCryptographicHash>
 #include <QPainter>
-#include <QPixmapCache>
 #if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
 #include <QtCore>
 #else // QT_VERSION < 5
@@ -9,17 +13,136 @@
 #include "common/rectc.h"
 #include "common/range.h"
 #include "common/wgs84.h"
+#include "common/programpaths.h"
 #include "IMG/img.h"
 #include "IMG/gmap.h"
 #include "IMG/rastertile.h"
+#include "IMG/diskcache.h"
 #include "osm.h"
 #include "pcs.h"
 #include "rectd.h"
+#include "tilecache.h"
 #include "imgmap.h"
 
 
 #define TILE_SIZE   384
-#define TEXT_EXTENT 160
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof(*a))
+/* Bump when the rendering changes so that the disk cache gets invalidated */
+#define CACHE_VERSION 1
+
+static bool diskCacheEnabled = false;
+
+static QByteArray encode(const QImage &img)
+{
+	QByteArray data;
+	QBuffer buffer(&data);
+
+	if (!img.isNull())
+		img.save(&buffer, "PNG");
+
+	return data;
+}
+
+/* Tile image taken from the disk cache or rendered (and encoded for the disk
+   cache) if not cached. load() runs in the worker threads, so the disk cache
+   lookup and the PNG decoding do not block the GUI thread. */
+class CachedTile
+{
+public:
+	CachedTile(const RasterTile &tile, const QString &cacheFile,
+	  const QString &diskKey) : _tile(tile), _cacheFile(cacheFile),
+	  _diskKey(diskKey) {}
+
+	const TileCache::Key &key() const {return _tile.key();}
+	const QPoint &xy() const {return _tile.xy();}
+	const QImage &img() const {return _img;}
+	/* Encoded image of a newly rendered tile to be stored in the cache */
+	const QByteArray &data() const {return _data;}
+
+	void load()
+	{
+		if (!_cacheFile.isNull() && DiskCache::find(_cacheFile, _diskKey, _data)
+		  && _img.loadFromData(_data, "PNG")) {
+			_data.clear();
+			return;
+		}
+
+		_tile.render();
+		_img = _tile.img();
+		_data = _cacheFile.isNull() ? QByteArray() : encode(_img);
+	}
+
+private:
+	RasterTile _tile;
+	QString _cacheFile;
+	QString _diskKey;
+	QImage _img;
+	QByteArray _data;
+};
+
+class IMGMapJob : public QRunnable
+{
+public:
+	IMGMapJob(IMGMap *map, const CachedTile &tile, bool prefetch,
+	  int generation) : _map(map), _tile(tile), _prefetch(prefetch),
+	  _generation(generation) {}
+
+	void run()
+	{
+		/* Tiles that went out of the view (or out of the prefetch area) before
+		   the job has been started are not loaded at all. */
+		if (_map->isWanted(_tile.key(), _prefetch))
+			_tile.load();
+
+		QMetaObject::invokeMethod(_map, "jobFinished", Qt::QueuedConnection,
+		  Q_ARG(TileCache::Key, _tile.key()), Q_ARG(QImage, _tile.img()),
+		  Q_ARG(QByteArray, _tile.data()), Q_ARG(bool, _prefetch),
+		  Q_ARG(int, _generation));
+	}
+
+private:
+	IMGMap *_map;
+	CachedTile _tile;
+	bool _prefetch;
+	int _generation;
+};
+
+static void loadTile(CachedTile &tile)
+{
+	tile.load();
+}
+
+static bool distanceLessThan(const QPair<qreal, int> &a,
+  const QPair<qreal, int> &b)
+{
+	return (a.first < b.first);
+}
+
+/* Projections have no identifier, so they are fingerprinted by a couple of
+   projected reference points. */
+static QString projectionId(const Projection &proj)
+{
+	static const Coordinates ref[] = {Coordinates(-120.0, 60.0),
+	  Coordinates(0, 0), Coordinates(150.0, -45.0)};
+	QByteArray ba;
+
+	for (size_t i = 0; i < ARRAY_SIZE(ref); i++) {
+		PointD p(proj.ll2xy(ref[i]));
+		ba += QByteArray::number(p.x(), 'g', 12) + ','
+		  + QByteArray::number(p.y(), 'g', 12) + ';';
+	}
+
+	return QString::fromLatin1(QCryptographicHash::hash(ba,
+	  QCryptographicHash::Md5).toHex().left(8));
+}
+
+static QString fileId(const QString &path)
+{
+	QFileInfo fi(path);
+
+	return fi.absoluteFilePath() + ":" + QString::number(fi.size()) + ":"
+	  + QString::number(fi.lastModified().toMSecsSinceEpoch());
+}
 
 static QList<MapData*> overlays(const QString &fileName)
 {
@@ -44,7 +167,8 @@ static QList<MapData*> overlays(const QString &fileName)
 }
 
 IMGMap::IMGMap(const QString &fileName, QObject *parent)
-  : Map(parent), _projection(PCS::pcs(3857)), _valid(false)
+  : Map(parent), _projection(PCS::pcs(3857)), _diskCache(0), _valid(false),
+  _generation(0)
 {
 	if (GMAP::isGMAP(fileName))
 		_data.append(new GMAP(fileName));
@@ -59,22 +183,84 @@ IMGMap::IMGMap(const QString &fileName, QObject *parent)
 	}
 
 	_dataBounds = _data.first()->bounds() & OSM::BOUNDS;
+	for (int i = 0; i < _data.size(); i++)
+		_ids.append(TileCache::id());
+	qRegisterMetaType<TileCache::Key>("TileCache::Key");
+
 	_zoom = _data.first()->zooms().min();
+	_projectionId = projectionId(_projection);
 	updateTransform();
 
 	_valid = true;
 }
 
+IMGMap::~IMGMap()
+{
+	cancelJobs();
+	_pool.waitForDone();
+
+	delete _diskCache;
+	qDeleteAll(_data);
+}
+
+void IMGMap::useDiskCache(bool use)
+{
+	diskCacheEnabled = use;
+}
+
+QString IMGMap::cacheFile() const
+{
+	QByteArray hash(QCryptographicHash::hash(QFileInfo(
+	  _data.first()->fileName()).absoluteFilePath().toUtf8(),
+	  QCryptographicHash::Md5).toHex());
+
+	return QDir(ProgramPaths::tilesDir()).filePath("IMG/"
+	  + QString::fromLatin1(hash) + ".db");
+}
+
+QString IMGMap::cacheIdentity() const
+{
+	QString typFile(ProgramPaths::typFile());
+	QString id(QString::number(CACHE_VERSION));
+
+	for (int i = 0; i < _data.size(); i++)
+		id += "|" + fileId(_data.at(i)->fileName());
+	if (!typFile.isEmpty())
+		id += "|" + fileId(typFile);
+
+	return id;
+}
+
 void IMGMap::load()
 {
 	for (int i = 0; i < _data.size(); i++)
 		_data.at(i)->load();
+
+	if (diskCacheEnabled && !_diskCache) {
+		_diskCache = new DiskCache(cacheFile(), cacheIdentity());
+		if (!_diskCache->isValid()) {
+			delete _diskCache;
+			_diskCache = 0;
+		}
+	}
 }
 
 void IMGMap::unload()
 {
+	cancelJobs();
+	_pool.waitForDone();
+
 	for (int i = 0; i < _data.size(); i++)
 		_data.at(i)->clear();
+
+	delete _diskCache;
+	_diskCache = 0;
+}
+
+void IMGMap::clearCache()
+{
+	if (_diskCache)
+		_diskCache->clear();
 }
 
 int IMGMap::zoomFit(const QSize &size, const RectC &rect)
@@ -143,34 +329,126 @@ QPointF IMGMap::ll2xy(const Coordinates &c)
 	return _transform.proj2img(_projection.ll2xy(c));
 }
 
+void IMGMap::ll2xy(const Coordinates *c, QPointF *p, int n)
+{
+	QVector<PointD> pp(n);
+
+	_projection.ll2xy(c, pp.data(), n);
+	_transform.proj2img(pp.constData(), p, n);
+}
+
 Coordinates IMGMap::xy2ll(const QPointF &p)
 {
 	return _projection.xy2ll(_transform.img2proj(p));
 }
 
-void IMGMap::ll2xy(QList<MapData::Poly> &polys)
+QString IMGMap::diskKey(const TileCache::Key &key) const
 {
-	for (int i = 0; i < polys.size(); i++) {
-		MapData::Poly &poly = polys[i];
-		for (int j = 0; j < poly.points.size(); j++) {
-			QPointF &p = poly.points[j];
-			p = ll2xy(Coordinates(p.x(), p.y()));
-		}
+	return _projectionId + "-" + QString::number(_ids.indexOf(key.map()))
+	  + "-" + QString::number(key.zoom()) + "_" + QString::number(key.x())
+	  + "_" + QString::number(key.y());
+}
+
+CachedTile IMGMap::cachedTile(const RasterTile &tile) const
+{
+	return _diskCache
+	  ? CachedTile(tile, _diskCache->fileName(), diskKey(tile.key()))
+	  : CachedTile(tile, QString(), QString());
+}
+
+bool IMGMap::isWanted(const TileCache::Key &key, bool prefetch)
+{
+	QMutexLocker locker(&_wantedLock);
+	return prefetch ? _prefetch.contains(key) : _wanted.contains(key);
+}
+
+void IMGMap::cancelJobs()
+{
+	_wantedLock.lock();
+	_wanted.clear();
+	_prefetch.clear();
+	_wantedLock.unlock();
+
+	_pending.clear();
+	_prefetchPending.clear();
+	_generation++;
+}
+
+void IMGMap::jobFinished(const TileCache::Key &key, const QImage &img,
+  const QByteArray &data, bool prefetch, int generation)
+{
+	if (generation != _generation)
+		return;
+
+	if (prefetch)
+		_prefetchPending.remove(key);
+	else
+		_pending.remove(key);
+
+	if (!img.isNull()) {
+		if (_diskCache && !data.isEmpty())
+			_diskCache->insert(diskKey(key), data);
+		TileCache::insert(key, QPixmap::fromImage(img));
+		if (isWanted(key, false))
+			emit tilesLoaded();
+	} else if (!prefetch && isWanted(key, false))
+		emit tilesLoaded();
+}
+
+void IMGMap::renderTilesSync(QPainter *painter, QList<RasterTile> &tiles)
+{
+	QList<CachedTile> ct;
+	for (int i = 0; i < tiles.size(); i++)
+		ct.append(cachedTile(tiles.at(i)));
+
+	QFuture<void> future = QtConcurrent::map(ct, loadTile);
+	future.waitForFinished();
+
+	for (int i = 0; i < ct.size(); i++) {
+		const CachedTile &mt = ct.at(i);
+		QPixmap pm(QPixmap::fromImage(mt.img()));
+		if (pm.isNull())
+			continue;
+
+		TileCache::insert(mt.key(), pm);
+		if (_diskCache && !mt.data().isEmpty())
+			_diskCache->insert(diskKey(mt.key()), mt.data());
+
+		painter->drawPixmap(mt.xy(), pm);
 	}
 }
 
-void IMGMap::ll2xy(QList<MapData::Point> &points)
+void IMGMap::renderTilesAsync(QList<RasterTile> &tiles,
+  const QSet<TileCache::Key> &keys, const QPointF &center)
 {
-	for (int i = 0; i < points.size(); i++) {
-		QPointF p(ll2xy(points.at(i).coordinates));
-		points[i].coordinates = Coordinates(p.x(), p.y());
+	QList<QPair<qreal, int> > order;
+
+	_wantedLock.lock();
+	_wanted = keys;
+	/* Tiles scheduled for prefetching that got into the view are rendered by
+	   the (higher priority) on-screen jobs. */
+	for (int i = 0; i < tiles.size(); i++)
+		_prefetch.remove(tiles.at(i).key());
+	_wantedLock.unlock();
+
+	for (int i = 0; i < tiles.size(); i++) {
+		QPointF d(QRectF(tiles.at(i).xy(), QSizeF(TILE_SIZE, TILE_SIZE))
+		  .center() - center);
+		order.append(QPair<qreal, int>(d.x() * d.x() + d.y() * d.y(), i));
+	}
+	qSort(order.begin(), order.end(), distanceLessThan);
+
+	// Tiles closest to the view center get the highest priority
+	for (int i = 0; i < order.size(); i++) {
+		const RasterTile &tile = tiles.at(order.at(i).second);
+		_pending.insert(tile.key());
+		_pool.start(new IMGMapJob(this, cachedTile(tile), false, _generation),
+		  order.size() - i);
 	}
 }
 
 void IMGMap::draw(QPainter *painter, const QRectF &rect, Flags flags)
 {
-	Q_UNUSED(flags);
-
 	QPointF tl(floor(rect.left() / TILE_SIZE)
 	  * TILE_SIZE, floor(rect.top() / TILE_SIZE) * TILE_SIZE);
 	QSizeF s(rect.right() - tl.x(), rect.bottom() - tl.y());
@@ -178,62 +456,106 @@ void IMGMap::draw(QPainter *painter, const QRectF &rect, Flags flags)
 	int height = ceil(s.height() / TILE_SIZE);
 
 	QList<RasterTile> tiles;
+	QSet<TileCache::Key> keys;
 
 	for (int n = 0; n < _data.size(); n++) {
 		for (int i = 0; i < width; i++) {
 			for (int j = 0; j < height; j++) {
 				QPixmap pm;
 				QPoint ttl(tl.x() + i * TILE_SIZE, tl.y() + j * TILE_SIZE);
-				QString key = _data.at(n)->fileName() + "-" + QString::number(_zoom)
-				  + "_" + QString::number(ttl.x()) + "_" + QString::number(ttl.y());
-				if (QPixmapCache::find(key, pm))
+				TileCache::Key key(_ids.at(n), _zoom, ttl);
+				if (TileCache::find(key, pm))
 					painter->drawPixmap(ttl, pm);
 				else {
-					QList<MapData::Poly> polygons, lines;
-					QList<MapData::Point> points;
-
-					QRectF polyRect(ttl, QPointF(ttl.x() + TILE_SIZE,
-					  ttl.y() + TILE_SIZE));
-					polyRect &= bounds().adjusted(0.5, 0.5, -0.5, -0.5);
-					RectD polyRectD(_transform.img2proj(polyRect.topLeft()),
-					  _transform.img2proj(polyRect.bottomRight()));
-					_data.at(n)->polys(polyRectD.toRectC(_projection, 4), _zoom,
-					  &polygons, &lines);
-					ll2xy(polygons); ll2xy(lines);
-
-					QRectF pointRect(QPointF(ttl.x() - TEXT_EXTENT,
-					  ttl.y() - TEXT_EXTENT), QPointF(ttl.x() + TILE_SIZE
-					  + TEXT_EXTENT, ttl.y() + TILE_SIZE + TEXT_EXTENT));
-					pointRect &= bounds().adjusted(0.5, 0.5, -0.5, -0.5);
-					RectD pointRectD(_transform.img2proj(pointRect.topLeft()),
-					  _transform.img2proj(pointRect.bottomRight()));
-					_data.at(n)->points(pointRectD.toRectC(_projection, 4),
-					  _zoom, &points);
-					ll2xy(points);
-
-					tiles.append(RasterTile(_data.at(n)->style(), _zoom,
-					  QRect(ttl, QSize(TILE_SIZE, TILE_SIZE)), key, polygons,
-					  lines, points));
+					if (!(flags & Map::Block)) {
+						keys.insert(key);
+						if (_pending.contains(key))
+							continue;
+					}
+					tiles.append(RasterTile(_data.at(n), _projection,
+					  _transform, _bounds, _zoom, QRect(ttl, QSize(TILE_SIZE,
+					  TILE_SIZE)), key));
 				}
 			}
 		}
 	}
 
-	QFuture<void> future = QtConcurrent::map(tiles, &RasterTile::render);
-	future.waitForFinished();
+	if (flags & Map::Block)
+		renderTilesSync(painter, tiles);
+	else
+		renderTilesAsync(tiles, keys, rect.center());
+}
 
-	for (int i = 0; i < tiles.size(); i++) {
-		RasterTile &mt = tiles[i];
-		QPixmap pm(QPixmap::fromImage(mt.img()));
-		if (pm.isNull())
-			continue;
+void IMGMap::prefetchTiles(int zoom, const QRectF &rect, const QRectF &exclude,
+  int max, QList<RasterTile> &tiles, QSet<TileCache::Key> &keys)
+{
+	Transform t(zoom == _zoom ? _transform : transform(zoom));
+	RectD prect(_dataBounds, _projection);
+	QRectF bounds(t.proj2img(prect.topLeft()), t.proj2img(prect.bottomRight()));
+	QRectF zr(QRectF(t.proj2img(_transform.img2proj(rect.topLeft())),
+	  t.proj2img(_transform.img2proj(rect.bottomRight()))) & bounds);
+	if (zr.isEmpty())
+		return;
 
-		QPixmapCache::insert(mt.key(), pm);
+	for (int i = floor(zr.left() / TILE_SIZE); i < ceil(zr.right()
+	  / TILE_SIZE); i++) {
+		for (int j = floor(zr.top() / TILE_SIZE); j < ceil(zr.bottom()
+		  / TILE_SIZE); j++) {
+			QRect tr(QPoint(i * TILE_SIZE, j * TILE_SIZE),
+			  QSize(TILE_SIZE, TILE_SIZE));
+			if (exclude.intersects(tr))
+				continue;
 
-		painter->drawPixmap(mt.xy(), pm);
+			for (int n = 0; n < _data.size(); n++) {
+				QPixmap pm;
+				TileCache::Key key(_ids.at(n), zoom, tr.topLeft());
+
+				if (keys.size() >= max)
+					return;
+				if (TileCache::find(key, pm))
+					continue;
+
+				keys.insert(key);
+				if (!_pending.contains(key) && !_prefetchPending.contains(key))
+					tiles.append(RasterTile(_data.at(n), _projection, t,
+					  bounds, zoom, tr, key));
+			}
+		}
 	}
 }
 
+void IMGMap::prefetch(const QRectF &view, const QRectF &ahead)
+{
+	const Range &zooms = _data.first()->zooms();
+	int max = TileCache::prefetchCount(QSize(TILE_SIZE, TILE_SIZE));
+	QList<RasterTile> tiles;
+	QSet<TileCache::Key> keys;
+
+	prefetchTiles(_zoom, ahead, view, max, tiles, keys);
+	if (_zoom > zooms.min())
+		prefetchTiles(_zoom - 1, view, QRectF(), max, tiles, keys);
+	if (_zoom < zooms.max())
+		prefetchTiles(_zoom + 1, view, QRectF(), max, tiles, keys);
+
+	_wantedLock.lock();
+	_prefetch = keys;
+	_wantedLock.unlock();
+
+	/* Prefetch jobs have a negative priority, so they are started only when
+	   there are no on-screen tiles waiting to be rendered. */
+	for (int i = 0; i < tiles.size(); i++) {
+		_prefetchPending.insert(tiles.at(i).key());
+		_pool.start(new IMGMapJob(this, cachedTile(tiles.at(i)), true,
+		  _generation), -1);
+	}
+}
+
+void IMGMap::cancelPrefetch()
+{
+	QMutexLocker locker(&_wantedLock);
+	_prefetch.clear();
+}
+
 void IMGMap::setProjection(const Projection &projection)
 {
 	if (projection == _projection)
@@ -244,7 +566,10 @@ void IMGMap::setProjection(const Projection &projection)
 	// (GARMIN world maps have N/S bounds up to 90/-90!)
 	_dataBounds = (_projection == PCS::pcs(3857) || _projection == PCS::pcs(3395))
 	  ? _data.first()->bounds() & OSM::BOUNDS : _data.first()->bounds();
+	_projectionId = projectionId(_projection);
 
 	updateTransform();
-	QPixmapCache::clear();
+	cancelJobs();
+	for (int i = 0; i < _ids.size(); i++)
+		TileCache::remove(_ids.at(i));
 }
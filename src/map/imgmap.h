@@ -1,11 +1,21 @@
 #ifndef IMGMAP_H
 #define IMGMAP_H
 
+#include <QSet>
+#include <QVector>
+#include <QImage>
+#include <QMutex>
+#include <QThreadPool>
 #include "map.h"
+#include "tilecache.h"
 #include "projection.h"
 #include "transform.h"
 #include "IMG/mapdata.h"
 
+class RasterTile;
+class DiskCache;
+class CachedTile;
+
 
 class IMGMap : public Map
 {
@@ -13,7 +23,7 @@ class IMGMap : public Map
 
 public:
 	IMGMap(const QString &fileName, QObject *parent = 0);
-	~IMGMap() {qDeleteAll(_data);}
+	~IMGMap();
 
 	QString name() const {return _data.first()->name();}
 
@@ -27,32 +37,64 @@ public:
 
 	QPointF ll2xy(const Coordinates &c);
 	Coordinates xy2ll(const QPointF &p);
+	void ll2xy(const Coordinates *c, QPointF *p, int n);
 
 	void draw(QPainter *painter, const QRectF &rect, Flags flags);
+	void prefetch(const QRectF &view, const QRectF &ahead);
+	void cancelPrefetch();
 
 	void setProjection(const Projection &projection);
 
 	void load();
 	void unload();
+	void clearCache();
 
 	bool isValid() const {return _valid;}
 	QString errorString() const {return _errorString;}
 
+	static void useDiskCache(bool use);
+
+private slots:
+	void jobFinished(const TileCache::Key &key, const QImage &img,
+	  const QByteArray &data, bool prefetch, int generation);
+
 private:
-	void ll2xy(QList<MapData::Poly> &polys);
-	void ll2xy(QList<MapData::Point> &points);
+	friend class IMGMapJob;
+
 	Transform transform(int zoom) const;
 	void updateTransform();
+	QString diskKey(const TileCache::Key &key) const;
+	QString cacheFile() const;
+	QString cacheIdentity() const;
+	CachedTile cachedTile(const RasterTile &tile) const;
+	void renderTilesSync(QPainter *painter, QList<RasterTile> &tiles);
+	void renderTilesAsync(QList<RasterTile> &tiles,
+	  const QSet<TileCache::Key> &keys, const QPointF &center);
+	void prefetchTiles(int zoom, const QRectF &rect, const QRectF &exclude,
+	  int max, QList<RasterTile> &tiles, QSet<TileCache::Key> &keys);
+	void cancelJobs();
+	bool isWanted(const TileCache::Key &key, bool prefetch);
 
 	QList<MapData *> _data;
+	QVector<quint32> _ids;
 	int _zoom;
 	Projection _projection;
 	Transform _transform;
 	QRectF _bounds;
 	RectC _dataBounds;
+	QString _projectionId;
+	DiskCache *_diskCache;
 
 	bool _valid;
 	QString _errorString;
+
+	QThreadPool _pool;
+	QSet<TileCache::Key> _pending;
+	QSet<TileCache::Key> _wanted;
+	QSet<TileCache::Key> _prefetchPending;
+	QSet<TileCache::Key> _prefetch;
+	QMutex _wantedLock;
+	int _generation;
 };
 
 #endif // IMGMAP_H
@@ -1,11 +1,12 @@
 #include <QtEndian>
 #include <QPainter>
 #include <QFileInfo>
-#include <QPixmapCache>
 #include "common/config.h"
 #include "rectd.h"
 #include "gcs.h"
 #include "pcs.h"
+#include "tilecache.h"
+#include "imagetile.h"
 #include "jnxmap.h"
 
 
@@ -20,10 +21,12 @@ struct Level {
 struct Ctx {
 	QPainter *painter;
 	QFile *file;
+	quint32 id;
 	qreal ratio;
+	QList<ImageTile> tiles;
 
-	Ctx(QPainter *painter, QFile *file, qreal ratio)
-	  : painter(painter), file(file), ratio(ratio) {}
+	Ctx(QPainter *painter, QFile *file, quint32 id, qreal ratio)
+	  : painter(painter), file(file), id(id), ratio(ratio) {}
 };
 
 
@@ -139,7 +142,8 @@ bool JNXMap::readTiles()
 }
 
 JNXMap::JNXMap(const QString &fileName, QObject *parent)
-  : Map(parent), _file(fileName), _zoom(0), _mapRatio(1.0), _valid(false)
+  : Map(parent), _file(fileName), _id(TileCache::id()), _zoom(0),
+  _mapRatio(1.0), _valid(false)
 {
 	_name = QFileInfo(fileName).fileName();
 
@@ -205,48 +209,56 @@ int JNXMap::zoomOut()
 	return _zoom;
 }
 
-QPixmap JNXMap::pixmap(const Tile *tile, QFile *file)
+QByteArray JNXMap::tileData(const Tile *tile, QFile *file)
 {
+	QByteArray ba;
+	ba.resize(tile->size + 2);
+	ba[0] = (char)0xFF;
+	ba[1] = (char)0xD8;
+	char *data = ba.data() + 2;
+
+	if (!file->seek(tile->offset))
+		return QByteArray();
+	if (!file->read(data, tile->size))
+		return QByteArray();
+
+	return ba;
+}
+
+bool JNXMap::cb(Tile *tile, void *context)
+{
+	Ctx *ctx = static_cast<Ctx*>(context);
+	QPointF tp(tile->pos / ctx->ratio);
 	QPixmap pm;
 
-	QString key = file->fileName() + "-" + QString::number(tile->offset);
-	if (!QPixmapCache::find(key, &pm)) {
-		QByteArray ba;
-		ba.resize(tile->size + 2);
-		ba[0] = (char)0xFF;
-		ba[1] = (char)0xD8;
-		char *data = ba.data() + 2;
-
-		if (!file->seek(tile->offset))
-			return QPixmap();
-		if (!file->read(data, tile->size))
-			return QPixmap();
-		pm = QPixmap::fromImage(QImage::fromData(ba));
-
-		if (!pm.isNull())
-			QPixmapCache::insert(key, pm);
+	// Tile offsets are unique in the whole file, no need for the zoom level
+	TileCache::Key key(ctx->id, 0, (int)tile->offset, 0);
+	if (TileCache::find(key, pm))
+		drawTile(ctx->painter, pm, tp, ctx->ratio);
+	else {
+		ctx->tiles.append(ImageTile(key, tp));
+		ctx->tiles.last().setData(tileData(tile, ctx->file));
 	}
 
-	return pm;
+	return true;
 }
 
-bool JNXMap::cb(Tile *tile, void *context)
+void JNXMap::drawTile(QPainter *painter, QPixmap &pixmap, const QPointF &tp,
+  qreal ratio)
 {
-	Ctx *ctx = static_cast<Ctx*>(context);
-	QPixmap pm(pixmap(tile, ctx->file));
 #ifdef ENABLE_HIDPI
-	pm.setDevicePixelRatio(ctx->ratio);
+	pixmap.setDevicePixelRatio(ratio);
+#else // ENABLE_HIDPI
+	Q_UNUSED(ratio);
 #endif // ENABLE_HIDPI
-	ctx->painter->drawPixmap(tile->pos / ctx->ratio, pm);
-
-	return true;
+	painter->drawPixmap(tp, pixmap);
 }
 
 void JNXMap::draw(QPainter *painter, const QRectF &rect, Flags flags)
 {
 	Q_UNUSED(flags);
 	const RTree<Tile*, qreal, 2> &tree = _zooms.at(_zoom).tree;
-	Ctx ctx(painter, &_file, _mapRatio);
+	Ctx ctx(painter, &_file, _id, _mapRatio);
 	QRectF rr(rect.topLeft() * _mapRatio, rect.size() * _mapRatio);
 
 	qreal min[2], max[2];
@@ -255,4 +267,19 @@ void JNXMap::draw(QPainter *painter, const QRectF &rect, Flags flags)
 	max[0] = rr.right();
 	max[1] = rr.bottom();
 	tree.Search(min, max, cb, &ctx);
+
+	ImageTile::decode(ctx.tiles);
+
+	for (int i = 0; i < ctx.tiles.size(); i++) {
+		const ImageTile &t = ctx.tiles.at(i);
+		QPixmap pm(t.pixmap());
+
+		if (pm.isNull())
+			qWarning("%s: %d: error loading tile image",
+			  qPrintable(_file.fileName()), t.key().x());
+		else {
+			TileCache::insert(t.key(), pm);
+			drawTile(painter, pm, t.pos(), _mapRatio);
+		}
+	}
 }
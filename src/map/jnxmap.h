@@ -9,6 +9,8 @@
 #include "projection.h"
 #include "map.h"
 
+class QPixmap;
+
 class JNXMap : public Map
 {
 public:
@@ -56,10 +58,13 @@ private:
 	bool readTiles();
 
 	static bool cb(Tile *tile, void *context);
-	static QPixmap pixmap(const Tile *tile, QFile *file);
+	static QByteArray tileData(const Tile *tile, QFile *file);
+	static void drawTile(QPainter *painter, QPixmap &pixmap, const QPointF &tp,
+	  qreal ratio);
 
 	QString _name;
 	QFile _file;
+	quint32 _id;
 	QVector<Zoom> _zooms;
 	int _zoom;
 	RectC _bounds;
@@ -112,6 +112,12 @@ PointD LambertConic1::ll2xy(const Coordinates &c) const
 	  * cos(theta) + _falseNorthing);
 }
 
+void LambertConic1::ll2xy(const Coordinates *c, PointD *p, int n) const
+{
+	for (int i = 0; i < n; i++)
+		p[i] = LambertConic1::ll2xy(c[i]);
+}
+
 Coordinates LambertConic1::xy2ll(const PointD &p) const
 {
 	double dx;
@@ -270,6 +276,11 @@ PointD LambertConic2::ll2xy(const Coordinates &c) const
 	return _lc1.ll2xy(c);
 }
 
+void LambertConic2::ll2xy(const Coordinates *c, PointD *p, int n) const
+{
+	_lc1.ll2xy(c, p, n);
+}
+
 Coordinates LambertConic2::xy2ll(const PointD &p) const
 {
 	return _lc1.xy2ll(p);
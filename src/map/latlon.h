@@ -20,6 +20,12 @@ public:
 	  {return PointD(_au.fromDegrees(c.lon()), _au.fromDegrees(c.lat()));}
 	virtual Coordinates xy2ll(const PointD &p) const
 	  {return Coordinates(_au.toDegrees(p.x()), _au.toDegrees(p.y()));}
+	virtual void ll2xy(const Coordinates *c, PointD *p, int n) const
+	{
+		for (int i = 0; i < n; i++)
+			p[i] = PointD(_au.fromDegrees(c[i].lon()),
+			  _au.fromDegrees(c[i].lat()));
+	}
 
 private:
 	AngularUnits _au;
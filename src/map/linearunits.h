@@ -23,6 +23,13 @@ public:
 	double fromMeters(double val) const {return val / _f;}
 	PointD fromMeters(const PointD &p) const
 	  {return PointD(p.x() / _f, p.y() /_f);}
+	void fromMeters(PointD *p, int n) const
+	{
+		if (_f == 1.0)
+			return;
+		for (int i = 0; i < n; i++)
+			p[i] = PointD(p[i].x() / _f, p[i].y() / _f);
+	}
 
 #ifndef QT_NO_DEBUG
 	friend QDebug operator<<(QDebug dbg, const LinearUnits &lu);
@@ -12,3 +12,15 @@ qreal Map::resolution(const QRectF &rect)
 
 	return ds/ps;
 }
+
+qint64 Map::seedCount(const RectC &rect, const Range &zooms) const
+{
+	qint64 count = 0;
+
+	for (int z = zooms.min(); z <= zooms.max(); z++) {
+		QRect range(seedRange(rect, z));
+		count += (qint64)range.width() * range.height();
+	}
+
+	return count;
+}
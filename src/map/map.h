@@ -3,9 +3,11 @@
 
 #include <QObject>
 #include <QString>
+#include <QRect>
 #include <QRectF>
 #include <QFlags>
 #include "common/coordinates.h"
+#include "common/range.h"
 
 
 class QPainter;
@@ -38,10 +40,33 @@ public:
 	virtual int zoomIn() {return 0;}
 	virtual int zoomOut() {return 0;}
 
+	/* ll2xy(), xy2ll() and resolution() may be called from several threads
+	   at once, but never concurrently with any other map change (zoom,
+	   projection, load/unload, ...). */
 	virtual QPointF ll2xy(const Coordinates &c) = 0;
 	virtual Coordinates xy2ll(const QPointF &p) = 0;
+	/* Batch ll2xy(), projection based maps override it with the batch
+	   Projection/Transform conversions. */
+	virtual void ll2xy(const Coordinates *c, QPointF *p, int n)
+	  {for (int i = 0; i < n; i++) p[i] = ll2xy(c[i]);}
 
 	virtual void draw(QPainter *painter, const QRectF &rect, Flags flags) = 0;
+	/* Background loading of the tiles that are likely to be drawn next - the
+	   tiles of the ahead rect and the parent/child zoom levels of the view
+	   rect. Runs with lower priority than draw(), must not block and replaces
+	   any previous prefetch request. */
+	virtual void prefetch(const QRectF &, const QRectF &) {}
+	virtual void cancelPrefetch() {}
+	/* Offline seeding of the map tile cache. The zoom levels are in the zoom()
+	   units, an invalid seedZooms() range means the map can not be seeded.
+	   Already cached tiles are skipped, so an interrupted seeding resumes when
+	   started again with the same parameters. seedRange() is the range of
+	   the tiles at the given zoom level covering the rect. */
+	virtual Range seedZooms() const {return Range(0, -1);}
+	virtual QRect seedRange(const RectC &, int) const {return QRect();}
+	qint64 seedCount(const RectC &rect, const Range &zooms) const;
+	virtual void seed(const RectC &, const Range &) {}
+	virtual void cancelSeed() {}
 
 	virtual void clearCache() {}
 	virtual void load() {}
@@ -56,6 +81,8 @@ public:
 signals:
 	void tilesLoaded();
 	void mapLoaded();
+	void seedProgress(int done, int skipped, int failed, int total,
+	  qint64 size);
 };
 
 Q_DECLARE_METATYPE(Map*)
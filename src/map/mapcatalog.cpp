@@ -0,0 +1,272 @@
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDateTime>
+#include <QDataStream>
+#include <QTimer>
+#include <QtGlobal>
+#if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
+#include <QtCore>
+#else // QT_VERSION < 5
+#include <QtConcurrent>
+#endif // QT_VERSION < 5
+#include "common/programpaths.h"
+#include "catalogmap.h"
+#include "mapcatalog.h"
+
+
+#define MAGIC   0x4D415043 /* MAPC */
+#define VERSION 2
+
+static QDataStream &operator<<(QDataStream &stream,
+  const MapCatalog::Entry &entry)
+{
+	stream << entry.path << (qint32)entry.format << entry.mtime << entry.size
+	  << entry.name << (qint32)entry.zooms.min() << (qint32)entry.zooms.max();
+
+	return stream;
+}
+
+static QDataStream &operator>>(QDataStream &stream, MapCatalog::Entry &entry)
+{
+	qint32 format, min, max;
+
+	stream >> entry.path >> format >> entry.mtime >> entry.size >> entry.name
+	  >> min >> max;
+	entry.format = (MapList::Format)format;
+	entry.zooms = Range(min, max);
+
+	return stream;
+}
+
+MapCatalog::MapCatalog(const QString &dir, QObject *parent)
+  : QObject(parent), _dir(QDir(dir).absolutePath()), _changed(false)
+{
+	_indexFile = QDir(ProgramPaths::tilesDir()).filePath("maps.idx");
+	connect(&_watcher, SIGNAL(finished()), this, SLOT(scanFinished()));
+
+	if (!loadIndex())
+		_entries.clear();
+}
+
+MapCatalog::~MapCatalog()
+{
+	_watcher.waitForFinished();
+}
+
+QList<Map*> MapCatalog::maps()
+{
+	QList<Map*> list;
+
+	for (int i = 0; i < _entries.size(); i++) {
+		const Entry &entry = _entries.at(i);
+		if (entry.format == MapList::UnknownFormat)
+			continue;
+
+		Map *map = createMap(entry);
+		if (map) {
+			_maps.insert(entry.path, map);
+			list.append(map);
+		}
+	}
+
+	return list;
+}
+
+void MapCatalog::rescan()
+{
+	if (_watcher.isRunning() || !_queue.isEmpty())
+		return;
+
+	_watcher.setFuture(QtConcurrent::run(&MapCatalog::scan, _dir));
+}
+
+QList<MapCatalog::Entry> MapCatalog::scan(const QString &dir)
+{
+	QList<MapList::File> files(MapList::files(dir));
+	QList<Entry> list;
+
+	for (int i = 0; i < files.size(); i++) {
+		QFileInfo fi(files.at(i).first);
+		Entry entry;
+
+		entry.path = files.at(i).first;
+		entry.format = files.at(i).second;
+		entry.mtime = fi.lastModified().toMSecsSinceEpoch();
+		entry.size = fi.size();
+
+		list.append(entry);
+	}
+
+	return list;
+}
+
+Map *MapCatalog::createMap(const Entry &entry)
+{
+	// Online map sources are small XML files and may need some time to get
+	// ready, so they are always loaded directly.
+	if (entry.format == MapList::SourceFormat) {
+		QString errorString;
+		Map *map = MapList::createMap(entry.format, entry.path, errorString);
+		if (!map)
+			qWarning("%s: %s", qPrintable(entry.path),
+			  qPrintable(errorString));
+		return map;
+	} else
+		return new CatalogMap(entry);
+}
+
+/* Maps that are already in use are not replaced, their entries are updated
+   from the live map objects instead. */
+bool MapCatalog::updateLoaded(Entry &entry) const
+{
+	Map *map = _maps.value(entry.path);
+	if (!map)
+		return false;
+
+	CatalogMap *cm = qobject_cast<CatalogMap*>(map);
+	if (cm && !cm->isLoaded())
+		return false;
+
+	Map *lm = cm ? cm->loadedMap() : map;
+	if (lm)
+		update(entry, lm);
+	else
+		entry.format = MapList::UnknownFormat;
+
+	return true;
+}
+
+void MapCatalog::update(Entry &entry, Map *map) const
+{
+	entry.name = map->name();
+	entry.zooms = map->seedZooms();
+}
+
+void MapCatalog::scanFinished()
+{
+	QList<Entry> entries(_watcher.result());
+	QHash<QString, int> old;
+
+	for (int i = 0; i < _entries.size(); i++)
+		old.insert(_entries.at(i).path, i);
+
+	for (int i = 0; i < entries.size(); i++) {
+		Entry &entry = entries[i];
+
+		QHash<QString, int>::iterator it = old.find(entry.path);
+		if (it != old.end()) {
+			const Entry &oe = _entries.at(*it);
+			old.erase(it);
+			if (oe.mtime == entry.mtime && oe.size == entry.size) {
+				entry = oe;
+				continue;
+			}
+		}
+
+		_changed = true;
+		if (!updateLoaded(entry))
+			_queue.append(i);
+	}
+
+	for (QHash<QString, int>::const_iterator it = old.constBegin();
+	  it != old.constEnd(); ++it) {
+		Entry entry(_entries.at(*it));
+		Map *map = _maps.value(it.key());
+		if (map && !updateLoaded(entry))
+			emit mapRemoved(map);
+		_maps.remove(it.key());
+		_changed = true;
+	}
+
+	_entries = entries;
+	indexNext();
+}
+
+void MapCatalog::indexNext()
+{
+	if (_queue.isEmpty()) {
+		if (_changed) {
+			if (!saveIndex())
+				qWarning("%s: error writing map catalog",
+				  qPrintable(_indexFile));
+			_changed = false;
+		}
+		return;
+	}
+
+	/* One map at a time, so that indexing a large number of new maps does not
+	   block the GUI. */
+	Entry &entry = _entries[_queue.takeFirst()];
+	if (updateLoaded(entry)) {
+		QTimer::singleShot(0, this, SLOT(indexNext()));
+		return;
+	}
+
+	Map *old = _maps.take(entry.path);
+	if (old)
+		emit mapRemoved(old);
+
+	QString errorString;
+	Map *map = MapList::createMap(entry.format, entry.path, errorString);
+	if (map) {
+		update(entry, map);
+		if (entry.format != MapList::SourceFormat) {
+			delete map;
+			map = new CatalogMap(entry);
+		}
+		_maps.insert(entry.path, map);
+		emit mapAdded(map);
+	} else {
+		qWarning("%s: %s", qPrintable(entry.path), qPrintable(errorString));
+		entry.format = MapList::UnknownFormat;
+	}
+
+	QTimer::singleShot(0, this, SLOT(indexNext()));
+}
+
+bool MapCatalog::loadIndex()
+{
+	QFile file(_indexFile);
+	if (!file.open(QIODevice::ReadOnly))
+		return false;
+
+	QDataStream stream(&file);
+	quint32 magic, version, count;
+	QString dir;
+
+	stream >> magic >> version;
+	if (stream.status() != QDataStream::Ok || magic != MAGIC
+	  || version != VERSION)
+		return false;
+	stream >> dir >> count;
+	if (dir != _dir)
+		return false;
+
+	for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; i++) {
+		Entry entry;
+		stream >> entry;
+		_entries.append(entry);
+	}
+
+	return (stream.status() == QDataStream::Ok);
+}
+
+bool MapCatalog::saveIndex() const
+{
+	QFileInfo fi(_indexFile);
+	if (!QDir().mkpath(fi.absolutePath()))
+		return false;
+
+	QFile file(_indexFile);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+		return false;
+
+	QDataStream stream(&file);
+	stream << (quint32)MAGIC << (quint32)VERSION << _dir
+	  << (quint32)_entries.size();
+	for (int i = 0; i < _entries.size(); i++)
+		stream << _entries.at(i);
+
+	return (stream.status() == QDataStream::Ok);
+}
@@ -0,0 +1,71 @@
+#ifndef MAPCATALOG_H
+#define MAPCATALOG_H
+
+#include <QObject>
+#include <QList>
+#include <QHash>
+#include <QPointer>
+#include <QFutureWatcher>
+#include "common/range.h"
+#include "maplist.h"
+
+class Map;
+
+/* Persistent metadata index of the maps directory. The maps are created from
+   the index without touching the map files, the local map files are
+   instantiated only when a map is used (CatalogMap). rescan() updates the
+   index in the background, changed entries are announced with the
+   mapAdded()/mapRemoved() signals. */
+class MapCatalog : public QObject
+{
+	Q_OBJECT
+
+public:
+	class Entry {
+	public:
+		Entry() : format(MapList::UnknownFormat), mtime(0), size(0),
+		  zooms(0, -1) {}
+
+		QString path;
+		MapList::Format format;
+		qint64 mtime;
+		qint64 size;
+
+		QString name;
+		Range zooms;
+	};
+
+	MapCatalog(const QString &dir, QObject *parent = 0);
+	~MapCatalog();
+
+	QList<Map*> maps();
+	void rescan();
+
+signals:
+	void mapAdded(Map *map);
+	void mapRemoved(Map *map);
+
+private slots:
+	void scanFinished();
+	void indexNext();
+
+private:
+	static QList<Entry> scan(const QString &dir);
+
+	Map *createMap(const Entry &entry);
+	bool updateLoaded(Entry &entry) const;
+	void update(Entry &entry, Map *map) const;
+	bool loadIndex();
+	bool saveIndex() const;
+
+	QString _dir;
+	QString _indexFile;
+	QList<Entry> _entries;
+	QHash<QString, QPointer<Map> > _maps;
+
+	QFutureWatcher<QList<Entry> > _watcher;
+	QList<int> _queue;
+	bool _changed;
+};
+
+#endif // MAPCATALOG_H
@@ -13,38 +13,73 @@
 #include "maplist.h"
 
 
-Map *MapList::loadFile(const QString &path, QString &errorString,
-  bool *terminate)
+MapList::Format MapList::format(const QString &path, bool *terminate)
 {
 	QFileInfo fi(path);
 	QString suffix = fi.suffix().toLower();
-	Map *map = 0;
 
 	if (Atlas::isAtlas(path)) {
 		if (terminate)
 			*terminate = true;
-		map = new Atlas(path);
+		return AtlasFormat;
 	} else if (suffix == "xml") {
-		if (MapSource::isMap(path)) {
-			if (!(map = MapSource::loadMap(path, errorString)))
-				return 0;
-		} else if (GMAP::isGMAP(path)) {
+		if (MapSource::isMap(path))
+			return SourceFormat;
+		else if (GMAP::isGMAP(path)) {
 			if (terminate)
 				*terminate = true;
-			map = new IMGMap(path);
+			return IMGFormat;
 		}
 	} else if (suffix == "jnx")
-		map = new JNXMap(path);
+		return JNXFormat;
 	else if (suffix == "tif" || suffix == "tiff")
-		map = new GeoTIFFMap(path);
+		return GeoTIFFFormat;
 	else if (suffix == "mbtiles")
-		map = new MBTilesMap(path);
+		return MBTilesFormat;
 	else if (suffix == "rmap" || suffix == "rtmap")
-		map = new RMap(path);
+		return RMapFormat;
 	else if (suffix == "img")
-		map = new IMGMap(path);
+		return IMGFormat;
 	else if (suffix == "map" || suffix == "tar")
-		map = new OziMap(path);
+		return OziFormat;
+
+	return UnknownFormat;
+}
+
+Map *MapList::createMap(Format format, const QString &path,
+  QString &errorString)
+{
+	Map *map = 0;
+
+	switch (format) {
+		case SourceFormat:
+			if (!(map = MapSource::loadMap(path, errorString)))
+				return 0;
+			break;
+		case AtlasFormat:
+			map = new Atlas(path);
+			break;
+		case IMGFormat:
+			map = new IMGMap(path);
+			break;
+		case JNXFormat:
+			map = new JNXMap(path);
+			break;
+		case GeoTIFFFormat:
+			map = new GeoTIFFMap(path);
+			break;
+		case MBTilesFormat:
+			map = new MBTilesMap(path);
+			break;
+		case RMapFormat:
+			map = new RMap(path);
+			break;
+		case OziFormat:
+			map = new OziMap(path);
+			break;
+		default:
+			break;
+	}
 
 	if (map && map->isValid())
 		return map;
@@ -55,13 +90,18 @@ Map *MapList::loadFile(const QString &path, QString &errorString,
 	}
 }
 
-QList<Map*> MapList::loadDir(const QString &path, QString &errorString)
+Map *MapList::loadFile(const QString &path, QString &errorString)
+{
+	return createMap(format(path, 0), path, errorString);
+}
+
+QList<MapList::File> MapList::files(const QString &path)
 {
 	QDir md(path);
 	md.setFilter(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot);
 	md.setSorting(QDir::DirsLast);
 	QFileInfoList ml = md.entryInfoList();
-	QList<Map*> list;
+	QList<File> list;
 
 	for (int i = 0; i < ml.size(); i++) {
 		const QFileInfo &fi = ml.at(i);
@@ -69,14 +109,10 @@ QList<Map*> MapList::loadDir(const QString &path, QString &errorString)
 		bool terminate = false;
 
 		if (fi.isDir() && fi.fileName() != "set")
-			list.append(loadDir(fi.absoluteFilePath(), errorString));
+			list.append(files(fi.absoluteFilePath()));
 		else if (filter().contains("*." + suffix)) {
-			Map *map = loadFile(fi.absoluteFilePath(), errorString, &terminate);
-			if (map)
-				list.append(map);
-			else
-				qWarning("%s: %s", qPrintable(fi.absoluteFilePath()),
-				  qPrintable(errorString));
+			list.append(File(fi.absoluteFilePath(),
+			  format(fi.absoluteFilePath(), &terminate)));
 			if (terminate)
 				break;
 		}
@@ -85,13 +121,31 @@ QList<Map*> MapList::loadDir(const QString &path, QString &errorString)
 	return list;
 }
 
+QList<Map*> MapList::loadDir(const QString &path, QString &errorString)
+{
+	QList<File> fl(files(path));
+	QList<Map*> list;
+
+	for (int i = 0; i < fl.size(); i++) {
+		const File &file = fl.at(i);
+		Map *map = createMap(file.second, file.first, errorString);
+		if (map)
+			list.append(map);
+		else
+			qWarning("%s: %s", qPrintable(file.first),
+			  qPrintable(errorString));
+	}
+
+	return list;
+}
+
 QList<Map*> MapList::loadMaps(const QString &path, QString &errorString)
 {
 	if (QFileInfo(path).isDir())
 		return loadDir(path, errorString);
 	else {
 		QList<Map*> list;
-		Map *map = loadFile(path, errorString, 0);
+		Map *map = loadFile(path, errorString);
 		if (map)
 			list.append(map);
 		return list;
@@ -2,19 +2,41 @@
 #define MAPLIST_H
 
 #include <QString>
+#include <QList>
+#include <QPair>
 
 class Map;
 
 class MapList
 {
 public:
+	enum Format {
+		UnknownFormat,
+		SourceFormat,
+		AtlasFormat,
+		IMGFormat,
+		JNXFormat,
+		GeoTIFFFormat,
+		MBTilesFormat,
+		RMapFormat,
+		OziFormat
+	};
+	typedef QPair<QString, Format> File;
+
 	static QList<Map*> loadMaps(const QString &path, QString &errorString);
 	static QString formats();
 	static QStringList filter();
 
+	/* The map files of a directory tree in the loadMaps() order, including
+	   the files of unknown format. Only reads the headers of the files that
+	   can not be recognized by the suffix. */
+	static QList<File> files(const QString &path);
+	static Map *createMap(Format format, const QString &path,
+	  QString &errorString);
+
 private:
-	static Map *loadFile(const QString &path, QString &errorString,
-	  bool *terminate);
+	static Format format(const QString &path, bool *terminate);
+	static Map *loadFile(const QString &path, QString &errorString);
 	static QList<Map*> loadDir(const QString &path, QString &errorString);
 };
 
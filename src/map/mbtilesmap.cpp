@@ -3,9 +3,10 @@
 #include <QSqlField>
 #include <QFileInfo>
 #include <QPainter>
-#include <QPixmapCache>
 #include <QImageReader>
 #include <QBuffer>
+#include <QRunnable>
+#include <QAtomicInt>
 #if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
 #include <QtCore>
 #else // QT_VERSION < 5
@@ -14,6 +15,7 @@
 #include "common/rectc.h"
 #include "common/config.h"
 #include "osm.h"
+#include "tilecache.h"
 #include "mbtilesmap.h"
 
 
@@ -21,11 +23,12 @@ class MBTile
 {
 public:
 	MBTile(int zoom, int scaledSize, const QPoint &xy, const QByteArray &data,
-	  const QString &key) : _zoom(zoom), _scaledSize(scaledSize), _xy(xy),
-	  _data(data), _key(key) {}
+	  const TileCache::Key &key) : _zoom(zoom), _scaledSize(scaledSize),
+	  _xy(xy), _data(data), _key(key) {}
 
 	const QPoint &xy() const {return _xy;}
-	const QString &key() const {return _key;}
+	const TileCache::Key &key() const {return _key;}
+	const QImage &image() const {return _image;}
 	QPixmap pixmap() const {return QPixmap::fromImage(_image);}
 
 	void load() {
@@ -43,10 +46,82 @@ private:
 	int _scaledSize;
 	QPoint _xy;
 	QByteArray _data;
-	QString _key;
+	TileCache::Key _key;
 	QImage _image;
 };
 
+static QByteArray tileData(const QSqlDatabase &db, int zoom,
+  const QPoint &tile)
+{
+	QSqlQuery query(db);
+	query.prepare("SELECT tile_data FROM tiles "
+	  "WHERE zoom_level=:zoom AND tile_column=:x AND tile_row=:y");
+	query.bindValue(":zoom", zoom);
+	query.bindValue(":x", tile.x());
+	query.bindValue(":y", (1<<zoom) - tile.y() - 1);
+	query.exec();
+
+	if (query.first())
+		return query.value(0).toByteArray();
+
+	return QByteArray();
+}
+
+/* The prefetch job reads the tiles using its own database connection as the
+   map connection can only be used in the GUI thread. */
+class MBTilesPrefetchJob : public QRunnable
+{
+public:
+	MBTilesPrefetchJob(MBTilesMap *map, const QList<TileCache::Key> &tiles,
+	  int scaledSize, int generation) : _map(map), _tiles(tiles),
+	  _scaledSize(scaledSize), _generation(generation) {}
+
+	void run()
+	{
+		static QAtomicInt id(0);
+		QString name(_map->_fileName + "-prefetch-"
+		  + QString::number(id.fetchAndAddRelaxed(1)));
+
+		{
+			QSqlDatabase db(QSqlDatabase::addDatabase("QSQLITE", name));
+			db.setDatabaseName(_map->_fileName);
+			db.setConnectOptions("QSQLITE_OPEN_READONLY");
+
+			if (db.open()) {
+				for (int i = 0; i < _tiles.size(); i++) {
+					if (!_map->isPrefetchWanted(_generation))
+						break;
+					load(db, _tiles.at(i));
+				}
+				db.close();
+			}
+		}
+
+		QSqlDatabase::removeDatabase(name);
+	}
+
+private:
+	void load(const QSqlDatabase &db, const TileCache::Key &key)
+	{
+		QPoint xy(key.x(), key.y());
+		QByteArray data(tileData(db, key.zoom(), xy));
+		if (data.isNull())
+			return;
+
+		MBTile tile(key.zoom(), _scaledSize, xy, data, key);
+		tile.load();
+
+		QMetaObject::invokeMethod(_map, "prefetchFinished",
+		  Qt::QueuedConnection, Q_ARG(TileCache::Key, key),
+		  Q_ARG(QImage, tile.image()), Q_ARG(int, _generation));
+	}
+
+	MBTilesMap *_map;
+	QList<TileCache::Key> _tiles;
+	int _scaledSize;
+	int _generation;
+};
+
 #define META_TYPE(type) static_cast<QMetaType::Type>(type)
 
 static double index2mercator(int index, int zoom)
@@ -55,9 +130,13 @@ static double index2mercator(int index, int zoom)
 }
 
 MBTilesMap::MBTilesMap(const QString &fileName, QObject *parent)
-  : Map(parent), _fileName(fileName), _mapRatio(1.0), _tileRatio(1.0),
-  _scalable(false), _scaledSize(0), _valid(false)
+  : Map(parent), _fileName(fileName), _id(TileCache::id()), _mapRatio(1.0),
+  _tileRatio(1.0), _scalable(false), _scaledSize(0), _valid(false),
+  _prefetchGeneration(0)
 {
+	qRegisterMetaType<TileCache::Key>("TileCache::Key");
+	_pool.setMaxThreadCount(1);
+
 	_db = QSqlDatabase::addDatabase("QSQLITE", fileName);
 	_db.setDatabaseName(fileName);
 	_db.setConnectOptions("QSQLITE_OPEN_READONLY");
@@ -173,6 +252,12 @@ MBTilesMap::MBTilesMap(const QString &fileName, QObject *parent)
 	_valid = true;
 }
 
+MBTilesMap::~MBTilesMap()
+{
+	cancelPrefetch();
+	_pool.waitForDone();
+}
+
 void MBTilesMap::load()
 {
 	_db.open();
@@ -180,6 +265,9 @@ void MBTilesMap::load()
 
 void MBTilesMap::unload()
 {
+	cancelPrefetch();
+	_pool.waitForDone();
+
 	_db.close();
 }
 
@@ -234,7 +322,10 @@ void MBTilesMap::setDevicePixelRatio(qreal deviceRatio, qreal mapRatio)
 	_mapRatio = mapRatio;
 
 	if (_scalable) {
-		_scaledSize = _tileSize * deviceRatio;
+		int scaledSize = _tileSize * deviceRatio;
+		if (scaledSize != _scaledSize)
+			TileCache::remove(_id);
+		_scaledSize = scaledSize;
 		_tileRatio = deviceRatio;
 	}
 }
@@ -254,22 +345,6 @@ qreal MBTilesMap::tileSize() const
 	return (_tileSize / coordinatesRatio());
 }
 
-QByteArray MBTilesMap::tileData(int zoom, const QPoint &tile) const
-{
-	QSqlQuery query(_db);
-	query.prepare("SELECT tile_data FROM tiles "
-	  "WHERE zoom_level=:zoom AND tile_column=:x AND tile_row=:y");
-	query.bindValue(":zoom", zoom);
-	query.bindValue(":x", tile.x());
-	query.bindValue(":y", (1<<zoom) - tile.y() - 1);
-	query.exec();
-
-	if (query.first())
-		return query.value(0).toByteArray();
-
-	return QByteArray();
-}
-
 void MBTilesMap::draw(QPainter *painter, const QRectF &rect, Flags flags)
 {
 	Q_UNUSED(flags);
@@ -294,17 +369,16 @@ void MBTilesMap::draw(QPainter *painter, const QRectF &rect, Flags flags)
 		for (int j = 0; j < height; j++) {
 			QPixmap pm;
 			QPoint t(tile.x() + i, tile.y() + j);
-			QString key = _fileName + "-" + QString::number(_zoom) + "_"
-			  + QString::number(t.x()) + "_" + QString::number(t.y());
+			TileCache::Key key(_id, _zoom, t);
 
-			if (QPixmapCache::find(key, pm)) {
+			if (TileCache::find(key, pm)) {
 				QPointF tp(qMax(tl.x(), b.left()) + (t.x() - tile.x())
 				  * tileSize(), qMax(tl.y(), b.top()) + (t.y() - tile.y())
 				  * tileSize());
 				drawTile(painter, pm, tp);
 			} else {
-				tiles.append(MBTile(_zoom, _scaledSize, t, tileData(_zoom, t),
-				  key));
+				tiles.append(MBTile(_zoom, _scaledSize, t,
+				  tileData(_db, _zoom, t), key));
 			}
 		}
 	}
@@ -318,7 +392,7 @@ void MBTilesMap::draw(QPainter *painter, const QRectF &rect, Flags flags)
 		if (pm.isNull())
 			continue;
 
-		QPixmapCache::insert(mt.key(), pm);
+		TileCache::insert(mt.key(), pm);
 
 		QPointF tp(qMax(tl.x(), b.left()) + (mt.xy().x() - tile.x())
 		  * tileSize(), qMax(tl.y(), b.top()) + (mt.xy().y() - tile.y())
@@ -327,6 +401,77 @@ void MBTilesMap::draw(QPainter *painter, const QRectF &rect, Flags flags)
 	}
 }
 
+/* Range of the tiles at the given zoom level covering the rect (in the
+   current zoom level image coordinates) */
+QRect MBTilesMap::tileRange(const QRectF &rect, int zoom) const
+{
+	qreal scale = OSM::zoom2scale(_zoom, _tileSize);
+	QPoint tl(OSM::mercator2tile(QPointF(rect.left() * scale, -rect.top()
+	  * scale) * coordinatesRatio(), zoom));
+	QPoint br(OSM::mercator2tile(QPointF(rect.right() * scale, -rect.bottom()
+	  * scale) * coordinatesRatio(), zoom));
+
+	return QRect(tl, br) & QRect(0, 0, 1<<zoom, 1<<zoom);
+}
+
+bool MBTilesMap::isPrefetchWanted(int generation)
+{
+	QMutexLocker locker(&_prefetchLock);
+	return (generation == _prefetchGeneration);
+}
+
+void MBTilesMap::cancelPrefetch()
+{
+	QMutexLocker locker(&_prefetchLock);
+	_prefetchGeneration++;
+}
+
+void MBTilesMap::prefetchFinished(const TileCache::Key &key, const QImage &img,
+  int generation)
+{
+	if (generation == _prefetchGeneration && !img.isNull())
+		TileCache::insert(key, QPixmap::fromImage(img));
+}
+
+/* The tiles are read from the database and decoded by a single background
+   job, so the prefetching never blocks the GUI thread and never competes with
+   draw() for more than one CPU core. */
+void MBTilesMap::prefetch(const QRectF &view, const QRectF &ahead)
+{
+	QList<QPair<int, QRect> > ranges;
+	QList<TileCache::Key> tiles;
+	QRect vr(tileRange(view, _zoom));
+	int max = TileCache::prefetchCount(QSize(_tileSize, _tileSize));
+
+	cancelPrefetch();
+
+	ranges.append(QPair<int, QRect>(_zoom, tileRange(ahead, _zoom)));
+	if (_zoom > _zooms.min())
+		ranges.append(QPair<int, QRect>(_zoom - 1, tileRange(view, _zoom - 1)));
+	if (_zoom < _zooms.max())
+		ranges.append(QPair<int, QRect>(_zoom + 1, tileRange(view, _zoom + 1)));
+
+	for (int n = 0; n < ranges.size(); n++) {
+		int z = ranges.at(n).first;
+		const QRect &r = ranges.at(n).second;
+
+		for (int i = r.left(); i <= r.right() && tiles.size() < max; i++) {
+			for (int j = r.top(); j <= r.bottom() && tiles.size() < max; j++) {
+				if (z == _zoom && vr.contains(i, j))
+					continue;
+
+				TileCache::Key key(_id, z, i, j);
+				if (!TileCache::contains(key))
+					tiles.append(key);
+			}
+		}
+	}
+
+	if (!tiles.isEmpty())
+		_pool.start(new MBTilesPrefetchJob(this, tiles, _scaledSize,
+		  _prefetchGeneration));
+}
+
 void MBTilesMap::drawTile(QPainter *painter, QPixmap &pixmap, QPointF &tp)
 {
 #ifdef ENABLE_HIDPI
@@ -3,13 +3,20 @@
 
 #include <QSqlDatabase>
 #include <QByteArray>
+#include <QImage>
+#include <QMutex>
+#include <QThreadPool>
 #include "common/range.h"
 #include "map.h"
+#include "tilecache.h"
 
 class MBTilesMap : public Map
 {
+	Q_OBJECT
+
 public:
 	MBTilesMap(const QString &fileName, QObject *parent = 0);
+	~MBTilesMap();
 
 	QString name() const {return _name;}
 
@@ -26,6 +33,8 @@ public:
 	Coordinates xy2ll(const QPointF &p);
 
 	void draw(QPainter *painter, const QRectF &rect, Flags flags);
+	void prefetch(const QRectF &view, const QRectF &ahead);
+	void cancelPrefetch();
 
 	void load();
 	void unload();
@@ -34,17 +43,25 @@ public:
 	bool isValid() const {return _valid;}
 	QString errorString() const {return _errorString;}
 
+private slots:
+	void prefetchFinished(const TileCache::Key &key, const QImage &img,
+	  int generation);
+
 private:
+	friend class MBTilesPrefetchJob;
+
 	int limitZoom(int zoom) const;
 	qreal tileSize() const;
 	qreal coordinatesRatio() const;
 	qreal imageRatio() const;
-	QByteArray tileData(int zoom, const QPoint &tile) const;
 	void drawTile(QPainter *painter, QPixmap &pixmap, QPointF &tp);
+	QRect tileRange(const QRectF &rect, int zoom) const;
+	bool isPrefetchWanted(int generation);
 
 	QSqlDatabase _db;
 
 	QString _fileName, _name;
+	quint32 _id;
 	RectC _bounds;
 	Range _zooms;
 	int _zoom;
@@ -55,6 +72,10 @@ private:
 
 	bool _valid;
 	QString _errorString;
+
+	QMutex _prefetchLock;
+	int _prefetchGeneration;
+	QThreadPool _pool;
 };
 
 #endif // MBTILESMAP_H
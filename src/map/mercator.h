@@ -16,6 +16,7 @@ public:
 
 	virtual PointD ll2xy(const Coordinates &c) const;
 	virtual Coordinates xy2ll(const PointD &p) const;
+	virtual void ll2xy(const Coordinates *c, PointD *p, int n) const;
 
 private:
 	double _a, _e;
@@ -5,6 +5,7 @@
 #include "common/programpaths.h"
 #include "downloader.h"
 #include "osm.h"
+#include "tilecache.h"
 #include "onlinemap.h"
 
 
@@ -21,7 +22,9 @@ OnlineMap::OnlineMap(const QString &name, const QString &url,
 	_tileLoader->setUrl(url);
 	_tileLoader->setAuthorization(authorization);
 	_tileLoader->setQuadTiles(quadTiles);
-	connect(_tileLoader, SIGNAL(finished()), this, SIGNAL(tilesLoaded()));
+	connect(_tileLoader, SIGNAL(tileLoaded()), this, SIGNAL(tilesLoaded()));
+	connect(_tileLoader, SIGNAL(seedProgress(int, int, int, int, qint64)),
+	  this, SIGNAL(seedProgress(int, int, int, int, qint64)));
 }
 
 QRectF OnlineMap::bounds()
@@ -95,6 +98,83 @@ qreal OnlineMap::tileSize() const
 	return (_tileSize / coordinatesRatio());
 }
 
+/* Range of the tiles at the given zoom level covering the rect (in the
+   current zoom level image coordinates) */
+QRect OnlineMap::tileRange(const QRectF &rect, int zoom) const
+{
+	qreal scale = OSM::zoom2scale(_zoom, _tileSize);
+	QPoint tl(OSM::mercator2tile(QPointF(rect.left() * scale, -rect.top()
+	  * scale) * coordinatesRatio(), zoom));
+	QPoint br(OSM::mercator2tile(QPointF(rect.right() * scale, -rect.bottom()
+	  * scale) * coordinatesRatio(), zoom));
+
+	return QRect(tl, br) & QRect(0, 0, 1<<zoom, 1<<zoom);
+}
+
+void OnlineMap::appendTiles(QVector<Tile> &list, const QRect &range, int zoom,
+  const QRect &exclude) const
+{
+	int max = 1<<zoom;
+
+	for (int i = range.left(); i <= range.right(); i++)
+		for (int j = range.top(); j <= range.bottom(); j++)
+			if (!exclude.contains(i, j))
+				list.append(Tile(QPoint(i, _invertY ? max - j - 1 : j), zoom));
+}
+
+void OnlineMap::prefetch(const QRectF &view, const QRectF &ahead)
+{
+	QVector<Tile> list;
+	QRect vr(tileRange(view, _zoom));
+
+	appendTiles(list, tileRange(ahead, _zoom), _zoom, vr);
+	if (_zoom > _zooms.min())
+		appendTiles(list, tileRange(view, _zoom - 1), _zoom - 1);
+	if (_zoom < _zooms.max())
+		appendTiles(list, tileRange(view, _zoom + 1), _zoom + 1);
+
+	int max = TileCache::prefetchCount(QSize(_tileSize, _tileSize));
+	if (list.size() > max)
+		list.resize(max);
+
+	QVector<Tile> keep;
+	appendTiles(keep, vr, _zoom);
+	_tileLoader->retainTiles(keep + list);
+	_tileLoader->prefetchTiles(list);
+}
+
+void OnlineMap::cancelPrefetch()
+{
+	_tileLoader->cancelPrefetch();
+}
+
+QRect OnlineMap::seedRange(const RectC &rect, int zoom) const
+{
+	RectC r(rect & _bounds);
+	if (!r.isValid())
+		return QRect();
+
+	QPoint tl(OSM::mercator2tile(OSM::ll2m(r.topLeft()), zoom));
+	QPoint br(OSM::mercator2tile(OSM::ll2m(r.bottomRight()), zoom));
+
+	return QRect(tl, br) & QRect(0, 0, 1<<zoom, 1<<zoom);
+}
+
+void OnlineMap::seed(const RectC &rect, const Range &zooms)
+{
+	QVector<Tile> list;
+
+	for (int z = zooms.min(); z <= zooms.max(); z++)
+		appendTiles(list, seedRange(rect, z), z);
+
+	_tileLoader->seedTiles(list);
+}
+
+void OnlineMap::cancelSeed()
+{
+	_tileLoader->cancelSeed();
+}
+
 void OnlineMap::draw(QPainter *painter, const QRectF &rect, Flags flags)
 {
 	qreal scale = OSM::zoom2scale(_zoom, _tileSize);
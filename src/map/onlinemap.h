@@ -31,6 +31,13 @@ public:
 	Coordinates xy2ll(const QPointF &p);
 
 	void draw(QPainter *painter, const QRectF &rect, Flags flags);
+	void prefetch(const QRectF &view, const QRectF &ahead);
+	void cancelPrefetch();
+
+	Range seedZooms() const {return _zooms;}
+	QRect seedRange(const RectC &rect, int zoom) const;
+	void seed(const RectC &rect, const Range &zooms);
+	void cancelSeed();
 
 	void setDevicePixelRatio(qreal deviceRatio, qreal mapRatio);
 	void clearCache() {_tileLoader->clearCache();}
@@ -40,6 +47,9 @@ private:
 	qreal tileSize() const;
 	qreal coordinatesRatio() const;
 	qreal imageRatio() const;
+	QRect tileRange(const QRectF &rect, int zoom) const;
+	void appendTiles(QVector<Tile> &list, const QRect &range, int zoom,
+	  const QRect &exclude = QRect()) const;
 
 	TileLoader *_tileLoader;
 	QString _name;
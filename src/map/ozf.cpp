@@ -197,7 +197,7 @@ bool OZF::open()
 	return true;
 }
 
-QPixmap OZF::tile(int zoom, int x, int y)
+QByteArray OZF::tile(int zoom, int x, int y)
 {
 	Q_ASSERT(_file.isOpen());
 	Q_ASSERT(0 <= zoom && zoom < _zooms.count());
@@ -206,11 +206,11 @@ QPixmap OZF::tile(int zoom, int x, int y)
 
 	int i = (y/tileSize().height()) * z.dim.width() + (x/tileSize().width());
 	if (i >= z.tiles.size() - 1 || i < 0)
-		return QPixmap();
+		return QByteArray();
 
 	int size = z.tiles.at(i+1) - z.tiles.at(i);
 	if (!_file.seek(z.tiles.at(i)))
-		return QPixmap();
+		return QByteArray();
 
 	quint32 bes = qToBigEndian(tileSize().width() * tileSize().height());
 	QByteArray ba;
@@ -218,16 +218,16 @@ QPixmap OZF::tile(int zoom, int x, int y)
 	memcpy(ba.data(), &bes, sizeof(bes));
 
 	if (!read(ba.data() + sizeof(bes), size, 16))
-		return QPixmap();
-	QByteArray uba = qUncompress(ba);
-	if (uba.size() != tileSize().width() * tileSize().height())
-		return QPixmap();
+		return QByteArray();
 
-	QImage img((const uchar*)uba.constData(), tileSize().width(),
-	  tileSize().height(), QImage::Format_Indexed8);
-	img.setColorTable(z.palette);
+	return ba;
+}
+
+const QVector<QRgb> &OZF::palette(int zoom) const
+{
+	Q_ASSERT(0 <= zoom && zoom < _zooms.count());
 
-	return QPixmap::fromImage(img.mirrored());
+	return _zooms.at(zoom).palette;
 }
 
 QSize OZF::size(int zoom) const
@@ -7,7 +7,8 @@
 #include <QList>
 #include <QVector>
 #include <QFile>
-#include <QPixmap>
+#include <QByteArray>
+#include <QPointF>
 
 class OZF
 {
@@ -24,7 +25,9 @@ public:
 	QSize size(int zoom) const;
 	QPointF scale(int zoom) const;
 	QSize tileSize() const {return QSize(_tileSize, _tileSize);}
-	QPixmap tile(int zoom, int x, int y);
+	const QVector<QRgb> &palette(int zoom) const;
+	/* Compressed tile data in the qUncompress() format */
+	QByteArray tile(int zoom, int x, int y);
 
 	static bool isOZF(const QString &path);
 
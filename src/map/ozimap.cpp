@@ -4,7 +4,6 @@
 #include <QDir>
 #include <QBuffer>
 #include <QImageReader>
-#include <QPixmapCache>
 #include "common/coordinates.h"
 #include "common/rectc.h"
 #include "common/config.h"
@@ -13,11 +12,14 @@
 #include "image.h"
 #include "mapfile.h"
 #include "rectd.h"
+#include "tilecache.h"
+#include "imagetile.h"
 #include "ozimap.h"
 
 
 OziMap::OziMap(const QString &fileName, QObject *parent)
-  : Map(parent), _img(0), _tar(0), _ozf(0), _zoom(0), _mapRatio(1.0), _valid(false)
+  : Map(parent), _img(0), _tar(0), _ozf(0), _id(TileCache::id()), _zoom(0),
+  _mapRatio(1.0), _valid(false)
 {
 	QFileInfo fi(fileName);
 	QString suffix = fi.suffix().toLower();
@@ -79,7 +81,8 @@ OziMap::OziMap(const QString &fileName, QObject *parent)
 }
 
 OziMap::OziMap(const QString &fileName, Tar &tar, QObject *parent)
-  : Map(parent), _img(0), _tar(0), _ozf(0), _zoom(0), _mapRatio(1.0), _valid(false)
+  : Map(parent), _img(0), _tar(0), _ozf(0), _id(TileCache::id()), _zoom(0),
+  _mapRatio(1.0), _valid(false)
 {
 	QFileInfo fi(fileName);
 	QFileInfo map(fi.absolutePath());
@@ -221,40 +224,53 @@ void OziMap::drawTiled(QPainter *painter, const QRectF &rect) const
 	QSizeF ts(_tile.size.width() / _mapRatio, _tile.size.height() / _mapRatio);
 	QPointF tl(floor(rect.left() / ts.width()) * ts.width(),
 	  floor(rect.top() / ts.height()) * ts.height());
+	QList<ImageTile> tiles;
 
 	QSizeF s(rect.right() - tl.x(), rect.bottom() - tl.y());
 	for (int i = 0; i < ceil(s.width() / ts.width()); i++) {
 		for (int j = 0; j < ceil(s.height() / ts.height()); j++) {
 			int x = round(tl.x() * _mapRatio + i * _tile.size.width());
 			int y = round(tl.y() * _mapRatio + j * _tile.size.height());
+			QPointF tp(tl.x() + i * ts.width(), tl.y() + j * ts.height());
 
 			QString tileName(_tile.path.arg(QString::number(x),
 			  QString::number(y)));
 			QPixmap pixmap;
 
 			if (_tar) {
-				QString key = _tar->fileName() + "/" + tileName;
-				if (!QPixmapCache::find(key, &pixmap)) {
-					QByteArray ba = _tar->file(tileName);
-					pixmap = QPixmap::fromImage(QImage::fromData(ba));
-					if (!pixmap.isNull())
-						QPixmapCache::insert(key, pixmap);
+				TileCache::Key key(_id, 0, x, y);
+				if (TileCache::find(key, pixmap))
+					drawTile(painter, pixmap, tp);
+				else {
+					tiles.append(ImageTile(key, tp));
+					tiles.last().setData(_tar->file(tileName));
 				}
-			} else
+			} else {
 				pixmap = QPixmap(tileName);
-
-			if (pixmap.isNull())
-				qWarning("%s: error loading tile image", qPrintable(
-				  _tile.path.arg(QString::number(x), QString::number(y))));
-			else {
-#ifdef ENABLE_HIDPI
-				pixmap.setDevicePixelRatio(_mapRatio);
-#endif // ENABLE_HIDPI
-				QPointF tp(tl.x() + i * ts.width(), tl.y() + j * ts.height());
-				painter->drawPixmap(tp, pixmap);
+				if (pixmap.isNull())
+					qWarning("%s: error loading tile image",
+					  qPrintable(tileName));
+				else
+					drawTile(painter, pixmap, tp);
 			}
 		}
 	}
+
+	ImageTile::decode(tiles);
+
+	for (int i = 0; i < tiles.size(); i++) {
+		const ImageTile &t = tiles.at(i);
+		QPixmap pixmap(t.pixmap());
+
+		if (pixmap.isNull())
+			qWarning("%s: error loading tile image", qPrintable(
+			  _tile.path.arg(QString::number(t.key().x()),
+			  QString::number(t.key().y()))));
+		else {
+			TileCache::insert(t.key(), pixmap);
+			drawTile(painter, pixmap, t.pos());
+		}
+	}
 }
 
 void OziMap::drawOZF(QPainter *painter, const QRectF &rect) const
@@ -263,33 +279,50 @@ void OziMap::drawOZF(QPainter *painter, const QRectF &rect) const
 	  / _mapRatio);
 	QPointF tl(floor(rect.left() / ts.width()) * ts.width(),
 	  floor(rect.top() / ts.height()) * ts.height());
+	QList<ImageTile> tiles;
 
 	QSizeF s(rect.right() - tl.x(), rect.bottom() - tl.y());
 	for (int i = 0; i < ceil(s.width() / ts.width()); i++) {
 		for (int j = 0; j < ceil(s.height() / ts.height()); j++) {
 			int x = round(tl.x() * _mapRatio + i * _ozf->tileSize().width());
 			int y = round(tl.y() * _mapRatio + j * _ozf->tileSize().height());
+			QPointF tp(tl.x() + i * ts.width(), tl.y() + j * ts.height());
 
 			QPixmap pixmap;
-			QString key = _ozf->fileName() + "/" + QString::number(_zoom) + "_"
-			  + QString::number(x) + "_" + QString::number(y);
-			if (!QPixmapCache::find(key, &pixmap)) {
-				pixmap = _ozf->tile(_zoom, x, y);
-				if (!pixmap.isNull())
-					QPixmapCache::insert(key, pixmap);
-			}
-
-			if (pixmap.isNull())
-				qWarning("%s: error loading tile image", qPrintable(key));
+			TileCache::Key key(_id, _zoom, x, y);
+			if (TileCache::find(key, pixmap))
+				drawTile(painter, pixmap, tp);
 			else {
-#ifdef ENABLE_HIDPI
-				pixmap.setDevicePixelRatio(_mapRatio);
-#endif // ENABLE_HIDPI
-				QPointF tp(tl.x() + i * ts.width(), tl.y() + j * ts.height());
-				painter->drawPixmap(tp, pixmap);
+				tiles.append(ImageTile(key, tp));
+				tiles.last().setData(_ozf->tile(_zoom, x, y),
+				  _ozf->tileSize(), _ozf->palette(_zoom), true);
 			}
 		}
 	}
+
+	ImageTile::decode(tiles);
+
+	for (int i = 0; i < tiles.size(); i++) {
+		const ImageTile &t = tiles.at(i);
+		QPixmap pixmap(t.pixmap());
+
+		if (pixmap.isNull())
+			qWarning("%s: %d_%d_%d: error loading tile image",
+			  qPrintable(_ozf->fileName()), _zoom, t.key().x(), t.key().y());
+		else {
+			TileCache::insert(t.key(), pixmap);
+			drawTile(painter, pixmap, t.pos());
+		}
+	}
+}
+
+void OziMap::drawTile(QPainter *painter, QPixmap &pixmap,
+  const QPointF &tp) const
+{
+#ifdef ENABLE_HIDPI
+	pixmap.setDevicePixelRatio(_mapRatio);
+#endif // ENABLE_HIDPI
+	painter->drawPixmap(tp, pixmap);
 }
 
 void OziMap::draw(QPainter *painter, const QRectF &rect, Flags flags)
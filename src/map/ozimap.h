@@ -5,6 +5,7 @@
 #include "projection.h"
 #include "map.h"
 
+class QPixmap;
 class Tar;
 class OZF;
 class Image;
@@ -60,6 +61,7 @@ private:
 
 	void drawTiled(QPainter *painter, const QRectF &rect) const;
 	void drawOZF(QPainter *painter, const QRectF &rect) const;
+	void drawTile(QPainter *painter, QPixmap &pixmap, const QPointF &tp) const;
 	void drawImage(QPainter *painter, const QRectF &rect, Flags flags) const;
 
 	void rescale(int zoom);
@@ -70,6 +72,7 @@ private:
 	Image *_img;
 	Tar *_tar;
 	OZF *_ozf;
+	quint32 _id;
 	ImageInfo _map, _tile;
 	int _zoom;
 	QPointF _scale;
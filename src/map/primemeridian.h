@@ -12,6 +12,7 @@ public:
 
 	bool isNull() const {return std::isnan(_pm);}
 	bool isValid() const {return !std::isnan(_pm);}
+	bool isGreenwich() const {return (_pm == 0.0);}
 
 	double toGreenwich(double val) const;
 	double fromGreenwich(double val) const;
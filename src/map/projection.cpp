@@ -1,3 +1,4 @@
+#include <QVector>
 #include "datum.h"
 #include "mercator.h"
 #include "webmercator.h"
@@ -165,6 +166,23 @@ PointD Projection::ll2xy(const Coordinates &c) const
 	return _units.fromMeters(_ct->ll2xy(_gcs->fromWGS84(c)));
 }
 
+/* The WGS84 datum (the most common case by far) needs no datum conversion
+   and thus no temporary buffer. */
+void Projection::ll2xy(const Coordinates *c, PointD *p, int n) const
+{
+	Q_ASSERT(isValid());
+
+	if (_gcs->isWGS84())
+		_ct->ll2xy(c, p, n);
+	else {
+		QVector<Coordinates> ds(n);
+		_gcs->fromWGS84(c, ds.data(), n);
+		_ct->ll2xy(ds.constData(), p, n);
+	}
+
+	_units.fromMeters(p, n);
+}
+
 Coordinates Projection::xy2ll(const PointD &p) const
 {
 	Q_ASSERT(isValid());
@@ -86,6 +86,7 @@ public:
 
 	PointD ll2xy(const Coordinates &c) const;
 	Coordinates xy2ll(const PointD &p) const;
+	void ll2xy(const Coordinates *c, PointD *p, int n) const;
 
 	const LinearUnits &units() const {return _units;}
 	const CoordinateSystem &coordinateSystem() const {return _cs;}
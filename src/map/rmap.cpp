@@ -1,6 +1,5 @@
 #include <QFileInfo>
 #include <QDataStream>
-#include <QPixmapCache>
 #include <QPainter>
 #include <QRegExp>
 #include <QtEndian>
@@ -12,6 +11,8 @@
 #include "pcs.h"
 #include "rectd.h"
 #include "color.h"
+#include "tilecache.h"
+#include "imagetile.h"
 #include "rmap.h"
 
 
@@ -161,7 +162,8 @@ bool RMap::parseIMP(const QByteArray &data)
 }
 
 RMap::RMap(const QString &fileName, QObject *parent)
-  : Map(parent), _mapRatio(1.0), _fileName(fileName), _zoom(0), _valid(false)
+  : Map(parent), _mapRatio(1.0), _fileName(fileName), _id(TileCache::id()),
+  _zoom(0), _valid(false)
 {
 	QFile file(fileName);
 	if (!file.open(QIODevice::ReadOnly)) {
@@ -324,28 +326,28 @@ void RMap::unload()
 	_file.close();
 }
 
-QPixmap RMap::tile(int x, int y)
+void RMap::tile(int x, int y, ImageTile &tile)
 {
 	const Zoom &zoom = _zooms.at(_zoom);
 
 	qint32 index = y / _tileSize.height() * zoom.dim.width()
 	  + x / _tileSize.width();
 	if (index > zoom.tiles.size())
-		return QPixmap();
+		return;
 
 	quint64 offset = zoom.tiles.at(index);
 	if (!_file.seek(offset))
-		return QPixmap();
+		return;
 	QDataStream stream(&_file);
 	stream.setByteOrder(QDataStream::LittleEndian);
 	quint32 tag;
 	stream >> tag;
 	if (stream.status() != QDataStream::Ok)
-		return QPixmap();
+		return;
 
 	if (tag == 2) {
 		if (_palette.isEmpty())
-			return QPixmap();
+			return;
 		quint32 width, height, size;
 		stream >> width >> height >> size;
 		QSize tileSize(width, -(int)height);
@@ -356,15 +358,8 @@ QPixmap RMap::tile(int x, int y)
 		memcpy(ba.data(), &bes, sizeof(bes));
 
 		if (stream.readRawData(ba.data() + sizeof(bes), size) != (int)size)
-			return QPixmap();
-		QByteArray uba = qUncompress(ba);
-		if (uba.size() < tileSize.width() * tileSize.height())
-			return QPixmap();
-		QImage img((const uchar*)uba.constData(), tileSize.width(),
-		  tileSize.height(), QImage::Format_Indexed8);
-		img.setColorTable(_palette);
-
-		return QPixmap::fromImage(img);
+			return;
+		tile.setData(ba, tileSize, _palette);
 	} else if (tag == 7) {
 		quint32 len;
 		stream >> len;
@@ -372,12 +367,9 @@ QPixmap RMap::tile(int x, int y)
 		QByteArray ba;
 		ba.resize(len);
 		if (stream.readRawData(ba.data(), ba.size()) != ba.size())
-			return QPixmap();
-
-		QImage img(QImage::fromData(ba));
-		return QPixmap::fromImage(img);
-	} else
-		return QPixmap();
+			return;
+		tile.setData(ba);
+	}
 }
 
 void RMap::draw(QPainter *painter, const QRectF &rect, Flags flags)
@@ -387,33 +379,48 @@ void RMap::draw(QPainter *painter, const QRectF &rect, Flags flags)
 	QSizeF ts(_tileSize.width() / _mapRatio, _tileSize.height() / _mapRatio);
 	QPointF tl(floor(rect.left() / ts.width()) * ts.width(),
 	  floor(rect.top() / ts.height()) * ts.height());
+	QList<ImageTile> tiles;
 
 	QSizeF s(rect.right() - tl.x(), rect.bottom() - tl.y());
 	for (int i = 0; i < ceil(s.width() / ts.width()); i++) {
 		for (int j = 0; j < ceil(s.height() / ts.height()); j++) {
 			int x = round(tl.x() * _mapRatio + i * _tileSize.width());
 			int y = round(tl.y() * _mapRatio + j * _tileSize.height());
+			QPointF tp(tl.x() + i * ts.width(), tl.y() + j * ts.height());
 
 			QPixmap pixmap;
-			QString key = _fileName + "/" + QString::number(_zoom) + "_"
-			  + QString::number(x) + "_" + QString::number(y);
-			if (!QPixmapCache::find(key, &pixmap)) {
-				pixmap = tile(x, y);
-				if (!pixmap.isNull())
-					QPixmapCache::insert(key, pixmap);
-			}
-
-			if (pixmap.isNull())
-				qWarning("%s: error loading tile image", qPrintable(key));
+			TileCache::Key key(_id, _zoom, x, y);
+			if (TileCache::find(key, pixmap))
+				drawTile(painter, pixmap, tp);
 			else {
-#ifdef ENABLE_HIDPI
-				pixmap.setDevicePixelRatio(_mapRatio);
-#endif // ENABLE_HIDPI
-				QPointF tp(tl.x() + i * ts.width(), tl.y() + j * ts.height());
-				painter->drawPixmap(tp, pixmap);
+				tiles.append(ImageTile(key, tp));
+				tile(x, y, tiles.last());
 			}
 		}
 	}
+
+	ImageTile::decode(tiles);
+
+	for (int i = 0; i < tiles.size(); i++) {
+		const ImageTile &t = tiles.at(i);
+		QPixmap pixmap(t.pixmap());
+
+		if (pixmap.isNull())
+			qWarning("%s: %d_%d_%d: error loading tile image",
+			  qPrintable(_fileName), _zoom, t.key().x(), t.key().y());
+		else {
+			TileCache::insert(t.key(), pixmap);
+			drawTile(painter, pixmap, t.pos());
+		}
+	}
+}
+
+void RMap::drawTile(QPainter *painter, QPixmap &pixmap, const QPointF &tp)
+{
+#ifdef ENABLE_HIDPI
+	pixmap.setDevicePixelRatio(_mapRatio);
+#endif // ENABLE_HIDPI
+	painter->drawPixmap(tp, pixmap);
 }
 
 void RMap::setDevicePixelRatio(qreal deviceRatio, qreal mapRatio)
@@ -7,6 +7,9 @@
 #include "transform.h"
 #include "projection.h"
 
+class QPixmap;
+class ImageTile;
+
 class RMap : public Map
 {
 	Q_OBJECT
@@ -45,7 +48,8 @@ private:
 	};
 
 	bool parseIMP(const QByteArray &data);
-	QPixmap tile(int x, int y);
+	void tile(int x, int y, ImageTile &tile);
+	void drawTile(QPainter *painter, QPixmap &pixmap, const QPointF &tp);
 
 	QList<Zoom> _zooms;
 	Projection _projection;
@@ -54,6 +58,7 @@ private:
 	QFile _file;
 	qreal _mapRatio;
 	QString _fileName;
+	quint32 _id;
 	int _zoom;
 	QVector<QRgb> _palette;
 
@@ -0,0 +1,695 @@
+#include <QtGlobal>
+#if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
+#include <QtCore>
+#else // QT_VERSION < 5
+#include <QtConcurrent>
+#endif // QT_VERSION < 5
+#include <QtEndian>
+#include "common/tifffile.h"
+#include "tiffimage.h"
+
+
+#define NewSubfileType            254
+#define ImageWidth                256
+#define ImageLength               257
+#define BitsPerSample             258
+#define Compression               259
+#define PhotometricInterpretation 262
+#define StripOffsets              273
+#define SamplesPerPixel           277
+#define RowsPerStrip              278
+#define StripByteCounts           279
+#define PlanarConfiguration       284
+#define Predictor                 317
+#define ColorMap                  320
+#define TileWidth                 322
+#define TileLength                323
+#define TileOffsets               324
+#define TileByteCounts            325
+#define ExtraSamples              338
+#define SampleFormat              339
+#define JPEGTables                347
+
+#define COMPRESSION_NONE          1
+#define COMPRESSION_LZW           5
+#define COMPRESSION_JPEG          7
+#define COMPRESSION_DEFLATE       8
+#define COMPRESSION_PACKBITS      32773
+#define COMPRESSION_ADOBE_DEFLATE 32946
+
+#define PHOTOMETRIC_MINISWHITE    0
+#define PHOTOMETRIC_MINISBLACK    1
+#define PHOTOMETRIC_RGB           2
+#define PHOTOMETRIC_PALETTE       3
+#define PHOTOMETRIC_YCBCR         6
+
+#define TILE_SIZE        256
+#define MAX_BLOCK_PIXELS (4096 * 4096)
+#define MAX_IFDS         64
+#define MAX_VALUES       0x1000000
+
+#define LZW_CLEAR 256
+#define LZW_EOI   257
+
+
+static QByteArray lzw(const QByteArray &data, int size)
+{
+	quint16 prefix[4096], length[4096];
+	uchar suffix[4096], first[4096];
+	const uchar *in = (const uchar*)data.constData();
+	int inSize = data.size(), pos = 0, bits = 0;
+	quint32 buffer = 0;
+	int codeLen = 9, next = LZW_EOI + 1, old = -1, o = 0;
+
+	for (int i = 0; i < 256; i++) {
+		prefix[i] = 0;
+		suffix[i] = i;
+		first[i] = i;
+		length[i] = 1;
+	}
+
+	QByteArray out(size, 0);
+	uchar *dst = (uchar*)out.data();
+
+	while (o < size) {
+		while (bits < codeLen) {
+			if (pos >= inSize)
+				return out.left(o);
+			buffer = (buffer << 8) | in[pos++];
+			bits += 8;
+		}
+		int code = (buffer >> (bits - codeLen)) & ((1 << codeLen) - 1);
+		bits -= codeLen;
+
+		if (code == LZW_EOI)
+			break;
+		if (code == LZW_CLEAR) {
+			codeLen = 9;
+			next = LZW_EOI + 1;
+			old = -1;
+			continue;
+		}
+
+		if (old < 0) {
+			if (code > 255)
+				return QByteArray();
+			dst[o++] = code;
+			old = code;
+			continue;
+		}
+		if (code > next)
+			return QByteArray();
+
+		if (next < 4096) {
+			prefix[next] = old;
+			suffix[next] = (code < next) ? first[code] : first[old];
+			first[next] = first[old];
+			length[next] = length[old] + 1;
+			next++;
+		}
+
+		int p = code;
+		for (int k = length[code] - 1; k >= 0; k--) {
+			if (o + k < size)
+				dst[o + k] = suffix[p];
+			p = prefix[p];
+		}
+		o += length[code];
+		old = code;
+
+		// TIFF LZW switches the code length one code earlier
+		if (next >= (1 << codeLen) - 1 && codeLen < 12)
+			codeLen++;
+	}
+
+	return (o < size) ? out.left(o) : out;
+}
+
+static QByteArray inflate(const QByteArray &data, int size)
+{
+	quint32 bes = qToBigEndian((quint32)size);
+	QByteArray ba;
+
+	ba.resize(sizeof(bes) + data.size());
+	memcpy(ba.data(), &bes, sizeof(bes));
+	memcpy(ba.data() + sizeof(bes), data.constData(), data.size());
+
+	return qUncompress(ba);
+}
+
+static QByteArray packBits(const QByteArray &data, int size)
+{
+	const char *in = data.constData();
+	int n = data.size();
+	QByteArray out;
+
+	out.reserve(size);
+	for (int i = 0; i < n && out.size() < size; ) {
+		int c = (signed char)in[i++];
+		if (c >= 0) {
+			int len = qMin(c + 1, n - i);
+			out.append(in + i, len);
+			i += len;
+		} else if (c != -128) {
+			if (i >= n)
+				break;
+			out.append(QByteArray(1 - c, in[i++]));
+		}
+	}
+
+	return out;
+}
+
+static QByteArray jpeg(const QByteArray &tables, const QByteArray &data)
+{
+	// Abbreviated JPEG stream, merge it with the (SOI..EOI) tables stream
+	if (tables.size() < 4 || data.size() < 2)
+		return data;
+	return tables.left(tables.size() - 2) + data.mid(2);
+}
+
+
+QImage TIFFImage::Job::decode(const QByteArray &data, const QSize &size) const
+{
+	const Level &l = *_level;
+
+	if (l.compression == COMPRESSION_JPEG)
+		return QImage::fromData(jpeg(l.jpegTables, data), "JPEG");
+
+	int bpl = size.width() * l.samples;
+	int n = bpl * size.height();
+	QByteArray raw;
+
+	switch (l.compression) {
+		case COMPRESSION_NONE:
+			raw = data;
+			break;
+		case COMPRESSION_LZW:
+			raw = lzw(data, n);
+			break;
+		case COMPRESSION_DEFLATE:
+		case COMPRESSION_ADOBE_DEFLATE:
+			raw = inflate(data, n);
+			break;
+		case COMPRESSION_PACKBITS:
+			raw = packBits(data, n);
+			break;
+	}
+	if (raw.size() < n)
+		return QImage();
+
+	uchar *bits = (uchar*)raw.data();
+	if (l.predictor == 2) {
+		for (int y = 0; y < size.height(); y++) {
+			uchar *row = bits + y * bpl;
+			for (int x = l.samples; x < bpl; x++)
+				row[x] += row[x - l.samples];
+		}
+	}
+
+	if (l.samples == 1) {
+		QImage img(bits, size.width(), size.height(), bpl,
+		  QImage::Format_Indexed8);
+		img.setColorTable(l.palette);
+		return img.copy();
+	} else if (l.samples == 3)
+		return QImage(bits, size.width(), size.height(), bpl,
+		  QImage::Format_RGB888).copy();
+	else {
+		QImage img(size, l.alpha == 1 ? QImage::Format_ARGB32_Premultiplied
+		  : l.alpha == 2 ? QImage::Format_ARGB32 : QImage::Format_RGB32);
+		for (int y = 0; y < size.height(); y++) {
+			const uchar *src = bits + y * bpl;
+			QRgb *dst = (QRgb*)img.scanLine(y);
+			for (int x = 0; x < size.width(); x++, src += 4)
+				dst[x] = qRgba(src[0], src[1], src[2], l.alpha ? src[3] : 0xFF);
+		}
+		return img;
+	}
+}
+
+void TIFFImage::Job::load()
+{
+	for (int i = 0; i < _rects.size(); i++)
+		_images.append(QImage());
+
+	for (int i = 0; i < _blocks.size(); i++) {
+		QImage img(decode(_data.at(i), _blocks.at(i).size()));
+		_data[i] = QByteArray();
+		if (img.isNull())
+			continue;
+
+		QRect br(QRect(_blocks.at(i).topLeft(), img.size()) & _blocks.at(i));
+		int bpp = img.depth() / 8;
+
+		for (int j = 0; j < _rects.size(); j++) {
+			const QRect &tr = _rects.at(j);
+			QRect ir(tr & br);
+			if (ir.isEmpty())
+				continue;
+
+			QImage &ti = _images[j];
+			if (ti.isNull()) {
+				ti = QImage(tr.size(), img.format());
+				ti.setColorTable(img.colorTable());
+				ti.fill(0);
+			}
+			if (ti.format() != img.format())
+				continue;
+
+			for (int y = ir.top(); y <= ir.bottom(); y++)
+				memcpy(ti.scanLine(y - tr.top()) + (ir.left() - tr.left()) * bpp,
+				  img.constScanLine(y - br.top()) + (ir.left() - br.left()) * bpp,
+				  ir.width() * bpp);
+		}
+	}
+}
+
+
+bool TIFFImage::readIFD(TIFFFile &file, quint32 &offset,
+  QMap<quint16, IFDEntry> &entries) const
+{
+	quint16 count;
+
+	if (!file.seek(offset))
+		return false;
+	if (!file.readValue(count))
+		return false;
+
+	for (quint16 i = 0; i < count; i++) {
+		IFDEntry entry;
+		quint16 tag;
+
+		if (!file.readValue(tag))
+			return false;
+		if (!file.readValue(entry.type))
+			return false;
+		if (!file.readValue(entry.count))
+			return false;
+		entry.pos = file.pos();
+		if (!file.readValue(entry.offset))
+			return false;
+
+		entries.insert(tag, entry);
+	}
+
+	return file.readValue(offset);
+}
+
+bool TIFFImage::readValues(TIFFFile &file, const IFDEntry &entry,
+  QVector<quint32> &values) const
+{
+	quint32 size;
+
+	switch (entry.type) {
+		case TIFF_BYTE:
+		case TIFF_UNDEFINED:
+			size = 1;
+			break;
+		case TIFF_SHORT:
+			size = 2;
+			break;
+		case TIFF_LONG:
+			size = 4;
+			break;
+		default:
+			return false;
+	}
+	if (entry.count > MAX_VALUES)
+		return false;
+	if (!file.seek(entry.count * size > 4 ? entry.offset : entry.pos))
+		return false;
+
+	values.resize(entry.count);
+	for (quint32 i = 0; i < entry.count; i++) {
+		if (size == 1) {
+			quint8 val;
+			if (!file.readValue(val))
+				return false;
+			values[i] = val;
+		} else if (size == 2) {
+			quint16 val;
+			if (!file.readValue(val))
+				return false;
+			values[i] = val;
+		} else {
+			if (!file.readValue(values[i]))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+bool TIFFImage::readValue(TIFFFile &file,
+  const QMap<quint16, IFDEntry> &entries, quint16 tag, quint32 &value) const
+{
+	QMap<quint16, IFDEntry>::const_iterator it = entries.find(tag);
+	if (it == entries.constEnd())
+		return true;
+
+	QVector<quint32> values;
+	if (!readValues(file, *it, values) || values.isEmpty())
+		return false;
+	value = values.first();
+
+	return true;
+}
+
+bool TIFFImage::readLevel(TIFFFile &file,
+  const QMap<quint16, IFDEntry> &entries, Level &level,
+  QString &errorString) const
+{
+	quint32 width = 0, height = 0, compression = COMPRESSION_NONE,
+	  photometric = PHOTOMETRIC_MINISBLACK, samples = 1, planar = 1,
+	  predictor = 1, rps = 0xFFFFFFFF, tw = 0, th = 0;
+	QVector<quint32> bits, format, extra;
+
+	if (!(readValue(file, entries, ImageWidth, width)
+	  && readValue(file, entries, ImageLength, height)
+	  && readValue(file, entries, Compression, compression)
+	  && readValue(file, entries, PhotometricInterpretation, photometric)
+	  && readValue(file, entries, SamplesPerPixel, samples)
+	  && readValue(file, entries, PlanarConfiguration, planar)
+	  && readValue(file, entries, Predictor, predictor)
+	  && readValue(file, entries, RowsPerStrip, rps)
+	  && readValue(file, entries, TileWidth, tw)
+	  && readValue(file, entries, TileLength, th))) {
+		errorString = "Error reading TIFF tags";
+		return false;
+	}
+	if (entries.contains(BitsPerSample)) {
+		if (!readValues(file, entries.value(BitsPerSample), bits)) {
+			errorString = "Error reading bits per sample";
+			return false;
+		}
+	} else // TIFF default, unsupported
+		bits.append(1);
+	if (entries.contains(SampleFormat)
+	  && !readValues(file, entries.value(SampleFormat), format)) {
+		errorString = "Error reading sample format";
+		return false;
+	}
+	if (entries.contains(ExtraSamples)
+	  && !readValues(file, entries.value(ExtraSamples), extra)) {
+		errorString = "Error reading extra samples";
+		return false;
+	}
+
+	if (!width || !height || width > 0x7FFFFFFF / 4
+	  || height > 0x7FFFFFFF) {
+		errorString = "Invalid image size";
+		return false;
+	}
+	if (samples != 1 && samples != 3 && samples != 4) {
+		errorString = QString("%1 samples per pixel not supported")
+		  .arg(samples);
+		return false;
+	}
+	for (int i = 0; i < bits.size(); i++) {
+		if (bits.at(i) != 8) {
+			errorString = QString("%1 bit samples not supported")
+			  .arg(bits.at(i));
+			return false;
+		}
+	}
+	for (int i = 0; i < format.size(); i++) {
+		if (format.at(i) != 1) {
+			errorString = "Non-integer samples not supported";
+			return false;
+		}
+	}
+	if (samples > 1 && planar != 1) {
+		errorString = "Planar images not supported";
+		return false;
+	}
+	if (!(compression == COMPRESSION_NONE || compression == COMPRESSION_LZW
+	  || compression == COMPRESSION_JPEG || compression == COMPRESSION_DEFLATE
+	  || compression == COMPRESSION_ADOBE_DEFLATE
+	  || compression == COMPRESSION_PACKBITS)) {
+		errorString = QString("%1: unsupported compression").arg(compression);
+		return false;
+	}
+	if (compression == COMPRESSION_JPEG && samples == 4) {
+		errorString = "4 sample JPEG images not supported";
+		return false;
+	}
+	if (predictor != 1 && !(predictor == 2 && compression != COMPRESSION_JPEG)) {
+		errorString = QString("%1: unsupported predictor").arg(predictor);
+		return false;
+	}
+	if (samples == 1 ? (photometric != PHOTOMETRIC_MINISWHITE
+	  && photometric != PHOTOMETRIC_MINISBLACK
+	  && photometric != PHOTOMETRIC_PALETTE)
+	  : (photometric != PHOTOMETRIC_RGB && !(photometric == PHOTOMETRIC_YCBCR
+	  && compression == COMPRESSION_JPEG))) {
+		errorString = QString("%1: unsupported photometric interpretation")
+		  .arg(photometric);
+		return false;
+	}
+
+	level.size = QSize(width, height);
+	level.compression = compression;
+	level.photometric = photometric;
+	level.predictor = predictor;
+	level.samples = samples;
+	level.alpha = (samples == 4 && !extra.isEmpty()) ? extra.first() : 0;
+
+	if (samples == 1) {
+		level.palette.resize(256);
+		if (photometric == PHOTOMETRIC_PALETTE) {
+			QVector<quint32> cm;
+			if (!entries.contains(ColorMap)
+			  || !readValues(file, entries.value(ColorMap), cm)
+			  || cm.size() != 3 * 256) {
+				errorString = "Error reading color map";
+				return false;
+			}
+			for (int i = 0; i < 256; i++)
+				level.palette[i] = qRgb(cm.at(i) >> 8, cm.at(256 + i) >> 8,
+				  cm.at(512 + i) >> 8);
+		} else {
+			for (int i = 0; i < 256; i++) {
+				int g = (photometric == PHOTOMETRIC_MINISWHITE) ? 255 - i : i;
+				level.palette[i] = qRgb(g, g, g);
+			}
+		}
+	}
+
+	if (compression == COMPRESSION_JPEG && entries.contains(JPEGTables)) {
+		const IFDEntry &e = entries.value(JPEGTables);
+		if (e.count > MAX_VALUES
+		  || !file.seek(e.count > 4 ? e.offset : e.pos)) {
+			errorString = "Error reading JPEG tables";
+			return false;
+		}
+		level.jpegTables = file.read(e.count);
+	}
+
+	QVector<quint32> offsets, counts;
+	int blocks;
+	if (entries.contains(TileOffsets)) {
+		if (!tw || !th || tw % 16 || th % 16) {
+			errorString = "Invalid tile size";
+			return false;
+		}
+		if (!(readValues(file, entries.value(TileOffsets), offsets)
+		  && entries.contains(TileByteCounts)
+		  && readValues(file, entries.value(TileByteCounts), counts))) {
+			errorString = "Error reading tile offsets";
+			return false;
+		}
+		level.tiled = true;
+		level.blockSize = QSize(tw, th);
+		blocks = ((width + tw - 1) / tw) * ((height + th - 1) / th);
+	} else {
+		if (!(entries.contains(StripOffsets)
+		  && readValues(file, entries.value(StripOffsets), offsets)
+		  && entries.contains(StripByteCounts)
+		  && readValues(file, entries.value(StripByteCounts), counts))) {
+			errorString = "Error reading strip offsets";
+			return false;
+		}
+		rps = qMin(qMax(rps, 1U), height);
+		level.blockSize = QSize(width, rps);
+		blocks = (height + rps - 1) / rps;
+	}
+	if (offsets.size() != blocks || counts.size() != blocks) {
+		errorString = "Invalid number of image blocks";
+		return false;
+	}
+
+	/* Uncompressed strips can be read by parts, so large strips are split to
+	   (equally sized) sub-strips of at most TILE_SIZE rows. */
+	if (!level.tiled && compression == COMPRESSION_NONE && rps > TILE_SIZE) {
+		quint32 bpl = width * samples;
+		quint32 d;
+
+		if (blocks == 1)
+			d = TILE_SIZE;
+		else
+			for (d = TILE_SIZE; d > 1; d--)
+				if (rps % d == 0)
+					break;
+
+		level.offsets.clear();
+		level.counts.clear();
+		for (int i = 0; i < blocks; i++) {
+			quint32 rows = qMin(rps, height - i * rps);
+			for (quint32 r = 0; r < rows; r += d) {
+				level.offsets.append(offsets.at(i) + r * bpl);
+				level.counts.append(qMin(d, rows - r) * bpl);
+			}
+		}
+		level.blockSize.setHeight(d);
+	} else {
+		level.offsets = offsets;
+		level.counts = counts;
+	}
+
+	if ((qint64)level.blockSize.width() * level.blockSize.height()
+	  > MAX_BLOCK_PIXELS) {
+		errorString = "Image blocks too large";
+		return false;
+	}
+
+	return true;
+}
+
+TIFFImage::TIFFImage(const QString &fileName) : _file(fileName)
+{
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly)) {
+		_errorString = file.errorString();
+		return;
+	}
+
+	TIFFFile tiff(&file);
+	if (!tiff.isValid()) {
+		_errorString = "Not a TIFF file";
+		return;
+	}
+
+	QList<Level> levels;
+	quint32 ifd = tiff.ifd();
+	for (int i = 0; ifd && i < MAX_IFDS; i++) {
+		QMap<quint16, IFDEntry> entries;
+		quint32 type = 0;
+
+		if (!readIFD(tiff, ifd, entries)
+		  || !readValue(tiff, entries, NewSubfileType, type)) {
+			_errorString = "Invalid IFD";
+			return;
+		}
+
+		if (levels.isEmpty()) {
+			Level level;
+			if (!readLevel(tiff, entries, level, _errorString))
+				return;
+			levels.append(level);
+		// Reduced resolution images that are not transparency masks
+		} else if ((type & 5) == 1) {
+			Level level;
+			QString err;
+			if (readLevel(tiff, entries, level, err)
+			  && level.size.width() < levels.last().size.width()
+			  && level.size.height() < levels.last().size.height())
+				levels.append(level);
+		}
+	}
+
+	_levels = levels;
+}
+
+QSize TIFFImage::tileSize(int level) const
+{
+	const Level &l = _levels.at(level);
+
+	if (l.tiled)
+		return l.blockSize;
+	else {
+		int h = l.blockSize.height();
+		return QSize(qMin(TILE_SIZE, l.size.width()),
+		  ((TILE_SIZE + h - 1) / h) * h);
+	}
+}
+
+QRect TIFFImage::blockRect(const Level &level, int block) const
+{
+	const QSize &bs = level.blockSize;
+
+	if (level.tiled) {
+		int across = (level.size.width() + bs.width() - 1) / bs.width();
+		return QRect(QPoint((block % across) * bs.width(),
+		  (block / across) * bs.height()), bs);
+	} else
+		return QRect(0, block * bs.height(), bs.width(),
+		  qMin(bs.height(), level.size.height() - block * bs.height()));
+}
+
+void TIFFImage::readBlock(const Level &level, int block, Job &job)
+{
+	QByteArray data;
+
+	if (block < 0 || block >= level.offsets.size())
+		return;
+	if (_file.seek(level.offsets.at(block)))
+		data = _file.read(level.counts.at(block));
+
+	job._blocks.append(blockRect(level, block));
+	job._data.append(data);
+}
+
+void TIFFImage::load(int level, QList<Tile> &tiles)
+{
+	const Level &l = _levels.at(level);
+	const QSize &bs = l.blockSize;
+	QRect bounds(QPoint(0, 0), l.size);
+	QMap<int, int> rows;
+	QList<Job> jobs;
+
+	for (int i = 0; i < tiles.size(); i++) {
+		QRect rect(tiles.at(i)._rect & bounds);
+		int index;
+
+		if (rect.isEmpty())
+			continue;
+
+		if (l.tiled) {
+			int across = (l.size.width() + bs.width() - 1) / bs.width();
+			jobs.append(Job(&l));
+			index = jobs.size() - 1;
+			readBlock(l, rect.top() / bs.height() * across
+			  + rect.left() / bs.width(), jobs.last());
+		} else {
+			/* All the tiles of a tile row share the same strips, so they are
+			   decoded in a single job */
+			QMap<int, int>::const_iterator it = rows.find(rect.top());
+			if (it == rows.constEnd()) {
+				jobs.append(Job(&l));
+				index = jobs.size() - 1;
+				rows.insert(rect.top(), index);
+				for (int b = rect.top() / bs.height();
+				  b <= rect.bottom() / bs.height(); b++)
+					readBlock(l, b, jobs.last());
+			} else
+				index = *it;
+		}
+
+		jobs[index]._tiles.append(i);
+		jobs[index]._rects.append(rect);
+	}
+
+	if (jobs.size() == 1)
+		jobs.first().load();
+	else if (jobs.size() > 1) {
+		QFuture<void> future = QtConcurrent::map(jobs, &Job::load);
+		future.waitForFinished();
+	}
+
+	for (int i = 0; i < jobs.size(); i++) {
+		const Job &job = jobs.at(i);
+		for (int j = 0; j < job._tiles.size(); j++)
+			tiles[job._tiles.at(j)]._image = job._images.at(j);
+	}
+}
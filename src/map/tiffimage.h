@@ -0,0 +1,123 @@
+#ifndef TIFFIMAGE_H
+#define TIFFIMAGE_H
+
+#include <QFile>
+#include <QMap>
+#include <QImage>
+#include <QPixmap>
+#include <QVector>
+#include <QList>
+#include "tilecache.h"
+
+class TIFFFile;
+
+/* Block (tiles/strips) based TIFF raster reader. Only the blocks that
+   intersect the requested tiles are read and decoded, reduced-resolution
+   IFDs (overviews) are provided as additional levels. Supports 8bit chunky
+   gray, palette, RGB and RGBA images with no, LZW, Deflate, PackBits or JPEG
+   compression. */
+class TIFFImage
+{
+public:
+	class Tile
+	{
+	public:
+		Tile(const TileCache::Key &key, const QPointF &pos, const QRect &rect)
+		  : _key(key), _pos(pos), _rect(rect) {}
+
+		const TileCache::Key &key() const {return _key;}
+		const QPointF &pos() const {return _pos;}
+		QPixmap pixmap() const {return QPixmap::fromImage(_image);}
+
+	private:
+		friend class TIFFImage;
+
+		TileCache::Key _key;
+		QPointF _pos;
+		QRect _rect;
+		QImage _image;
+	};
+
+	TIFFImage(const QString &fileName);
+
+	bool isValid() const {return !_levels.isEmpty();}
+	const QString &errorString() const {return _errorString;}
+
+	int levels() const {return _levels.size();}
+	QSize size(int level) const {return _levels.at(level).size;}
+	QSize tileSize(int level) const;
+
+	bool open() {return _file.open(QIODevice::ReadOnly);}
+	bool isOpen() const {return _file.isOpen();}
+	void close() {_file.close();}
+
+	/* Reads the blocks of the tiles (the tile rects are in the level pixel
+	   coordinates) on the calling thread and decodes them in parallel. */
+	void load(int level, QList<Tile> &tiles);
+
+private:
+	struct Level {
+		Level() : tiled(false), compression(1), photometric(1), predictor(1),
+		  samples(1), alpha(0) {}
+
+		QSize size;
+		QSize blockSize;
+		bool tiled;
+		QVector<quint32> offsets;
+		QVector<quint32> counts;
+		quint16 compression;
+		quint16 photometric;
+		quint16 predictor;
+		quint16 samples;
+		quint16 alpha;
+		QByteArray jpegTables;
+		QVector<QRgb> palette;
+	};
+
+	struct IFDEntry {
+		IFDEntry() : type(0), count(0), offset(0), pos(0) {}
+
+		quint16 type;
+		quint32 count;
+		quint32 offset;
+		qint64 pos;
+	};
+
+	class Job
+	{
+	public:
+		Job(const Level *level) : _level(level) {}
+
+		void load();
+
+	private:
+		friend class TIFFImage;
+
+		QImage decode(const QByteArray &data, const QSize &size) const;
+
+		const Level *_level;
+		QList<QRect> _blocks;
+		QList<QByteArray> _data;
+		QList<int> _tiles;
+		QList<QRect> _rects;
+		QList<QImage> _images;
+	};
+
+	bool readIFD(TIFFFile &file, quint32 &offset, QMap<quint16, IFDEntry>
+	  &entries) const;
+	bool readValues(TIFFFile &file, const IFDEntry &entry,
+	  QVector<quint32> &values) const;
+	bool readValue(TIFFFile &file, const QMap<quint16, IFDEntry> &entries,
+	  quint16 tag, quint32 &value) const;
+	bool readLevel(TIFFFile &file, const QMap<quint16, IFDEntry> &entries,
+	  Level &level, QString &errorString) const;
+
+	QRect blockRect(const Level &level, int block) const;
+	void readBlock(const Level &level, int block, Job &job);
+
+	QFile _file;
+	QList<Level> _levels;
+	QString _errorString;
+};
+
+#endif // TIFFIMAGE_H
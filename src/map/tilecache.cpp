@@ -0,0 +1,106 @@
+#include <QCache>
+#include <QAtomicInt>
+#include "tilecache.h"
+
+
+#define DEFAULT_LIMIT (64 * 1024 * 1024) /* bytes */
+#define PREFETCH_SHARE 4 /* 1/4 of the cache */
+
+struct Cache
+{
+	Cache() : tiles(DEFAULT_LIMIT) {}
+
+	QCache<TileCache::Key, QPixmap> tiles;
+	TileCache::Stats stats;
+};
+
+static Cache &cache()
+{
+	static Cache cache;
+	return cache;
+}
+
+static int cost(const QPixmap &pixmap)
+{
+	return qMax(1, pixmap.width() * pixmap.height() * pixmap.depth() / 8);
+}
+
+/* Maps may be created outside of the GUI thread */
+quint32 TileCache::id()
+{
+	static QAtomicInt ids(0);
+	return ids.fetchAndAddRelaxed(1) + 1;
+}
+
+bool TileCache::find(const Key &key, QPixmap &pixmap)
+{
+	Cache &c = cache();
+	QPixmap *pm = c.tiles.object(key);
+
+	if (!pm) {
+		c.stats.misses++;
+		return false;
+	}
+	c.stats.hits++;
+	pixmap = *pm;
+
+	return true;
+}
+
+bool TileCache::contains(const Key &key)
+{
+	return cache().tiles.contains(key);
+}
+
+void TileCache::insert(const Key &key, const QPixmap &pixmap)
+{
+	Cache &c = cache();
+	int count = c.tiles.count() + (c.tiles.contains(key) ? 0 : 1);
+
+	if (c.tiles.insert(key, new QPixmap(pixmap), cost(pixmap)))
+		c.stats.evictions += count - c.tiles.count();
+}
+
+void TileCache::remove(quint32 map)
+{
+	Cache &c = cache();
+	QList<Key> keys(c.tiles.keys());
+
+	for (int i = 0; i < keys.size(); i++)
+		if (keys.at(i).map() == map)
+			c.tiles.remove(keys.at(i));
+}
+
+void TileCache::clear()
+{
+	cache().tiles.clear();
+}
+
+void TileCache::setLimit(int size)
+{
+	Cache &c = cache();
+	int count = c.tiles.count();
+
+	c.tiles.setMaxCost(size);
+	c.stats.evictions += count - c.tiles.count();
+}
+
+TileCache::Stats TileCache::stats()
+{
+	Cache &c = cache();
+	Stats stats(c.stats);
+
+	stats.count = c.tiles.count();
+	stats.size = c.tiles.totalCost();
+	stats.limit = c.tiles.maxCost();
+
+	return stats;
+}
+
+/* Number of tiles of the given size that may be prefetched without evicting
+   the tiles of the current view. */
+int TileCache::prefetchCount(const QSize &tileSize)
+{
+	qint64 size = (qint64)tileSize.width() * tileSize.height() * 4;
+	return size ? (int)(cache().tiles.maxCost() / PREFETCH_SHARE / size) : 0;
+}
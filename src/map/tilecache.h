@@ -0,0 +1,75 @@
+#ifndef TILECACHE_H
+#define TILECACHE_H
+
+#include <QPixmap>
+#include <QPoint>
+#include <QMetaType>
+
+/* Memory cache of the map tile pixmaps shared by all the maps. Every map
+   (or tile source) gets its unique ID with TileCache::id() and uses it
+   together with the zoom level and the tile position as the tile key, so
+   the tiles of a single map can be invalidated without affecting the others.
+   The cache size limit is in bytes. As with QPixmapCache, the cache may only
+   be used from the GUI thread. */
+namespace TileCache
+{
+	class Key
+	{
+	public:
+		Key() : _map(0), _zoom(0), _x(0), _y(0) {}
+		Key(quint32 map, int zoom, int x, int y)
+		  : _map(map), _zoom(zoom), _x(x), _y(y) {}
+		Key(quint32 map, int zoom, const QPoint &xy)
+		  : _map(map), _zoom(zoom), _x(xy.x()), _y(xy.y()) {}
+
+		quint32 map() const {return _map;}
+		int zoom() const {return _zoom;}
+		int x() const {return _x;}
+		int y() const {return _y;}
+
+		bool operator==(const Key &other) const
+		  {return (_map == other._map && _zoom == other._zoom
+		  && _x == other._x && _y == other._y);}
+
+	private:
+		quint32 _map;
+		int _zoom;
+		int _x, _y;
+	};
+
+	struct Stats
+	{
+		Stats() : hits(0), misses(0), evictions(0), count(0), size(0),
+		  limit(0) {}
+
+		quint64 hits;
+		quint64 misses;
+		quint64 evictions;
+		int count;
+		int size;
+		int limit;
+	};
+
+	inline uint qHash(const Key &key)
+	{
+		return ::qHash(key.map()) ^ ::qHash(key.zoom() << 24)
+		  ^ ::qHash((key.x() << 12) ^ key.y());
+	}
+
+	quint32 id();
+
+	bool find(const Key &key, QPixmap &pixmap);
+	bool contains(const Key &key);
+	void insert(const Key &key, const QPixmap &pixmap);
+	void remove(quint32 map);
+	void clear();
+
+	void setLimit(int size);
+	Stats stats();
+
+	int prefetchCount(const QSize &tileSize);
+}
+
+Q_DECLARE_METATYPE(TileCache::Key)
+
+#endif // TILECACHE_H
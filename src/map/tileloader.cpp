@@ -1,22 +1,36 @@
 #include <QDir>
 #include <QFileInfo>
+#include <QRegExp>
 #include <QEventLoop>
-#include <QPixmapCache>
 #include <QImageReader>
+#include <QBuffer>
+#include <QRunnable>
+#include <QDateTime>
+#include <QTimer>
 #if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
 #include <QtCore>
 #else // QT_VERSION < 5
 #include <QtConcurrent>
 #endif // QT_VERSION < 5
+#include "tilecache.h"
+#include "tilestore.h"
 #include "tileloader.h"
 
 
+#define PREFETCH_DOWNLOADS 2
+#define SEED_DOWNLOADS     2
+#define SEED_CHECK         256 /* tiles */
+#define STORE_FILE "tiles.db"
+#define TILE_EXPIRE (30 * 24 * 3600)
+
 class TileImage
 {
 public:
 	TileImage() : _tile(0), _scaledSize(0) {}
 	TileImage(const QString &file, Tile *tile, int scaledSize)
 	  : _file(file), _tile(tile), _scaledSize(scaledSize) {}
+	TileImage(const QByteArray &data, Tile *tile, int scaledSize)
+	  : _data(data), _tile(tile), _scaledSize(scaledSize) {}
 
 	void createPixmap()
 	{
@@ -25,7 +39,14 @@ public:
 	void load()
 	{
 		QByteArray z(_tile->zoom().toString().toLatin1());
-		QImageReader reader(_file, z);
+		QBuffer buffer(&_data);
+		QImageReader reader;
+		if (_file.isNull())
+			reader.setDevice(&buffer);
+		else {
+			reader.setFileName(_file);
+			reader.setFormat(z);
+		}
 		if (_scaledSize)
 			reader.setScaledSize(QSize(_scaledSize, _scaledSize));
 		reader.read(&_image);
@@ -36,11 +57,42 @@ public:
 
 private:
 	QString _file;
+	QByteArray _data;
 	Tile *_tile;
 	int _scaledSize;
 	QImage _image;
 };
 
+class TileDecodeJob : public QRunnable
+{
+public:
+	TileDecodeJob(TileLoader *loader, const TileCache::Key &key,
+	  const QByteArray &data, int scaledSize, int generation)
+	  : _loader(loader), _key(key), _data(data), _scaledSize(scaledSize),
+	  _generation(generation) {}
+
+	void run()
+	{
+		QImage img;
+		QBuffer buffer(&_data);
+		QImageReader reader(&buffer);
+		if (_scaledSize)
+			reader.setScaledSize(QSize(_scaledSize, _scaledSize));
+		reader.read(&img);
+
+		QMetaObject::invokeMethod(_loader, "tileDecoded",
+		  Qt::QueuedConnection, Q_ARG(TileCache::Key, _key),
+		  Q_ARG(QImage, img), Q_ARG(int, _generation));
+	}
+
+private:
+	TileLoader *_loader;
+	TileCache::Key _key;
+	QByteArray _data;
+	int _scaledSize;
+	int _generation;
+};
+
 static QString quadKey(const QPoint &xy, int zoom)
 {
 	QString qk;
@@ -59,42 +111,103 @@ static QString quadKey(const QPoint &xy, int zoom)
 }
 
 TileLoader::TileLoader(const QString &dir, QObject *parent)
-  : QObject(parent), _dir(dir), _scaledSize(0), _quadTiles(false)
+  : QObject(parent), _dir(dir), _id(TileCache::id()), _scaledSize(0),
+  _quadTiles(false), _prefetchRunning(false), _seedTotal(0), _seedDone(0),
+  _seedSkipped(0), _seedFailed(0), _seedBatch(0), _seedDownloaded(0),
+  _seedSize(0), _seedRunning(false), _generation(0)
 {
 	if (!QDir().mkpath(_dir))
 		qWarning("%s: %s", qPrintable(_dir), "Error creating tiles directory");
 
+	qRegisterMetaType<TileCache::Key>("TileCache::Key");
+
+	QString storeFile(QDir(_dir).filePath(STORE_FILE));
+	bool upgrade = !QFileInfo(storeFile).exists();
+	_store = new TileStore(storeFile, this);
+	if (upgrade)
+		importTiles();
+
 	_downloader = new Downloader(this);
-	connect(_downloader, SIGNAL(finished()), this, SIGNAL(finished()));
+	_downloader->setStreaming(true);
+	connect(_downloader, SIGNAL(downloaded(QString, QByteArray, QByteArray,
+	  QByteArray)), this, SLOT(tileDownloaded(QString, QByteArray, QByteArray,
+	  QByteArray)));
+	connect(_downloader, SIGNAL(notModified(QString)), this,
+	  SLOT(tileNotModified(QString)));
+	connect(_downloader, SIGNAL(failed(QString)), this,
+	  SLOT(tileFailed(QString)));
+	_prefetcher = new Downloader(this);
+	_prefetcher->setStreaming(true);
+	connect(_prefetcher, SIGNAL(downloaded(QString, QByteArray, QByteArray,
+	  QByteArray)), this, SLOT(tileDownloaded(QString, QByteArray, QByteArray,
+	  QByteArray)));
+	connect(_prefetcher, SIGNAL(finished()), this, SLOT(prefetchFinished()));
+	_seeder = new Downloader(this);
+	_seeder->setStreaming(true);
+	connect(_seeder, SIGNAL(downloaded(QString, QByteArray, QByteArray,
+	  QByteArray)), this, SLOT(tileDownloaded(QString, QByteArray, QByteArray,
+	  QByteArray)));
+	connect(_seeder, SIGNAL(downloaded(QString, QByteArray, QByteArray,
+	  QByteArray)), this, SLOT(seedDownloaded(QString, QByteArray)));
+	connect(_seeder, SIGNAL(finished()), this, SLOT(seedFinished()));
+}
+
+TileLoader::~TileLoader()
+{
+	_pool.waitForDone();
 }
 
+/* The missing tiles are downloaded in the order of their distance from the
+   center of the requested area. A request for a different zoom level cancels
+   all the pending downloads of the previous one. Expired stored tiles are
+   shown and revalidated in the background. */
 void TileLoader::loadTilesAsync(QVector<Tile> &list)
 {
 	QList<Download> dl;
 	QList<TileImage> imgs;
+	QRect bounds;
+	qint64 now = QDateTime::currentMSecsSinceEpoch() / 1000;
+
+	for (int i = 0; i < list.size(); i++)
+		bounds |= QRect(list.at(i).xy(), QSize(1, 1));
+	QPoint c(bounds.center());
 
 	for (int i = 0; i < list.size(); i++) {
 		Tile &t = list[i];
-		QString file(tileFile(t));
 
-		if (QPixmapCache::find(file, t.pixmap()))
+		if (TileCache::find(key(t), t.pixmap()))
 			continue;
 
-		QFileInfo fi(file);
+		QUrl url(tileUrl(t));
+		if (url.isLocalFile()) {
+			imgs.append(TileImage(url.toLocalFile(), &t, _scaledSize));
+			continue;
+		}
 
-		if (fi.exists())
-			imgs.append(TileImage(file, &t, _scaledSize));
-		else {
-			QUrl url(tileUrl(t));
-			if (url.isLocalFile())
-				imgs.append(TileImage(url.toLocalFile(), &t, _scaledSize));
-			else
-				dl.append(Download(url, file));
+		QString file(tileFile(t));
+		TileStore::Entry entry;
+		bool stored = _store->find(file, entry);
+
+		if (stored)
+			imgs.append(TileImage(entry.data, &t, _scaledSize));
+		if (!stored || now - entry.time > TILE_EXPIRE) {
+			QPoint d(t.xy() - c);
+			Download download(url, file, d.x() * d.x() + d.y() * d.y());
+			download.setValidators(entry.etag, entry.lastModified);
+			dl.append(download);
+			_pending.insert(file, key(t));
 		}
 	}
 
+	if (!list.isEmpty() && list.first().zoom() != _zoom) {
+		QSet<QUrl> keep;
+		for (int i = 0; i < dl.size(); i++)
+			keep.insert(dl.at(i).url());
+		_downloader->cancel(keep);
+		_zoom = list.first().zoom();
+	}
 	if (!dl.empty())
-		_downloader->get(dl, _authorization);
+		_downloader->schedule(dl, _authorization);
 
 	QFuture<void> future = QtConcurrent::map(imgs, &TileImage::load);
 	future.waitForFinished();
@@ -102,8 +215,218 @@ void TileLoader::loadTilesAsync(QVector<Tile> &list)
 	for (int i = 0; i < imgs.size(); i++) {
 		TileImage &ti = imgs[i];
 		ti.createPixmap();
-		QPixmapCache::insert(ti.file(), ti.tile()->pixmap());
+		TileCache::insert(key(*ti.tile()), ti.tile()->pixmap());
+	}
+}
+
+/* Downloaded tiles are stored to the tile store and decoded directly from the
+   downloaded data in the background and inserted into the tile cache. */
+void TileLoader::tileDownloaded(const QString &file, const QByteArray &data,
+  const QByteArray &etag, const QByteArray &lastModified)
+{
+	if (!data.isEmpty()) {
+		TileStore::Entry entry;
+		entry.data = data;
+		entry.etag = etag;
+		entry.lastModified = lastModified;
+		_store->insert(file, entry);
+	}
+
+	QHash<QString, QByteArray>::iterator sit(_syncData.find(file));
+	if (sit != _syncData.end())
+		*sit = data;
+
+	QHash<QString, TileCache::Key>::iterator it(_pending.find(file));
+	if (it != _pending.end()) {
+		_pool.start(new TileDecodeJob(this, *it, data, _scaledSize,
+		  _generation));
+		_pending.erase(it);
+	}
+}
+
+void TileLoader::tileNotModified(const QString &file)
+{
+	_store->validate(file);
+	_pending.remove(file);
+}
+
+void TileLoader::tileFailed(const QString &file)
+{
+	_pending.remove(file);
+}
+
+void TileLoader::tileDecoded(const TileCache::Key &key, const QImage &img,
+  int generation)
+{
+	if (generation != _generation || img.isNull())
+		return;
+
+	TileCache::insert(key, QPixmap::fromImage(img));
+	emit tileLoaded();
+}
+
+/* Prefetched tiles are downloaded to the tile store only, using a separate
+   downloader with at most PREFETCH_DOWNLOADS concurrent requests so that the
+   on-screen tiles are not delayed. A new prefetch request replaces the
+   previous (not yet started) one. */
+void TileLoader::prefetchTiles(const QVector<Tile> &list)
+{
+	_prefetchQueue.clear();
+
+	for (int i = 0; i < list.size(); i++) {
+		const Tile &t = list.at(i);
+		QUrl url(tileUrl(t));
+		QString file(tileFile(t));
+
+		if (!url.isLocalFile() && !_store->contains(file))
+			_prefetchQueue.append(Download(url, file));
 	}
+
+	startPrefetch();
+}
+
+/* Cancels the downloads of all the tiles that are not in the list (the tiles
+   that have left the view). */
+void TileLoader::retainTiles(const QVector<Tile> &list)
+{
+	QSet<QUrl> keep;
+
+	for (int i = 0; i < list.size(); i++)
+		keep.insert(tileUrl(list.at(i)));
+
+	_downloader->cancel(keep);
+}
+
+void TileLoader::cancelPrefetch()
+{
+	_prefetchQueue.clear();
+}
+
+void TileLoader::startPrefetch()
+{
+	while (!_prefetchRunning && !_prefetchQueue.isEmpty()) {
+		QList<Download> dl;
+		while (!_prefetchQueue.isEmpty() && dl.size() < PREFETCH_DOWNLOADS)
+			dl.append(_prefetchQueue.takeFirst());
+
+		_prefetchRunning = true;
+		if (!_prefetcher->get(dl, _authorization))
+			_prefetchRunning = false;
+	}
+}
+
+void TileLoader::prefetchFinished()
+{
+	_prefetchRunning = false;
+	startPrefetch();
+}
+
+/* Seeding downloads all the tiles of the list that are not yet in the tile
+   store, with at most SEED_DOWNLOADS concurrent requests. The store is checked
+   just before the download, by batches of SEED_CHECK tiles with a single query
+   each and with a return to the event loop between the batches, so a
+   restarted seeding skips the already downloaded tiles quickly without
+   blocking the GUI. The seeded tiles are pinned in the store. */
+void TileLoader::seedTiles(const QVector<Tile> &list)
+{
+	_seedQueue.clear();
+	_seedChecked.clear();
+	_seedTotal = 0;
+	_seedDone = 0;
+	_seedSkipped = 0;
+	_seedFailed = 0;
+	_seedSize = 0;
+	_seeder->clearErrors();
+
+	for (int i = 0; i < list.size(); i++) {
+		const Tile &t = list.at(i);
+		QUrl url(tileUrl(t));
+		if (!url.isLocalFile())
+			_seedQueue.append(Download(url, tileFile(t)));
+	}
+	_seedTotal = _seedQueue.size();
+
+	emitSeedProgress();
+	startSeed();
+}
+
+void TileLoader::cancelSeed()
+{
+	_seedQueue.clear();
+	_seedChecked.clear();
+}
+
+void TileLoader::emitSeedProgress()
+{
+	emit seedProgress(_seedDone, _seedSkipped, _seedFailed, _seedTotal,
+	  _seedSize);
+}
+
+void TileLoader::checkSeed()
+{
+	QStringList files;
+	for (int i = 0; i < qMin(SEED_CHECK, _seedQueue.size()); i++)
+		files.append(_seedQueue.at(i).file());
+
+	QSet<QString> stored(_store->contains(files));
+	for (int i = 0; i < files.size(); i++) {
+		Download d(_seedQueue.takeFirst());
+		if (stored.contains(d.file())) {
+			/* Tiles stored by the normal map usage get pinned as well */
+			_store->pin(d.file());
+			_seedDone++;
+			_seedSkipped++;
+		} else
+			_seedChecked.append(d);
+	}
+}
+
+void TileLoader::startSeed()
+{
+	if (_seedRunning)
+		return;
+
+	if (_seedChecked.isEmpty() && !_seedQueue.isEmpty())
+		checkSeed();
+	if (_seedChecked.isEmpty()) {
+		emitSeedProgress();
+		if (!_seedQueue.isEmpty())
+			QTimer::singleShot(0, this, SLOT(startSeed()));
+		return;
+	}
+
+	QList<Download> dl;
+	while (!_seedChecked.isEmpty() && dl.size() < SEED_DOWNLOADS)
+		dl.append(_seedChecked.takeFirst());
+
+	_seedBatch = dl.size();
+	_seedDownloaded = 0;
+	_seedRunning = true;
+	/* Nothing has been started, all the tiles are known to fail */
+	if (!_seeder->get(dl, _authorization)) {
+		_seedRunning = false;
+		_seedDone += _seedBatch;
+		_seedFailed += _seedBatch;
+		QTimer::singleShot(0, this, SLOT(startSeed()));
+	}
+	emitSeedProgress();
+}
+
+void TileLoader::seedDownloaded(const QString &file, const QByteArray &data)
+{
+	if (!data.isEmpty())
+		_store->pin(file);
+	_seedSize += data.size();
+	_seedDownloaded++;
+}
+
+void TileLoader::seedFinished()
+{
+	_seedRunning = false;
+	_seedDone += _seedBatch;
+	_seedFailed += _seedBatch - qMin(_seedDownloaded, _seedBatch);
+	emitSeedProgress();
+	startSeed();
 }
 
 void TileLoader::loadTilesSync(QVector<Tile> &list)
@@ -114,23 +437,22 @@ void TileLoader::loadTilesSync(QVector<Tile> &list)
 
 	for (int i = 0; i < list.size(); i++) {
 		Tile &t = list[i];
-		QString file(tileFile(t));
 
-		if (QPixmapCache::find(file, t.pixmap()))
+		if (TileCache::find(key(t), t.pixmap()))
 			continue;
 
-		QFileInfo fi(file);
+		QUrl url(tileUrl(t));
+		QString file(tileFile(t));
+		TileStore::Entry entry;
 
-		if (fi.exists())
-			imgs.append(TileImage(file, &t, _scaledSize));
+		if (url.isLocalFile())
+			imgs.append(TileImage(url.toLocalFile(), &t, _scaledSize));
+		else if (_store->find(file, entry))
+			imgs.append(TileImage(entry.data, &t, _scaledSize));
 		else {
-			QUrl url(tileUrl(t));
-			if (url.isLocalFile())
-				imgs.append(TileImage(url.toLocalFile(), &t, _scaledSize));
-			else {
-				dl.append(Download(url, file));
-				tl.append(&t);
-			}
+			dl.append(Download(url, file));
+			tl.append(&t);
+			_syncData.insert(file, QByteArray());
 		}
 	}
 
@@ -143,9 +465,12 @@ void TileLoader::loadTilesSync(QVector<Tile> &list)
 		for (int i = 0; i < tl.size(); i++) {
 			Tile *t = tl[i];
 			QString file = tileFile(*t);
-			if (QFileInfo(file).exists())
-				imgs.append(TileImage(file, t, _scaledSize));
+			QByteArray data(_syncData.value(file));
+			if (!data.isEmpty())
+				imgs.append(TileImage(data, t, _scaledSize));
 		}
+
+		_syncData.clear();
 	}
 
 	QFuture<void> future = QtConcurrent::map(imgs, &TileImage::load);
@@ -155,17 +480,42 @@ void TileLoader::loadTilesSync(QVector<Tile> &list)
 		imgs[i].createPixmap();
 }
 
+/* The tiles of the former one-file-per-tile cache are moved to the tile store
+   when the store gets created. This is done only once per map. */
+void TileLoader::importTiles()
+{
+	QRegExp re("^.+-[0-9]+-[0-9]+$");
+	QStringList list(QDir(_dir).entryList(QDir::Files));
+	QStringList files;
+
+	for (int i = 0; i < list.size(); i++)
+		if (re.exactMatch(list.at(i)))
+			files.append(list.at(i));
+
+	if (!files.isEmpty())
+		_store->import(_dir, files);
+}
+
 void TileLoader::clearCache()
 {
 	QDir dir = QDir(_dir);
-	QStringList list = dir.entryList();
+	QStringList list = dir.entryList(QDir::Files);
 
+	/* The tile store is cleared as a whole, the remaining files are the
+	   capabilities files. */
+	_store->clear();
 	for (int i = 0; i < list.count(); i++)
-		dir.remove(list.at(i));
+		if (list.at(i) != QLatin1String(STORE_FILE))
+			dir.remove(list.at(i));
 
 	_downloader->clearErrors();
+	_prefetcher->clearErrors();
+	_prefetchQueue.clear();
+	_seedQueue.clear();
+	_pending.clear();
+	_generation++;
 
-	QPixmapCache::clear();
+	TileCache::remove(_id);
 }
 
 void TileLoader::setScaledSize(int size)
@@ -174,7 +524,28 @@ void TileLoader::setScaledSize(int size)
 		return;
 
 	_scaledSize = size;
-	QPixmapCache::clear();
+	_generation++;
+	TileCache::remove(_id);
+}
+
+/* WMTS zoom levels are tile matrix identifiers (strings), map them to
+   consecutive integers for the tile cache keys. */
+int TileLoader::zoomId(const QVariant &zoom)
+{
+	if (zoom.type() == QVariant::Int)
+		return zoom.toInt();
+
+	QString id(zoom.toString());
+	QHash<QString, int>::iterator it(_zoomIds.find(id));
+	if (it == _zoomIds.end())
+		it = _zoomIds.insert(id, _zoomIds.size());
+
+	return *it;
+}
+
+TileCache::Key TileLoader::key(const Tile &tile)
+{
+	return TileCache::Key(_id, zoomId(tile.zoom()), tile.xy());
 }
 
 QUrl TileLoader::tileUrl(const Tile &tile) const
@@ -201,7 +572,7 @@ QUrl TileLoader::tileUrl(const Tile &tile) const
 
 QString TileLoader::tileFile(const Tile &tile) const
 {
-	return _dir + QLatin1Char('/') + tile.zoom().toString() + QLatin1Char('-')
+	return tile.zoom().toString() + QLatin1Char('-')
 	  + QString::number(tile.xy().x()) + QLatin1Char('-')
 	  + QString::number(tile.xy().y());
 }
@@ -3,15 +3,21 @@
 
 #include <QObject>
 #include <QString>
+#include <QHash>
+#include <QThreadPool>
 #include "tile.h"
+#include "tilecache.h"
 #include "downloader.h"
 
+class TileStore;
+
 class TileLoader : public QObject
 {
 	Q_OBJECT
 
 public:
 	TileLoader(const QString &dir, QObject *parent = 0);
+	~TileLoader();
 
 	void setUrl(const QString &url) {_url = url;}
 	void setAuthorization(const Authorization &authorization)
@@ -21,21 +27,64 @@ public:
 
 	void loadTilesAsync(QVector<Tile> &list);
 	void loadTilesSync(QVector<Tile> &list);
+	void prefetchTiles(const QVector<Tile> &list);
+	void retainTiles(const QVector<Tile> &list);
+	void seedTiles(const QVector<Tile> &list);
+	void cancelSeed();
+	void cancelPrefetch();
 	void clearCache();
 
 signals:
-	void finished();
+	void tileLoaded();
+	void seedProgress(int done, int skipped, int failed, int total,
+	  qint64 size);
+
+private slots:
+	void prefetchFinished();
+	void startSeed();
+	void seedFinished();
+	void seedDownloaded(const QString &file, const QByteArray &data);
+	void tileDownloaded(const QString &file, const QByteArray &data,
+	  const QByteArray &etag, const QByteArray &lastModified);
+	void tileNotModified(const QString &file);
+	void tileFailed(const QString &file);
+	void tileDecoded(const TileCache::Key &key, const QImage &img,
+	  int generation);
 
 private:
 	QUrl tileUrl(const Tile &tile) const;
 	QString tileFile(const Tile &tile) const;
+	int zoomId(const QVariant &zoom);
+	TileCache::Key key(const Tile &tile);
+	void startPrefetch();
+	void importTiles();
+	void checkSeed();
+	void emitSeedProgress();
 
+	TileStore *_store;
 	Downloader *_downloader;
+	Downloader *_prefetcher;
+	Downloader *_seeder;
 	QString _url;
 	QString _dir;
+	quint32 _id;
+	QHash<QString, int> _zoomIds;
 	Authorization _authorization;
 	int _scaledSize;
 	bool _quadTiles;
+	QList<Download> _prefetchQueue;
+	bool _prefetchRunning;
+	QList<Download> _seedQueue;
+	QList<Download> _seedChecked;
+	int _seedTotal, _seedDone, _seedSkipped, _seedFailed;
+	int _seedBatch, _seedDownloaded;
+	qint64 _seedSize;
+	bool _seedRunning;
+	QHash<QString, TileCache::Key> _pending;
+	QHash<QString, QByteArray> _syncData;
+	QThreadPool _pool;
+	int _generation;
+	QVariant _zoom;
 };
 
 #endif // TILELOADER_Honlinemap
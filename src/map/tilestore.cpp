@@ -0,0 +1,362 @@
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QTimer>
+#include <QDateTime>
+#include <QStringList>
+#include <QSqlQuery>
+#include <QVariant>
+#include "tilestore.h"
+
+
+#define FLUSH_DELAY 1000
+
+qint64 TileStore::_limit = 1024LL * 1024LL * 1024LL;
+
+static qint64 now()
+{
+	return QDateTime::currentMSecsSinceEpoch() / 1000;
+}
+
+/* Multiple stores may use the same database file */
+static QString connectionName(const QString &fileName)
+{
+	static int id = 0;
+	return "TileStore-" + fileName + "-" + QString::number(id++);
+}
+
+TileStore::TileStore(const QString &fileName, QObject *parent)
+  : QObject(parent), _fileName(fileName),
+  _connection(connectionName(fileName)), _valid(false), _size(0)
+{
+	_timer = new QTimer(this);
+	_timer->setSingleShot(true);
+	_timer->setInterval(FLUSH_DELAY);
+	connect(_timer, SIGNAL(timeout()), this, SLOT(flush()));
+
+	if (!QDir().mkpath(QFileInfo(fileName).absolutePath())) {
+		qWarning("%s: Error creating tiles directory", qPrintable(fileName));
+		return;
+	}
+
+	_db = QSqlDatabase::addDatabase("QSQLITE", _connection);
+	_db.setDatabaseName(fileName);
+	_valid = open();
+}
+
+TileStore::~TileStore()
+{
+	flush();
+	close();
+
+	_db = QSqlDatabase();
+	QSqlDatabase::removeDatabase(_connection);
+}
+
+bool TileStore::open()
+{
+	if (!_db.open()) {
+		qWarning("%s: Error opening tile store", qPrintable(_fileName));
+		return false;
+	}
+
+	QSqlQuery query(_db);
+	query.exec("PRAGMA synchronous = OFF");
+	if (!query.exec("CREATE TABLE IF NOT EXISTS tiles (key TEXT PRIMARY KEY, "
+	  "data BLOB, etag TEXT, modified TEXT, time INTEGER, atime INTEGER, "
+	  "size INTEGER, pinned INTEGER DEFAULT 0)") || !query.exec("CREATE INDEX "
+	  "IF NOT EXISTS tiles_atime ON tiles (atime)")) {
+		qWarning("%s: Error initializing tile store", qPrintable(_fileName));
+		_db.close();
+		return false;
+	}
+	/* Stores created before the tiles pinning have no pinned column, the
+	   statement fails harmlessly for the current ones */
+	query.exec("ALTER TABLE tiles ADD COLUMN pinned INTEGER DEFAULT 0");
+
+	if (query.exec("SELECT SUM(size) FROM tiles WHERE pinned = 0")
+	  && query.first())
+		_size = query.value(0).toLongLong();
+
+	return true;
+}
+
+void TileStore::close()
+{
+	_db.close();
+	_valid = false;
+}
+
+void TileStore::schedule()
+{
+	if (!_timer->isActive())
+		_timer->start();
+}
+
+bool TileStore::find(const QString &key, Entry &entry)
+{
+	QHash<QString, Entry>::const_iterator it(_inserts.constFind(key));
+	if (it != _inserts.constEnd()) {
+		entry = *it;
+		return true;
+	}
+
+	if (!_valid)
+		return false;
+
+	QSqlQuery query(_db);
+	query.prepare("SELECT data, etag, modified, time FROM tiles WHERE key = ?");
+	query.addBindValue(key);
+	if (!query.exec() || !query.first())
+		return false;
+
+	entry.data = query.value(0).toByteArray();
+	entry.etag = query.value(1).toByteArray();
+	entry.lastModified = query.value(2).toByteArray();
+	entry.time = query.value(3).toLongLong();
+
+	_accessed.insert(key);
+	schedule();
+
+	return !entry.data.isEmpty();
+}
+
+bool TileStore::contains(const QString &key)
+{
+	if (_inserts.contains(key))
+		return true;
+	if (!_valid)
+		return false;
+
+	QSqlQuery query(_db);
+	query.prepare("SELECT 1 FROM tiles WHERE key = ?");
+	query.addBindValue(key);
+
+	return (query.exec() && query.first());
+}
+
+/* Returns the stored keys of the list, using a single query */
+QSet<QString> TileStore::contains(const QStringList &keys)
+{
+	QSet<QString> set;
+	QStringList args;
+
+	for (int i = 0; i < keys.size(); i++) {
+		if (_inserts.contains(keys.at(i)))
+			set.insert(keys.at(i));
+		args.append("?");
+	}
+	if (!_valid || keys.isEmpty())
+		return set;
+
+	QSqlQuery query(_db);
+	query.prepare("SELECT key FROM tiles WHERE key IN (" + args.join(",")
+	  + ")");
+	for (int i = 0; i < keys.size(); i++)
+		query.addBindValue(keys.at(i));
+	if (query.exec())
+		while (query.next())
+			set.insert(query.value(0).toString());
+
+	return set;
+}
+
+void TileStore::insert(const QString &key, const Entry &entry)
+{
+	Entry e(entry);
+	e.time = now();
+
+	_inserts.insert(key, e);
+	schedule();
+}
+
+/* Marks the stored tile as up to date (HTTP 304 response) */
+void TileStore::validate(const QString &key)
+{
+	QHash<QString, Entry>::iterator it(_inserts.find(key));
+	if (it != _inserts.end())
+		it->time = now();
+	else
+		_validated.insert(key);
+
+	schedule();
+}
+
+/* Protects the tile from eviction */
+void TileStore::pin(const QString &key)
+{
+	QHash<QString, Entry>::iterator it(_inserts.find(key));
+	if (it != _inserts.end())
+		it->pinned = true;
+	else
+		_pinned.insert(key);
+
+	schedule();
+}
+
+void TileStore::flush()
+{
+	_timer->stop();
+
+	if (!_valid) {
+		_inserts.clear();
+		_validated.clear();
+		_pinned.clear();
+		_accessed.clear();
+		return;
+	}
+	if (_inserts.isEmpty() && _validated.isEmpty() && _pinned.isEmpty()
+	  && _accessed.isEmpty())
+		return;
+
+	qint64 t = now();
+	QSqlQuery query(_db);
+
+	_db.transaction();
+
+	/* A refreshed tile keeps its pinned state */
+	query.prepare("INSERT OR REPLACE INTO tiles (key, data, etag, modified, "
+	  "time, atime, size, pinned) VALUES (?, ?, ?, ?, ?, ?, ?, MAX(?, "
+	  "COALESCE((SELECT pinned FROM tiles WHERE key = ?), 0)))");
+	for (QHash<QString, Entry>::const_iterator it = _inserts.constBegin();
+	  it != _inserts.constEnd(); ++it) {
+		query.addBindValue(it.key());
+		query.addBindValue(it->data);
+		query.addBindValue(it->etag);
+		query.addBindValue(it->lastModified);
+		query.addBindValue(it->time);
+		query.addBindValue(t);
+		query.addBindValue(it->data.size());
+		query.addBindValue(it->pinned ? 1 : 0);
+		query.addBindValue(it.key());
+		if (query.exec() && !it->pinned)
+			_size += it->data.size();
+	}
+
+	query.prepare("UPDATE tiles SET pinned = 1 WHERE key = ?");
+	for (QSet<QString>::const_iterator it = _pinned.constBegin();
+	  it != _pinned.constEnd(); ++it) {
+		query.addBindValue(*it);
+		query.exec();
+	}
+
+	query.prepare("UPDATE tiles SET time = ?, atime = ? WHERE key = ?");
+	for (QSet<QString>::const_iterator it = _validated.constBegin();
+	  it != _validated.constEnd(); ++it) {
+		query.addBindValue(t);
+		query.addBindValue(t);
+		query.addBindValue(*it);
+		query.exec();
+	}
+
+	query.prepare("UPDATE tiles SET atime = ? WHERE key = ?");
+	for (QSet<QString>::const_iterator it = _accessed.constBegin();
+	  it != _accessed.constEnd(); ++it) {
+		query.addBindValue(t);
+		query.addBindValue(*it);
+		query.exec();
+	}
+
+	_db.commit();
+
+	_inserts.clear();
+	_validated.clear();
+	_pinned.clear();
+	_accessed.clear();
+
+	if (_size > _limit)
+		evict();
+}
+
+/* Moves the tiles of the former one-file-per-tile cache to the store, the
+   file names are the tile keys. The tiles keep the files modification time
+   so that the old ones get revalidated. */
+void TileStore::import(const QString &dir, const QStringList &files)
+{
+	if (!_valid)
+		return;
+
+	QDir d(dir);
+	qint64 t = now();
+	QSqlQuery query(_db);
+
+	_db.transaction();
+	query.prepare("INSERT OR IGNORE INTO tiles (key, data, time, atime, size) "
+	  "VALUES (?, ?, ?, ?, ?)");
+	for (int i = 0; i < files.size(); i++) {
+		QString path(d.filePath(files.at(i)));
+		QFile file(path);
+
+		if (file.open(QIODevice::ReadOnly)) {
+			QByteArray data(file.readAll());
+			file.close();
+
+			if (!data.isEmpty()) {
+				query.addBindValue(files.at(i));
+				query.addBindValue(data);
+				query.addBindValue(QFileInfo(path).lastModified()
+				  .toMSecsSinceEpoch() / 1000);
+				query.addBindValue(t);
+				query.addBindValue(data.size());
+				if (query.exec() && query.numRowsAffected() > 0)
+					_size += data.size();
+			}
+		}
+		if (!QFile::remove(path))
+			qWarning("%s: Error removing tile file", qPrintable(path));
+	}
+	_db.commit();
+
+	if (_size > _limit)
+		evict();
+}
+
+/* Drops the least recently used (not pinned) tiles until the store size gets
+   10% below the limit. */
+void TileStore::evict()
+{
+	QSqlQuery query(_db);
+	QStringList keys;
+
+	if (query.exec("SELECT SUM(size) FROM tiles WHERE pinned = 0")
+	  && query.first())
+		_size = query.value(0).toLongLong();
+	if (_size <= _limit)
+		return;
+
+	qint64 target = _limit - _limit / 10;
+	if (!query.exec("SELECT key, size FROM tiles WHERE pinned = 0 "
+	  "ORDER BY atime"))
+		return;
+	while (_size > target && query.next()) {
+		keys.append(query.value(0).toString());
+		_size -= query.value(1).toLongLong();
+	}
+	query.finish();
+
+	_db.transaction();
+	query.prepare("DELETE FROM tiles WHERE key = ?");
+	for (int i = 0; i < keys.size(); i++) {
+		query.addBindValue(keys.at(i));
+		query.exec();
+	}
+	_db.commit();
+}
+
+/* Removing the whole database file is much faster than deleting all the
+   tiles from it. */
+void TileStore::clear()
+{
+	_timer->stop();
+	_inserts.clear();
+	_validated.clear();
+	_pinned.clear();
+	_accessed.clear();
+	_size = 0;
+
+	close();
+	if (QFileInfo(_fileName).exists() && !QFile::remove(_fileName))
+		qWarning("%s: Error removing tile store", qPrintable(_fileName));
+	if (_db.isValid())
+		_valid = open();
+}
@@ -0,0 +1,75 @@
+#ifndef TILESTORE_H
+#define TILESTORE_H
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+#include <QSqlDatabase>
+
+class QTimer;
+
+/* Persistent store of downloaded map tiles. All the tiles of a map are kept
+   in a single SQLite database together with their HTTP validators. The store
+   size is limited, the least recently used tiles are dropped first. Pinned
+   (seeded) tiles are never dropped and do not count into the limit. Changes
+   are collected and written to the database in batches. */
+class TileStore : public QObject
+{
+	Q_OBJECT
+
+public:
+	struct Entry
+	{
+		Entry() : time(0), pinned(false) {}
+
+		QByteArray data;
+		QByteArray etag;
+		QByteArray lastModified;
+		qint64 time;
+		bool pinned;
+	};
+
+	TileStore(const QString &fileName, QObject *parent = 0);
+	~TileStore();
+
+	bool isValid() const {return _valid;}
+
+	bool find(const QString &key, Entry &entry);
+	bool contains(const QString &key);
+	QSet<QString> contains(const QStringList &keys);
+	void insert(const QString &key, const Entry &entry);
+	void validate(const QString &key);
+	void pin(const QString &key);
+	void import(const QString &dir, const QStringList &files);
+	void clear();
+
+	static qint64 limit() {return _limit;}
+	static void setLimit(qint64 size) {_limit = size;}
+
+private slots:
+	void flush();
+
+private:
+	bool open();
+	void close();
+	void evict();
+	void schedule();
+
+	QString _fileName;
+	QString _connection;
+	QSqlDatabase _db;
+	bool _valid;
+	qint64 _size;
+	QHash<QString, Entry> _inserts;
+	QSet<QString> _validated;
+	QSet<QString> _pinned;
+	QSet<QString> _accessed;
+	QTimer *_timer;
+
+	static qint64 _limit;
+};
+
+#endif // TILESTORE_H
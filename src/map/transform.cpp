@@ -111,6 +111,25 @@ Transform::Transform(double matrix[16])
 		_proj2img = _img2proj.inverted();
 }
 
+/* All the transformations are affine, so the matrix is applied directly
+   instead of the generic (projective) QTransform::map() for every point. */
+void Transform::proj2img(const PointD *p, QPointF *out, int n) const
+{
+	if (_proj2img.type() > QTransform::TxShear) {
+		for (int i = 0; i < n; i++)
+			out[i] = _proj2img.map(p[i].toPointF());
+		return;
+	}
+
+	double m11 = _proj2img.m11(), m12 = _proj2img.m12();
+	double m21 = _proj2img.m21(), m22 = _proj2img.m22();
+	double dx = _proj2img.dx(), dy = _proj2img.dy();
+
+	for (int i = 0; i < n; i++)
+		out[i] = QPointF(m11 * p[i].x() + m21 * p[i].y() + dx,
+		  m12 * p[i].x() + m22 * p[i].y() + dy);
+}
+
 #ifndef QT_NO_DEBUG
 QDebug operator<<(QDebug dbg, const ReferencePoint &p)
 {
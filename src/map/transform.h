@@ -34,6 +34,7 @@ public:
 	  {return _proj2img.map(p.toPointF());}
 	PointD img2proj(const QPointF &p) const
 	  {return _img2proj.map(p);}
+	void proj2img(const PointD *p, QPointF *out, int n) const;
 
 	bool isValid() const
 	  {return _proj2img.isInvertible() && _img2proj.isInvertible();}
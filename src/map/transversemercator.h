@@ -17,6 +17,7 @@ public:
 
 	virtual PointD ll2xy(const Coordinates &c) const;
 	virtual Coordinates xy2ll(const PointD &p) const;
+	virtual void ll2xy(const Coordinates *c, PointD *p, int n) const;
 
 private:
 	double _longitudeOrigin;
@@ -28,6 +29,7 @@ private:
 	double _es;
 	double _ebs;
 	double _ap, _bp, _cp, _dp, _ep;
+	double _tmdo;
 };
 
 #endif // TRANSVERSEMERCATOR_H
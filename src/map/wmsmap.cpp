@@ -57,16 +57,21 @@ void WMSMap::computeZooms()
 		_zooms.append(sd.min() + EPSILON);
 }
 
-void WMSMap::updateTransform()
+Transform WMSMap::transform(int zoom) const
 {
-	double pixelSpan = sd2res(_zooms.at(_zoom));
+	double pixelSpan = sd2res(_zooms.at(zoom));
 	if (_wms->projection().isGeographic())
 		pixelSpan /= deg2rad(WGS84_RADIUS);
-	_transform = Transform(ReferencePoint(PointD(0, 0),
+	return Transform(ReferencePoint(PointD(0, 0),
 	  _wms->projection().ll2xy(_wms->bbox().topLeft())),
 	  PointD(pixelSpan, pixelSpan));
 }
 
+void WMSMap::updateTransform()
+{
+	_transform = transform(_zoom);
+}
+
 WMSMap::WMSMap(const QString &name, const WMS::Setup &setup, int tileSize,
   QObject *parent) : Map(parent), _name(name), _tileLoader(0), _zoom(0),
   _tileSize(tileSize), _mapRatio(1.0)
@@ -75,7 +80,9 @@ WMSMap::WMSMap(const QString &name, const WMS::Setup &setup, int tileSize,
 
 	_tileLoader = new TileLoader(tilesDir, this);
 	_tileLoader->setAuthorization(setup.authorization());
-	connect(_tileLoader, SIGNAL(finished()), this, SIGNAL(tilesLoaded()));
+	connect(_tileLoader, SIGNAL(tileLoaded()), this, SIGNAL(tilesLoaded()));
+	connect(_tileLoader, SIGNAL(seedProgress(int, int, int, int, qint64)),
+	  this, SIGNAL(seedProgress(int, int, int, int, qint64)));
 
 	_wms = new WMS(QDir(tilesDir).filePath(CAPABILITIES_FILE), setup, this);
 	connect(_wms, SIGNAL(downloadFinished()), this, SLOT(wmsReady()));
@@ -167,6 +174,65 @@ qreal WMSMap::tileSize() const
 	return (_tileSize / _mapRatio);
 }
 
+Tile WMSMap::tile(const Transform &transform, int zoom, const QPoint &xy) const
+{
+	PointD ttl(transform.img2proj(QPointF(xy.x() * _tileSize,
+	  xy.y() * _tileSize)));
+	PointD tbr(transform.img2proj(QPointF(xy.x() * _tileSize + _tileSize,
+	  xy.y() * _tileSize + _tileSize)));
+	RectD bbox = (_wms->cs().axisOrder() == CoordinateSystem::YX)
+	  ? RectD(PointD(tbr.y(), tbr.x()), PointD(ttl.y(), ttl.x()))
+	  : RectD(ttl, tbr);
+
+	return Tile(xy, zoom, bbox);
+}
+
+Range WMSMap::seedZooms() const
+{
+	return _wms->isValid() ? Range(0, _zooms.size() - 1) : Range(0, -1);
+}
+
+/* Range of the tiles at the given zoom level covering the rect (and the map
+   bounds) */
+QRect WMSMap::seedRange(const RectC &rect, int zoom) const
+{
+	RectC r(rect & _wms->bbox());
+	if (!r.isValid())
+		return QRect();
+	RectD prect(r, _wms->projection());
+	if (!prect.isValid())
+		return QRect();
+
+	Transform t(transform(zoom));
+	QRectF ir(QRectF(t.proj2img(prect.topLeft()),
+	  t.proj2img(prect.bottomRight())).normalized());
+
+	return QRect(QPoint(qFloor(ir.left() / _tileSize),
+	  qFloor(ir.top() / _tileSize)), QPoint(qFloor(ir.right() / _tileSize),
+	  qFloor(ir.bottom() / _tileSize)));
+}
+
+void WMSMap::seed(const RectC &rect, const Range &zooms)
+{
+	QVector<Tile> list;
+
+	for (int z = zooms.min(); z <= zooms.max(); z++) {
+		Transform t(transform(z));
+		QRect range(seedRange(rect, z));
+
+		for (int i = range.left(); i <= range.right(); i++)
+			for (int j = range.top(); j <= range.bottom(); j++)
+				list.append(tile(t, z, QPoint(i, j)));
+	}
+
+	_tileLoader->seedTiles(list);
+}
+
+void WMSMap::cancelSeed()
+{
+	_tileLoader->cancelSeed();
+}
+
 void WMSMap::draw(QPainter *painter, const QRectF &rect, Flags flags)
 {
 	QPoint tl = QPoint(qFloor(rect.left() / tileSize()),
@@ -176,19 +242,9 @@ void WMSMap::draw(QPainter *painter, const QRectF &rect, Flags flags)
 
 	QVector<Tile> tiles;
 	tiles.reserve((br.x() - tl.x()) * (br.y() - tl.y()));
-	for (int i = tl.x(); i < br.x(); i++) {
-		for (int j = tl.y(); j < br.y(); j++) {
-			PointD ttl(_transform.img2proj(QPointF(i * _tileSize,
-			  j * _tileSize)));
-			PointD tbr(_transform.img2proj(QPointF(i * _tileSize + _tileSize,
-			  j * _tileSize + _tileSize)));
-			RectD bbox = (_wms->cs().axisOrder() == CoordinateSystem::YX)
-			  ? RectD(PointD(tbr.y(), tbr.x()), PointD(ttl.y(), ttl.x()))
-			  : RectD(ttl, tbr);
-
-			tiles.append(Tile(QPoint(i, j), _zoom, bbox));
-		}
-	}
+	for (int i = tl.x(); i < br.x(); i++)
+		for (int j = tl.y(); j < br.y(); j++)
+			tiles.append(tile(_transform, _zoom, QPoint(i, j)));
 
 	if (flags & Map::Block)
 		_tileLoader->loadTilesSync(tiles);
@@ -6,6 +6,7 @@
 #include "map.h"
 #include "wms.h"
 #include "rectd.h"
+#include "tile.h"
 
 class TileLoader;
 
@@ -32,6 +33,11 @@ public:
 
 	void draw(QPainter *painter, const QRectF &rect, Flags flags);
 
+	Range seedZooms() const;
+	QRect seedRange(const RectC &rect, int zoom) const;
+	void seed(const RectC &rect, const Range &zooms);
+	void cancelSeed();
+
 	void setDevicePixelRatio(qreal /*deviceRatio*/, qreal mapRatio)
 	  {_mapRatio = mapRatio;}
 	void clearCache();
@@ -47,7 +53,9 @@ private:
 	QString tileUrl() const;
 	double sd2res(double scaleDenominator) const;
 	void computeZooms();
+	Transform transform(int zoom) const;
 	void updateTransform();
+	Tile tile(const Transform &transform, int zoom, const QPoint &xy) const;
 	qreal tileSize() const;
 	void init();
 
@@ -20,7 +20,9 @@ WMTSMap::WMTSMap(const QString &name, const WMTS::Setup &setup, qreal tileRatio,
 
 	_tileLoader = new TileLoader(tilesDir, this);
 	_tileLoader->setAuthorization(setup.authorization());
-	connect(_tileLoader, SIGNAL(finished()), this, SIGNAL(tilesLoaded()));
+	connect(_tileLoader, SIGNAL(tileLoaded()), this, SIGNAL(tilesLoaded()));
+	connect(_tileLoader, SIGNAL(seedProgress(int, int, int, int, qint64)),
+	  this, SIGNAL(seedProgress(int, int, int, int, qint64)));
 
 	_wmts = new WMTS(QDir(tilesDir).filePath(CAPABILITIES_FILE), setup, this);
 	connect(_wmts, SIGNAL(downloadFinished()), this, SLOT(wmtsReady()));
@@ -54,9 +56,9 @@ double WMTSMap::sd2res(double scaleDenominator) const
 	  * _wmts->projection().units().fromMeters(1.0);
 }
 
-void WMTSMap::updateTransform()
+Transform WMTSMap::transform(int zoom) const
 {
-	const WMTS::Zoom &z = _wmts->zooms().at(_zoom);
+	const WMTS::Zoom &z = _wmts->zooms().at(zoom);
 
 	PointD topLeft = (_wmts->cs().axisOrder() == CoordinateSystem::YX)
 	  ? PointD(z.topLeft().y(), z.topLeft().x()) : z.topLeft();
@@ -64,10 +66,15 @@ void WMTSMap::updateTransform()
 	double pixelSpan = sd2res(z.scaleDenominator());
 	if (_wmts->projection().isGeographic())
 		pixelSpan /= deg2rad(WGS84_RADIUS);
-	_transform = Transform(ReferencePoint(PointD(0, 0), topLeft),
+	return Transform(ReferencePoint(PointD(0, 0), topLeft),
 	  PointD(pixelSpan, pixelSpan));
 }
 
+void WMTSMap::updateTransform()
+{
+	_transform = transform(_zoom);
+}
+
 QRectF WMTSMap::bounds()
 {
 	const WMTS::Zoom &z = _wmts->zooms().at(_zoom);
@@ -146,6 +153,100 @@ QSizeF WMTSMap::tileSize(const WMTS::Zoom &zoom) const
 	  zoom.tile().height() / coordinatesRatio());
 }
 
+QRect WMTSMap::tileRange(const WMTS::Zoom &zoom, const QRectF &rect) const
+{
+	QSizeF ts(tileSize(zoom));
+
+	return QRect(QPoint(qFloor(rect.left() / ts.width()),
+	  qFloor(rect.top() / ts.height())), QPoint(qCeil(rect.right()
+	  / ts.width()) - 1, qCeil(rect.bottom() / ts.height()) - 1));
+}
+
+/* Only the tiles ahead of the view are prefetched, the tile matrices of the
+   other zoom levels are not aligned with the current one. */
+void WMTSMap::prefetch(const QRectF &view, const QRectF &ahead)
+{
+	if (!_wmts->isValid())
+		return;
+
+	const WMTS::Zoom &z = _wmts->zooms().at(_zoom);
+	QRect matrix(QPoint(0, 0), z.matrix());
+	QRect vr(tileRange(z, view));
+	QRect ar(tileRange(z, ahead));
+	QVector<Tile> list;
+
+	if (z.limits().isValid())
+		matrix &= z.limits();
+
+	for (int i = ar.left(); i <= ar.right(); i++)
+		for (int j = ar.top(); j <= ar.bottom(); j++)
+			if (!vr.contains(i, j) && matrix.contains(i, j))
+				list.append(Tile(QPoint(i, j), z.id()));
+
+	int max = TileCache::prefetchCount(z.tile());
+	if (list.size() > max)
+		list.resize(max);
+
+	QVector<Tile> keep(list);
+	for (int i = vr.left(); i <= vr.right(); i++)
+		for (int j = vr.top(); j <= vr.bottom(); j++)
+			keep.append(Tile(QPoint(i, j), z.id()));
+	_tileLoader->retainTiles(keep);
+	_tileLoader->prefetchTiles(list);
+}
+
+void WMTSMap::cancelPrefetch()
+{
+	_tileLoader->cancelPrefetch();
+}
+
+Range WMTSMap::seedZooms() const
+{
+	return _wmts->isValid() ? Range(0, _wmts->zooms().size() - 1)
+	  : Range(0, -1);
+}
+
+/* Range of the tiles at the given zoom level covering the rect */
+QRect WMTSMap::seedRange(const RectC &rect, int zoom) const
+{
+	const WMTS::Zoom &z = _wmts->zooms().at(zoom);
+	RectD prect(rect, _wmts->projection());
+	if (!prect.isValid())
+		return QRect();
+
+	Transform t(transform(zoom));
+	QRectF r(QRectF(t.proj2img(prect.topLeft()),
+	  t.proj2img(prect.bottomRight())).normalized());
+	QRect matrix(QPoint(0, 0), z.matrix());
+	if (z.limits().isValid())
+		matrix &= z.limits();
+
+	return QRect(QPoint(qFloor(r.left() / z.tile().width()),
+	  qFloor(r.top() / z.tile().height())), QPoint(qFloor(r.right()
+	  / z.tile().width()), qFloor(r.bottom() / z.tile().height()))) & matrix;
+}
+
+void WMTSMap::seed(const RectC &rect, const Range &zooms)
+{
+	QVector<Tile> list;
+
+	for (int z = zooms.min(); z <= zooms.max(); z++) {
+		const WMTS::Zoom &zoom = _wmts->zooms().at(z);
+		QRect range(seedRange(rect, z));
+
+		for (int i = range.left(); i <= range.right(); i++)
+			for (int j = range.top(); j <= range.bottom(); j++)
+				list.append(Tile(QPoint(i, j), zoom.id()));
+	}
+
+	_tileLoader->seedTiles(list);
+}
+
+void WMTSMap::cancelSeed()
+{
+	_tileLoader->cancelSeed();
+}
+
 void WMTSMap::draw(QPainter *painter, const QRectF &rect, Flags flags)
 {
 	const WMTS::Zoom &z = _wmts->zooms().at(_zoom);
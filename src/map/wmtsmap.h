@@ -31,6 +31,13 @@ public:
 	Coordinates xy2ll(const QPointF &p);
 
 	void draw(QPainter *painter, const QRectF &rect, Flags flags);
+	void prefetch(const QRectF &view, const QRectF &ahead);
+	void cancelPrefetch();
+
+	Range seedZooms() const;
+	QRect seedRange(const RectC &rect, int zoom) const;
+	void seed(const RectC &rect, const Range &zooms);
+	void cancelSeed();
 
 	void setDevicePixelRatio(qreal /*deviceRatio*/, qreal mapRatio)
 	  {_mapRatio = mapRatio;}
@@ -45,10 +52,12 @@ private slots:
 
 private:
 	double sd2res(double scaleDenominator) const;
+	Transform transform(int zoom) const;
 	void updateTransform();
 	QSizeF tileSize(const WMTS::Zoom &zoom) const;
 	qreal coordinatesRatio() const;
 	qreal imageRatio() const;
+	QRect tileRange(const WMTS::Zoom &zoom, const QRectF &rect) const;
 	void init();
 
 	QString _name;